@@ -1,291 +1,766 @@
 // Booths Alg Simulation
 // Created By Xander Winans on 2020/10/10
 /*
-    This program is designed to simulate booths algorithm to multiply two 16-bit numbers. It does this at the hardware level.
+    This program is designed to simulate booths algorithm to multiply two 16-bit numbers, or 8, 32 or 64-bit ones with
+    --width. It does this at the hardware level.
+    The gate-level ALU is in alu.h and the multiplier's engines in booths.h, both are templates over the operand width.
     The prorgam asks the user to input these numbers through a terminal. 
     Here is how you can run this program on a linux based computer. You may need to adjust the steps based on your system setup.
         Navigate to the directory that contains Booths_16bit.cpp 
-        Compile it with $> g++ Booths_16bit.cpp -o boothser
+        Compile it with $> g++ -O2 -pthread Booths_16bit.cpp -o boothser
+            (or build the boothser target with the CMakeLists.txt at the top of the repository)
         Run it with     $> ./boothser
-        Follow the prompt and enter two 16bit binary numbers. 
-            This program is a simulation and doesn't contain input validation, please ensure you enter the desired number correctly.
+        Follow the prompt and enter two 16bit binary numbers (as many bits as --width), or decimal or 0x hex numbers.
+            An entry that is none of these is reported and nothing is multiplied.
         To learn more about Booths algorithm visit https://en.wikipedia.org/wiki/Booth%27s_multiplication_algorithm
+
+    The multiply can also run on a fast engine that keeps the registers packed in words (see BoothRegisters)
+        Run it with     $> ./boothser --engine fast
+        --engine gate   the gate-level ALU chain, the default and the reference
+        --engine fast   AC +- MD, the shift and the cycle counter done with word arithmetic
+        --engine check  both engines side by side, every step of the fast engine is compared bit for bit
+    --cross-check N multiplies N random operand pairs on both engines without printing the table and reports
+        every step where the engines disagree, together with how many pairs per second the fast engine runs
+        Run it with     $> ./boothser --cross-check 100000
+    --sliced N multiplies N random operand pairs on the bit-sliced gate-level engine, 64, 256 or 512 pairs at a time
+        (--lanes, see slicedBooths), checks every product against the fast engine and reports the pairs per second
+        Run it with     $> ./boothser --sliced 10000000 --lanes 256
+        Compile with -mavx2 or -mavx512f for the 256 and 512 lane words to use the vector registers
+    --radix 4 or --radix 8 multiplies with radix 4 or radix 8 modified Booth's (see modifiedBooths), recoding 2 or 3 bits
+        of MQ per iteration, and prints the iterations and ALU operations after the table, --radix 2 is the default
+        Run it with     $> ./boothser --radix 4
+    --radix-stats N multiplies N random operand pairs in radix 2, 4 and 8, checks the products against native
+        multiplication and reports the iterations and ALU operations per pair of each radix
+        Run it with     $> ./boothser --radix-stats 100000
+    --batch FILE multiplies the operand pairs in FILE (or stdin with - or without a FILE) without asking or printing
+        the table. Every line holds MD and MQ, each a string of width '0' and '1' characters or a decimal or 0x hex
+        number, blank lines and lines starting with # are skipped. It writes a tab separated line per pair:
+        md, mq and the product in signed decimal, the cycles (iterations) and the add/subtract operations of the ALU
+        --trace also prints the table of every pair, for looking into single cases
+        Run it with     $> printf "3 -3\n0x7fff 0x7fff\n" | ./boothser --batch --engine fast
+    --threads N runs --cross-check, --sliced, --radix-stats and --batch on N threads, every core without it
+        (see sweep.h), the random sweeps multiply the same operand pairs on any number of threads
+        Run it with     $> ./boothser --sliced 100000000 --threads 8
+    --verify multiplies every pair of signed operands (up to 16 bits) and checks AC MQ against native multiplication,
+        --verify N checks N random pairs instead (see verify.h). It prints the wrong products and the pairs per second.
+        --engine gate, fast or sliced picks the engine it checks (sliced with --lanes), --radix 4 and 8 check the
+        gate-level modified Booth's and only run with --engine gate. --resume FILE records the finished shards in FILE,
+        running again with the same FILE carries on where an interrupted pass stopped
+        Run it with     $> ./boothser --verify --engine sliced --lanes 256 --resume verify16.txt
+    --gates counts what the gate-level ALU costs (see GateCounters in alu.h): the gates evaluated, the carry depth
+        (the longest ripple of a carry through the 1-bit ALUs) and the register bits toggled. It prints them after
+        the table, and with --batch adds them to every line and reports the whole run in # lines at the end.
+        Radix 2 runs on the gate-level engine with it. --radix-stats always reports them per radix
+        Run it with     $> ./boothser --batch pairs.txt --gates
+    --adder ripple|lookahead|select|kogge-stone builds the gate-level ALU with that adder (see Adder in alu.h): the
+        ripple carry chain (the default), a tree of 4 bit carry lookahead units, 4 bit carry-select blocks or a
+        Kogge-Stone parallel prefix. The products are the same, --gates then reports the adder's gates and modelled
+        delay. It runs radix 2 on the gate-level engine and works with the prompt, --batch and --verify
+    --adder-stats N multiplies N random operand pairs in the radix with every adder and reports the critical path
+        of each in gate delays, the delay and gates per multiply and the pairs per second the simulation runs
+        Run it with     $> ./boothser --adder-stats 100000 --radix 4
+    --width 8|16|32|64 multiplies numbers of that many bits instead of 16, for the prompt and every check above
+        Run it with     $> ./boothser --width 32 --cross-check 100000
  */
 
 
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <type_traits>
+#include <vector>
+#include "booths.h"
+#include "sweep.h"
+#include "verify.h"
 
 using namespace std;
 
-//Since numbers are stores with the lowest bit in the 0's place 
-//I need to print starting at the higher order bit.
-string binaryToString(static bool* binaryNumber)
+//serializes the reports of wrong products from the threads of a sweep
+mutex reportLock;
+
+//multiplies count random operand pairs on both engines on the given threads and reports the steps where they disagree
+//.... and the pairs per second of the fast engine on its own
+template <int Width>
+int crossCheck(long long count, int threads)
 {
-    string result = "";
-    for (int i = 0; i < 16; i++)
+    vector<long long> mismatchedPairs(threads, 0);
+    vector<int> mismatches(threads, 0);
+    parallelFor(count, threads, 1 << 12, [&](long long first, long long last, int worker)
+    {
+        for (long long n = first; n < last; n++)
+        {
+            int before = mismatches[worker];
+            booths(unpackBits<Width>(sweepOperand<Width>(n, 0)), unpackBits<Width>(sweepOperand<Width>(n, 1)),
+                   ENGINE_CHECK, false, &mismatches[worker]);
+            if (mismatches[worker] != before)
+                mismatchedPairs[worker]++;
+        }
+    });
+
+    //time the fast engine alone over the same pairs, the sum keeps the compiler from dropping the work
+    vector<uint64_t> sums(threads, 0);
+    auto start = chrono::steady_clock::now();
+    parallelFor(count, threads, 1 << 16, [&](long long first, long long last, int worker)
+    {
+        uint64_t sum = 0;
+        for (long long n = first; n < last; n++)
+        {
+            BoothRegisters<Width> done = fastBooths<Width>(sweepOperand<Width>(n, 0), sweepOperand<Width>(n, 1));
+            sum += done.ac ^ done.mq;
+        }
+        sums[worker] += sum;
+    });
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    long long pairs = 0, steps = 0;
+    uint64_t sum = 0;
+    for (int worker = 0; worker < threads; worker++)
     {
-        if (binaryNumber[15 - i] == true) result.append(1, '1');
-        else result.append(1,'0');
+        pairs += mismatchedPairs[worker];
+        steps += mismatches[worker];
+        sum += sums[worker];
     }
-    return result;
+    cout << "Cross-checked " << count << " " << Width << " bit operand pairs: " << pairs << " disagreed in " << steps
+         << " steps" << endl;
+    cout << "Fast engine: " << (seconds > 0 ? count / seconds : 0) << " pairs per second on " << threads
+         << " threads (checksum " << hex << sum << dec << ")" << endl;
+    return pairs == 0 ? 0 : 1;
 }
 
-
-//Simulates a 1-bit full adder
-//The output is an array of 2 bools in form [sum, carryOut]
-bool * OneBitFullAdder(bool a, bool b, bool carryIn)
+//multiplies count random operand pairs on the bit-sliced engine with the given lanes per word on the given threads,
+//checks every product against the fast engine and reports the pairs per second of the bit-sliced engine
+template <int Width>
+int slicedCheck(long long count, int lanes, int threads)
 {
-    bool sum, carryOut;
-
-    sum = (a != b) != carryIn;
-    carryOut = (a && b) || ((a != b) && carryIn);
-
-    static bool result [2];
-    result[0] = sum;
-    result[1] = carryOut;
-    return result;
+    typedef typename RegisterWord<Width>::type Word;
+    const long long chunk = 1 << 16;
+    atomic<long long> wrong(0);
+    vector<double> seconds(threads, 0);
+    parallelFor(count, threads, chunk, [&](long long first, long long last, int worker)
+    {
+        size_t n = last - first;
+        vector<Word> md(n), mq(n), ac(n), low(n);
+        for (size_t k = 0; k < n; k++)
+        {
+            md[k] = sweepOperand<Width>(first + k, 0);
+            mq[k] = sweepOperand<Width>(first + k, 1);
+        }
+        low = mq;
+        auto start = chrono::steady_clock::now();
+        if (lanes == 512)
+            slicedBatch<Width, Lanes512>(md.data(), low.data(), ac.data(), n);
+        else if (lanes == 256)
+            slicedBatch<Width, Lanes256>(md.data(), low.data(), ac.data(), n);
+        else
+            slicedBatch<Width, Lanes64>(md.data(), low.data(), ac.data(), n);
+        seconds[worker] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        for (size_t k = 0; k < n; k++)
+        {
+            BoothRegisters<Width> fast = fastBooths<Width>(md[k], mq[k]);
+            if ((ac[k] != fast.ac || low[k] != fast.mq) && wrong++ < 10)
+            {
+                lock_guard<mutex> lock(reportLock);
+                cerr << "Bit-sliced engine disagrees for MD " << binaryToString(unpackBits<Width>(md[k])) << " MQ "
+                     << binaryToString(unpackBits<Width>(mq[k])) << ": " << binaryToString(unpackBits<Width>(ac[k]))
+                     << " " << binaryToString(unpackBits<Width>(low[k])) << " instead of "
+                     << binaryToString(unpackBits<Width>(fast.ac)) << " " << binaryToString(unpackBits<Width>(fast.mq))
+                     << endl;
+            }
+        }
+    });
+    //the threads run side by side, so the bit-sliced time of the sweep is the average time of a thread
+    double busy = 0;
+    for (double s : seconds)
+        busy += s;
+    busy /= threads;
+    cout << "Bit-sliced " << lanes << " lanes: " << count << " " << Width << " bit operand pairs, " << wrong
+         << " wrong, " << (busy > 0 ? count / busy : 0) << " pairs per second on " << threads << " threads" << endl;
+    return wrong == 0 ? 0 : 1;
 }
 
-// Simulates a 1-bit ALU
-// returns a bool array of size 2
-// Format of return [result, carryOut]
-// Less function has not been implemented
-bool* ALUOneBit (static bool a,static bool b, bool aInvert, bool bInvert, bool carryIn, bool* operation)
+//multiplies count random operand pairs in radix 2, 4 and 8 on the given threads, checks the products against
+//.... native multiplication and reports the iterations, ALU operations and the gate-level cost each radix takes
+template <int Width>
+int radixStats(long long count, int threads)
 {
-    static bool result[2];
-    bool op0, op1, op2, carryOut;
-    bool* adder;
-    //check inversion
-    if (aInvert) a = !a;
-    if (bInvert) b = !b;
-    //perform all operations
-    op0 = a && b;       
-
-    op1 = a || b;       
-    
-    adder = OneBitFullAdder(a, b, carryIn);
-    op2 = adder[0];
-    result[1] = adder[1];                   //carry Out
-   
-    //Selected with 4 way MUX
-    if (!operation[0] && !operation[1])     // AND case 00
-        result[0] = op0;
-    else if (!operation[0] && operation[1]) // OR case 01
-        result[0] = op1;
-    else if (operation[0] && !operation[1])  //ADD case 10
-        result[0] = op2;
+    typedef typename RegisterWord<Width>::type Word;
+    const int radixes[3] = {2, 4, 8};
+    //per thread totals of every radix
+    struct Totals
+    {
+        long long iterations[3];
+        long long aluOperations[3];
+        long long wrong[3];
+        GateCounters gates[3];
+    };
+    vector<Totals> totals(threads, Totals{});
+    atomic<int> reported(0);
+    parallelFor(count, threads, 1 << 12, [&](long long first, long long last, int worker)
+    {
+        Totals& mine = totals[worker];
+        for (long long n = first; n < last; n++)
+        {
+            Word md = sweepOperand<Width>(n, 0);
+            Word mq = sweepOperand<Width>(n, 1);
+            Product<Width> native = nativeProduct<Width>(md, mq);
+            for (int r = 0; r < 3; r++)
+            {
+                BoothCounts counts = {};
+                Product<Width> product;
+                if (r == 0)
+                {
+                    BoothRegisters<Width> done = booths(unpackBits<Width>(md), unpackBits<Width>(mq), ENGINE_GATE,
+                                                        false, nullptr, &counts, &mine.gates[r]);
+                    product = {done.ac, done.mq};
+                }
+                else if (r == 1)
+                    product = modifiedBooths<Width, 2>(unpackBits<Width>(md), unpackBits<Width>(mq), false, &counts,
+                                                       &mine.gates[r]);
+                else
+                    product = modifiedBooths<Width, 3>(unpackBits<Width>(md), unpackBits<Width>(mq), false, &counts,
+                                                       &mine.gates[r]);
+                mine.iterations[r] += counts.iterations;
+                mine.aluOperations[r] += counts.aluOperations;
+                if (product.high == native.high && product.low == native.low)
+                    continue;
+                mine.wrong[r]++;
+                if (reported++ < 10)
+                {
+                    lock_guard<mutex> lock(reportLock);
+                    cerr << "Radix " << radixes[r] << " product of MD " << binaryToString(unpackBits<Width>(md))
+                         << " MQ " << binaryToString(unpackBits<Width>(mq)) << " is "
+                         << binaryToString(unpackBits<Width>(product.high)) << " "
+                         << binaryToString(unpackBits<Width>(product.low)) << " instead of "
+                         << binaryToString(unpackBits<Width>(native.high)) << " "
+                         << binaryToString(unpackBits<Width>(native.low)) << endl;
+                }
+            }
+        }
+    });
+    long long iterations[3] = {}, aluOperations[3] = {}, wrong[3] = {};
+    GateCounters gates[3] = {};
+    for (const Totals& t : totals)
+        for (int r = 0; r < 3; r++)
+        {
+            iterations[r] += t.iterations[r];
+            aluOperations[r] += t.aluOperations[r];
+            wrong[r] += t.wrong[r];
+            gates[r].add(t.gates[r]);
+        }
 
-    return result;
+    cout << count << " " << Width << " bit operand pairs" << endl;
+    cout << setw(6) << "Radix" << setw(12) << "Iterations" << setw(16) << "ALU operations" << setw(16) << "Cycle saving"
+         << setw(8) << "Wrong" << setw(10) << "Gates" << setw(13) << "Carry depth" << setw(9) << "Longest" << setw(10)
+         << "Toggles" << endl;
+    for (int r = 0; r < 3; r++)
+    {
+        double perPair = count > 0 ? double(iterations[r]) / count : 0;
+        cout << setw(6) << radixes[r] << setw(12) << perPair << setw(16)
+             << (count > 0 ? double(aluOperations[r]) / count : 0) << setw(15)
+             << (iterations[0] > 0 ? 100.0 * (iterations[0] - iterations[r]) / iterations[0] : 0) << "%" << setw(8)
+             << wrong[r] << setw(10) << (count > 0 ? double(gates[r].gates) / count : 0) << setw(13)
+             << (gates[r].evaluations > 0 ? double(gates[r].carryDepth) / gates[r].evaluations : 0) << setw(9)
+             << gates[r].maxCarryDepth << setw(10) << (count > 0 ? double(gates[r].toggles) / count : 0) << endl;
+    }
+    cout << "Gates and toggles are per pair, the carry depth is the average over the ALU evaluations (the counter's too)"
+         << endl;
+    return wrong[0] == 0 && wrong[1] == 0 && wrong[2] == 0 ? 0 : 1;
 }
 
-
-// Simulates a 1-bit ALU with overflow
-// returns a bool array of size 3
-// Format of return [result, carryOut, overFlow]
-// Less function has not been implemented
-// This is created because the last ALU is structurally different than the others and includes overflow 
-bool* ALUOneBitWithOF(bool a, bool b, bool aInvert, bool bInvert, bool carryIn, bool* operation)
+//multiplies count random operand pairs in the radix with every adder on the given threads, checks the products
+//.... against native multiplication and reports the modelled delay and the gates of each adder together with
+//.... the pairs per second the simulation of it runs
+template <int Width>
+int adderStats(long long count, int radix, int threads)
 {
-   static bool result[3];
-   //use basic alu to get 
-   bool* tempResults = ALUOneBit(a, b, aInvert, bInvert, carryIn, operation);
-   result[0] = tempResults[0];
-   result[1] = tempResults[1];
-
-   //calculate overflow
-   result[2] = !(a != b) && (result[0] != b);
-   return result;
+    typedef typename RegisterWord<Width>::type Word;
+    cout << count << " " << Width << " bit operand pairs in radix " << radix << endl;
+    cout << setw(12) << "Adder" << setw(15) << "Critical path" << setw(16) << "Delay/multiply" << setw(10) << "Gates"
+         << setw(8) << "Wrong" << setw(16) << "Pairs/second" << endl;
+    long long allWrong = 0;
+    for (int a = 0; a < ADDER_COUNT; a++)
+    {
+        //per thread totals
+        vector<GateCounters> gates(threads, GateCounters{});
+        for (GateCounters& g : gates)
+            g.adder = Adder(a);
+        atomic<long long> wrong(0);
+        auto start = chrono::steady_clock::now();
+        parallelFor(count, threads, 1 << 12, [&](long long first, long long last, int worker)
+        {
+            long long mine = 0;
+            for (long long n = first; n < last; n++)
+            {
+                Word md = sweepOperand<Width>(n, 0);
+                Word mq = sweepOperand<Width>(n, 1);
+                Product<Width> product;
+                if (radix == 8)
+                    product = modifiedBooths<Width, 3>(unpackBits<Width>(md), unpackBits<Width>(mq), false, nullptr,
+                                                       &gates[worker]);
+                else if (radix == 4)
+                    product = modifiedBooths<Width, 2>(unpackBits<Width>(md), unpackBits<Width>(mq), false, nullptr,
+                                                       &gates[worker]);
+                else
+                {
+                    GateRegisters<Width> done = gateBooths(unpackBits<Width>(md), unpackBits<Width>(mq), &gates[worker]);
+                    product = {Word(packBits(done.ac)), Word(packBits(done.mq))};
+                }
+                Product<Width> native = nativeProduct<Width>(md, mq);
+                mine += product.high != native.high || product.low != native.low;
+            }
+            wrong += mine;
+        });
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        GateCounters total = {};
+        for (const GateCounters& g : gates)
+            total.add(g);
+        allWrong += wrong;
+        cout << setw(12) << ADDER_NAMES[a] << setw(15) << total.maxDelay << setw(16)
+             << (count > 0 ? double(total.delay) / count : 0) << setw(10) << (count > 0 ? double(total.gates) / count : 0)
+             << setw(8) << wrong << setw(16) << (seconds > 0 ? count / seconds : 0) << endl;
+    }
+    cout << "The critical path is the modelled delay of the AC adder in gate delays, the delay per multiply adds up"
+         << " every ALU evaluation of it (the counter's too) one after the other" << endl;
+    return allWrong == 0 ? 0 : 1;
 }
 
-//Currently bits 0-15 represent binary number with bit 0 being the lowest order bit
-// bit at result[16] is the overflow bit
-bool* ALU16Bit(bool* a, bool* b, bool aInv, bool bInv, bool* operation)
+// What the command line asked for
+struct Options
+{
+    Engine engine = ENGINE_GATE;
+    int radix = 2;
+    bool showCounts = false;        // --radix was given, print the counts after the table
+    long long crossCheckPairs = 0;
+    long long slicedPairs = 0;
+    long long radixPairs = 0;
+    int lanes = 64;
+    int width = 16;
+    bool batch = false;
+    std::string batchFile = "-";    // - reads the operand pairs from stdin
+    bool trace = false;             // --batch prints the table of every pair
+    int threads = defaultThreads(); // threads of the sweeps and --batch
+    bool verify = false;
+    long long verifyPairs = 0;      // 0 verifies every pair
+    bool sliced = false;            // --engine sliced, only for --verify
+    std::string progressFile;       // --resume, the progress of --verify
+    bool gates = false;             // --gates, count the gate-level cost of the multiplies
+    Adder adder = ADDER_RIPPLE;     // --adder, the adder of the gate-level ALU
+    long long adderPairs = 0;       // --adder-stats
+};
+
+//multiplies md * mq in the radix of the options and returns the product
+//print writes the table of steps, counts gets the iterations and ALU operations
+//mismatches counts the steps where the engines disagreed (radix 2 with --engine check)
+//with --gates, gates gets the cost of the multiply, radix 2 then runs on the gate-level engine even with --engine fast
+//.... and so it does with an --adder other than ripple, which the gate-level ALU picks from gates
+template <int Width>
+Product<Width> multiply(const Bits<Width>& md, const Bits<Width>& mq, const Options& options, bool print,
+                        BoothCounts& counts, int& mismatches, GateCounters& gates)
 {
-    static bool result[17]; //16 bit result plus overflow
-    bool overflow;
-    bool* tempResult;
+    gates.adder = options.adder;
+    GateCounters* counters = options.gates || options.adder != ADDER_RIPPLE ? &gates : nullptr;
+    if (options.radix == 8)
+        return modifiedBooths<Width, 3>(md, mq, print, &counts, counters);
+    if (options.radix == 4)
+        return modifiedBooths<Width, 2>(md, mq, print, &counts, counters);
+    Engine engine = counters != nullptr && options.engine == ENGINE_FAST ? ENGINE_GATE : options.engine;
+    BoothRegisters<Width> done = booths(md, mq, engine, print, &mismatches, &counts, counters);
+    return {done.ac, done.mq};
+}
 
-    //first carryIn is bInverse
-    bool carryIn = bInv;
+//writes the gate-level cost of multiplies multiplies in the radix, every line starting with prefix
+//the AC adder is width bits wide in radix 2 and has the guard bits of modifiedBooths in radix 4 and 8
+void printGateReport(const GateCounters& gates, long long multiplies, int width, int radix, const char* prefix)
+{
+    int chain = width + (radix == 8 ? 3 : (radix == 4 ? 2 : 0));
+    double per = multiplies > 0 ? 1.0 / multiplies : 0;
+    cout << prefix << "Gate evaluations: " << gates.gates << " (" << gates.gates * per << " per multiply) in "
+         << gates.evaluations << " ALU evaluations\n";
+    cout << prefix << "Carry depth: " << (gates.evaluations > 0 ? double(gates.carryDepth) / gates.evaluations : 0)
+         << " 1-bit ALUs on average, the longest ripple " << gates.maxCarryDepth << " of the " << chain
+         << " bit chain\n";
+    cout << prefix << "Register toggles: " << gates.toggles << " (" << gates.toggles * per << " per multiply)\n";
+    cout << prefix << "Adder: " << ADDER_NAMES[gates.adder] << ", a critical path of " << gates.maxDelay
+         << " gate delays, " << gates.delay * per << " per multiply with the ALU evaluations one after the other\n";
+}
 
-    //first 15 ALUs dont need overflow
-    for (int i = 0; i <15 ; i++)
+//reads one operand, a string of Width '0' and '1' characters or a decimal or 0x hex number
+//.... from -2^(Width - 1) to 2^Width - 1, returns false if it is neither
+template <int Width>
+bool parseOperand(const string& text, typename RegisterWord<Width>::type& operand)
+{
+    typedef typename RegisterWord<Width>::type Word;
+    if (text.size() == Width && text.find_first_not_of("01") == string::npos)
     {
-        tempResult = ALUOneBit(a[i], b[i], aInv, bInv, carryIn, operation);
-        result[i] = tempResult[0];
-        carryIn = tempResult[1];    
+        operand = Word(packBits(stringToBits<Width>(text)));
+        return true;
     }
-
-    tempResult = ALUOneBitWithOF(a[15], b[15], aInv, bInv, carryIn, operation);
-    result[15] = tempResult[0];
-    result[16] = tempResult[2];
-    return result;
+    if (text.empty())
+        return false;
+    char* end = nullptr;
+    errno = 0;
+    __int128 value = text[0] == '-' ? (__int128)strtoll(text.c_str(), &end, 0) : (__int128)strtoull(text.c_str(), &end, 0);
+    __int128 lowest = -((__int128)1 << (Width - 1));
+    __int128 highest = ((__int128)1 << Width) - 1;
+    if (errno != 0 || *end != '\0' || value < lowest || value > highest)
+        return false;
+    operand = Word(value);
+    return true;
 }
 
-//Currently bits 0-3 represent binary number with bit 0 being lower order bit
-//This is used to simulate the CPU Cycle Counter
-bool* ALU4Bit(bool* a, bool* b, bool aInv, bool bInv, bool* operation)
+//asks for two Width bit numbers and then performs Booth's on them in the given radix
+//.... each is read like an operand of --batch (see parseOperand), anything else is reported and nothing is run
+//the iterations and ALU operations are printed after the table when showCounts is set
+template <int Width>
+int run(const Options& options)
 {
-    bool result[4]; //16 bit result plus overflow
-    bool* tempResult;
-
-    //first carryIn is bInverse
-    bool carryIn = bInv;
-
-    
-    for (int i = 0; i < 4; i++)
+    typedef typename RegisterWord<Width>::type Word;
+    string inputString;
+    Word md = 0, mq = 0;
+    std::cout << "Enter " << Width << "bit MD: ";
+    if (!(cin >> inputString) || !parseOperand<Width>(inputString, md))
     {
-        tempResult = ALUOneBit(a[i], b[i], aInv, bInv, carryIn, operation);
-        result[i] = tempResult[0];
-        carryIn = tempResult[1];
+        cerr << "MD has to be " << Width << " binary digits or a decimal or 0x hex number that fits in " << Width
+             << " bits" << endl;
+        return 1;
     }
+    Bits<Width> opA = unpackBits<Width>(md);
 
-    return result;
+    std::cout << "Enter " << Width << "bit MQ: ";
+    if (!(cin >> inputString) || !parseOperand<Width>(inputString, mq))
+    {
+        cerr << "MQ has to be " << Width << " binary digits or a decimal or 0x hex number that fits in " << Width
+             << " bits" << endl;
+        return 1;
+    }
+    Bits<Width> opB = unpackBits<Width>(mq);
+
+    int mismatches = 0;
+    BoothCounts counts = {};
+    GateCounters gates = {};
+    multiply(opA, opB, options, true, counts, mismatches, gates);
+    if (options.showCounts)
+        std::cout << "Radix " << options.radix << ": " << counts.iterations << " iterations, " << counts.aluOperations
+                  << " ALU operations" << endl;
+    if (options.gates)
+        printGateReport(gates, 1, Width, options.radix, "");
+    return mismatches == 0 ? 0 : 1;
 }
 
-//Simulates Booths algorithm multiplying MD*MQ
-//stores the result in AC MQ
-void booths(static bool* opA,static bool* opB)
+//multiplies every operand pair of the stream, one "MD MQ" pair per line, blank lines and lines starting with # are
+//.... skipped. Writes a tab separated line per pair: the operands and the product in signed decimal, the cycles
+//.... (iterations of the cycle counter) and the add/subtract operations of the ALU
+//with trace the table of steps of every pair is printed before its line
+//with --gates every line also gets the gate evaluations, the longest carry ripple and the register toggles
+//.... of its multiply, and a report of the whole run follows the lines
+//returns 1 if a line could not be read or the engines disagreed
+template <int Width>
+int batch(istream& in, const Options& options)
 {
-   
-    bool* MD = opA;
-    bool* MQ = opB;
-   
-    bool mqv = false;
-    bool cycleCounter[4] = { true,true,true,true};
-
-
-    bool ac[16] = { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 };
-    bool* AC = ac;
-    
-    //Output header 
-    std::cout <<setw(14)<< "cycle-counter"<<setw(3)<<" | "<<setw(18)<< "MD"<<setw(3)<<" | "
-        << setw(18) << "AC" <<setw(3)<<" | "
-        << setw(18) << "MQ" <<setw(3)<<" | " 
-        << setw(5) << "MQ-1"<<setw(3)<<" | "<< "Comment" << endl;
-
-
-    //output initialization
-    std::cout << setw(11) << cycleCounter[3] << cycleCounter[2] << cycleCounter[1] << cycleCounter[0] << setw(3) << " | "
-        << setw(18)<<binaryToString(MD) << setw(3)<<" | " 
-        << setw(18)<<binaryToString(AC) << setw(3)<<" | " 
-        << setw(18)<<binaryToString(MQ) << setw(3)<<" | " 
-        << setw(5)<<mqv << setw(3)<<" | "<< "Initialize"<<endl;
-    int i = 0;
-    bool enteredLoop= false;
-    //16 iterations
-    while (!(enteredLoop && cycleCounter[0] && cycleCounter[1] && cycleCounter[2] && cycleCounter [3]))
+    typedef typename RegisterWord<Width>::type Word;
+    typedef typename make_signed<Word>::type Signed;
+    // One operand pair of the stream and what multiplying it gave
+    struct Pair
     {
-        i++;
-        enteredLoop = true;
-        //Add Case
-        if (!MQ[0] && mqv)                      
+        Word md;
+        Word mq;
+        Product<Width> product;
+        BoothCounts counts;
+        GateCounters gates;
+    };
+    //the pairs are read a block at a time and the block is multiplied on the threads, with trace one pair at a time
+    //.... on one thread so every table is followed by its line
+    const size_t blockSize = options.trace ? 1 : 1 << 16;
+    const int threads = options.trace ? 1 : options.threads;
+    vector<Pair> block;
+    vector<int> mismatches(threads, 0);
+    GateCounters total = {};
+    total.adder = options.adder;
+    long long multiplies = 0;
+    auto flush = [&]()
+    {
+        parallelFor(block.size(), threads, 1 << 10, [&](long long first, long long last, int worker)
         {
-            static bool op[2] = { true,false };
-            AC = ALU16Bit(AC, MD, 0, 0, op);    //add (AC <- AC + MD)
-            std::cout << setw(11) << cycleCounter[3] << cycleCounter[2] << cycleCounter[1] << cycleCounter[0] << setw(3) << " | "
-                << setw(18) << binaryToString(MD) << setw(3) << " | "
-                << setw(18) << binaryToString(AC) << setw(3) << " | "
-                << setw(18) << binaryToString(MQ) << setw(3) << " | "
-                << setw(5) << mqv << setw(3) << " | " << "AC <- AC + MD    ";
-
-        }
-        //Sub Case
-        else if (MQ[0] && !mqv)                 // Sub case
+            for (long long k = first; k < last; k++)
+                block[k].product = multiply(unpackBits<Width>(block[k].md), unpackBits<Width>(block[k].mq), options,
+                                            options.trace, block[k].counts, mismatches[worker], block[k].gates);
+        });
+        for (const Pair& pair : block)
         {
-            static bool op[2] = { true,false };
-            AC = ALU16Bit(AC, MD, 0, 1, op);    //sub (AC <- AC - MD
-            std::cout << setw(11) << cycleCounter[3] << cycleCounter[2] << cycleCounter[1] << cycleCounter[0] << setw(3) << " | "
-                << setw(18) << binaryToString(MD) << setw(3) << " | "
-                << setw(18) << binaryToString(AC) << setw(3) << " | "
-                << setw(18) << binaryToString(MQ) << setw(3) << " | "
-                << setw(5) << mqv << setw(3) << " | " << "AC <- AC - MD    ";
+            cout << int128ToString(Signed(pair.md)) << '\t' << int128ToString(Signed(pair.mq)) << '\t'
+                 << int128ToString(productValue(pair.product)) << '\t' << pair.counts.iterations << '\t'
+                 << pair.counts.aluOperations;
+            if (options.gates)
+                cout << '\t' << pair.gates.gates << '\t' << pair.gates.maxCarryDepth << '\t' << pair.gates.toggles;
+            cout << '\n';
+            total.add(pair.gates);
         }
-        // Do Nothing Case
-        else
+        multiplies += block.size();
+        block.clear();
+    };
+
+    cout << "md\tmq\tproduct\tcycles\tadd_sub" << (options.gates ? "\tgates\tcarry_depth\ttoggles" : "") << "\n";
+    string line;
+    int lineNumber = 0;
+    int bad = 0;
+    while (getline(in, line))
+    {
+        lineNumber++;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == string::npos || line[first] == '#')
+            continue;
+        istringstream fields(line);
+        string mdText, mqText, extra;
+        Pair pair = {};
+        if (!(fields >> mdText >> mqText) || (fields >> extra) || !parseOperand<Width>(mdText, pair.md)
+            || !parseOperand<Width>(mqText, pair.mq))
         {
-            std::cout << setw(11) << cycleCounter[3] << cycleCounter[2] << cycleCounter[1] << cycleCounter[0] << setw(3) << " | "
-                << setw(18) << binaryToString(MD) << setw(3) << " | "
-                << setw(18) << binaryToString(AC) << setw(3) << " | "
-                << setw(18) << binaryToString(MQ) << setw(3) << " | "
-                << setw(5) << mqv << setw(3) << " | " << "Do Nothing       ";
+            cerr << "Line " << lineNumber << " is not a pair of " << Width << " bit operands: " << line << endl;
+            bad++;
+            continue;
         }
-        cout << "Step: 1 | Iteration: " << i << endl;
+        block.push_back(pair);
+        if (block.size() == blockSize)
+            flush();
+    }
+    flush();
+    //the report of the whole run, as comment lines so the output still reads as a batch
+    if (options.gates)
+        printGateReport(total, multiplies, Width, options.radix, "# ");
+    cout.flush();
+    int disagreed = 0;
+    for (int m : mismatches)
+        disagreed += m;
+    return bad == 0 && disagreed == 0 ? 0 : 1;
+}
 
-        //shift bits (signed)
-        mqv = MQ[0];
-        for (int i = 1; i < 16; i++)
-        {
-            MQ[i - 1] = MQ[i];    
-        }
-        MQ[15] = AC[0];
-        for (int i = 1; i < 15; i++)
+//runs the mode picked on the command line at the given width
+template <int Width>
+int dispatch(const Options& options)
+{
+    if (options.verify)
+    {
+        VerifyEngine engine = options.sliced ? VERIFY_SLICED : (options.engine == ENGINE_FAST ? VERIFY_FAST : VERIFY_GATE);
+        return verify<Width>(options.verifyPairs, engine, options.radix, options.lanes, options.threads,
+                             options.progressFile, options.adder);
+    }
+    if (options.adderPairs > 0)
+        return adderStats<Width>(options.adderPairs, options.radix, options.threads);
+    if (options.radixPairs > 0)
+        return radixStats<Width>(options.radixPairs, options.threads);
+    if (options.crossCheckPairs > 0)
+        return crossCheck<Width>(options.crossCheckPairs, options.threads);
+    if (options.slicedPairs > 0)
+        return slicedCheck<Width>(options.slicedPairs, options.lanes, options.threads);
+    if (options.batch)
+    {
+        if (options.batchFile == "-")
+            return batch<Width>(cin, options);
+        ifstream file(options.batchFile);
+        if (!file)
         {
-            AC[i - 1] = AC[i];
+            cerr << "Could not open " << options.batchFile << endl;
+            return 1;
         }
-        //no need to sign extend from AC[14] since AC[14] == AC[15]
-
-        //Output after shifting
-        std::cout << setw(11) << cycleCounter[3] << cycleCounter[2] << cycleCounter[1] << cycleCounter[0] << setw(3) << " | "
-            << setw(18) << binaryToString(MD) << setw(3) << " | "
-            << setw(18) << binaryToString(AC) << setw(3) << " | "
-            << setw(18) << binaryToString(MQ) << setw(3) << " | "
-            << setw(5) << mqv << setw(3) << " | " << "Shift 1 Bit >>   Step: 2 | Iteration: "<< i << endl;
-        
-        //decrement cycle counter
-        bool one[4] = { true,false,false,false };
-        static bool op[2] = { true,false };
-        bool* temp = ALU4Bit(cycleCounter, one, false, true, op);
-        cycleCounter[0] = temp[0];
-        cycleCounter[1] = temp[1];
-        cycleCounter[2] = temp[2];
-        cycleCounter[3] = temp[3];
-    }//end of booths, The answer is in 
-
-    //Output final results
-    std::cout << "--------------------------------------------------------------------------------------" << endl;
-    std::cout << setw(14) << "DONE" << setw(3) << " | "
-        << setw(18) << binaryToString(MD) << setw(3) << " | "
-        << setw(18) << binaryToString(AC) << setw(3) << " | "
-        << setw(18) << binaryToString(MQ) << setw(3) << " | "
-        << setw(5) << mqv << setw(3) << " | " << "Final Result" << endl;
+        return batch<Width>(file, options);
+    }
+    return run<Width>(options);
 }
 
-
-//Converts a string to boolean array of size 16
-//has to flip the order so that result[0] has the lowest order bit
-bool* stringTo16Bits(string inputString)
+//reads the pair count of a sweep option, a whole positive number, returns false with a message if it is not
+static bool parseCount(const string& option, const char* text, long long& count)
 {
-    bool result[16];
-    for (int i = 0; i < 16; i++)
+    char* end = nullptr;
+    errno = 0;
+    count = strtoll(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || errno == ERANGE || count < 1)
     {
-        result[i] = (inputString.at(15-i) != '0');
-        
+        cerr << option << " needs a whole number of pairs of at least 1, not " << text << endl;
+        return false;
     }
-    return result;
+    return true;
 }
 
-//This drives the program. It asks for two 16 bit numbers and then performs Booth's on them
-int main()
+//This drives the program. It asks for two numbers of --width bits (16 by default) and then performs Booth's on them
+//--engine picks the engine the multiply runs on and --cross-check N compares the engines on N random pairs
+//--sliced N runs N random pairs on the bit-sliced engine with --lanes lanes per word
+//--width picks the operand width of all of them
+//--radix picks radix 2 Booth's or the radix 4 or 8 modified Booth's, --radix-stats N compares the three on N random pairs
+//--batch multiplies the operand pairs of a file or stdin without the table, --trace prints it anyway
+//--threads N spreads the sweeps and --batch over N threads
+//--verify [N] checks every pair or N random pairs against native multiplication, --resume FILE keeps its progress
+//--gates reports the gate-level cost of the multiplies
+//--adder picks the adder of the gate-level ALU, --adder-stats N compares the adders on N random pairs
+int main(int argc, char* argv[])
 {
-    string inputString;
-    std::cout << "Enter 16bit MD: ";
-    cin >> inputString;
-    bool * tempArray = stringTo16Bits(inputString);
-    static bool opA[16];
-    for (int i = 0; i < 16; i++)
-        opA[i] = tempArray[i];
-    
-    std::cout << "Enter 16bit MQ: ";
-    cin >> inputString;
-    tempArray = stringTo16Bits(inputString);
-    static bool opB[16];
-    for (int i = 0; i < 16; i++)
-        opB[i] = tempArray[i];
+    std::ios::sync_with_stdio(false);
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        string option = argv[i];
+        if (option == "--cross-check" && i + 1 < argc)
+        {
+            if (!parseCount(option, argv[++i], options.crossCheckPairs))
+                return 1;
+            continue;
+        }
+        if (option == "--sliced" && i + 1 < argc)
+        {
+            if (!parseCount(option, argv[++i], options.slicedPairs))
+                return 1;
+            continue;
+        }
+        if (option == "--lanes" && i + 1 < argc)
+        {
+            options.lanes = atoi(argv[++i]);
+            if (options.lanes != 64 && options.lanes != 256 && options.lanes != 512)
+            {
+                cerr << "--lanes has to be 64, 256 or 512" << endl;
+                return 1;
+            }
+            continue;
+        }
+        if (option == "--width" && i + 1 < argc)
+        {
+            options.width = atoi(argv[++i]);
+            if (options.width != 8 && options.width != 16 && options.width != 32 && options.width != 64)
+            {
+                cerr << "--width has to be 8, 16, 32 or 64" << endl;
+                return 1;
+            }
+            continue;
+        }
+        if (option == "--radix" && i + 1 < argc)
+        {
+            options.radix = atoi(argv[++i]);
+            options.showCounts = true;
+            if (options.radix != 2 && options.radix != 4 && options.radix != 8)
+            {
+                cerr << "--radix has to be 2, 4 or 8" << endl;
+                return 1;
+            }
+            continue;
+        }
+        if (option == "--radix-stats" && i + 1 < argc)
+        {
+            if (!parseCount(option, argv[++i], options.radixPairs))
+                return 1;
+            continue;
+        }
+        if (option == "--batch")
+        {
+            options.batch = true;
+            if (i + 1 < argc && (argv[i + 1][0] != '-' || string(argv[i + 1]) == "-"))
+                options.batchFile = argv[++i];
+            continue;
+        }
+        if (option == "--threads" && i + 1 < argc)
+        {
+            options.threads = atoi(argv[++i]);
+            if (options.threads < 1)
+            {
+                cerr << "--threads has to be at least 1" << endl;
+                return 1;
+            }
+            continue;
+        }
+        if (option == "--verify")
+        {
+            options.verify = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-' && !parseCount(option, argv[++i], options.verifyPairs))
+                return 1;
+            continue;
+        }
+        if (option == "--resume" && i + 1 < argc)
+        {
+            options.progressFile = argv[++i];
+            continue;
+        }
+        if (option == "--gates")
+        {
+            options.gates = true;
+            continue;
+        }
+        if (option == "--adder" && i + 1 < argc)
+        {
+            string name = argv[++i];
+            int adder = 0;
+            while (adder < ADDER_COUNT && name != ADDER_NAMES[adder])
+                adder++;
+            if (adder == ADDER_COUNT)
+            {
+                cerr << "Unknown adder " << name << ", use ripple, lookahead, select or kogge-stone" << endl;
+                return 1;
+            }
+            options.adder = Adder(adder);
+            continue;
+        }
+        if (option == "--adder-stats" && i + 1 < argc)
+        {
+            if (!parseCount(option, argv[++i], options.adderPairs))
+                return 1;
+            continue;
+        }
+        if (option == "--trace")
+        {
+            options.trace = true;
+            continue;
+        }
+        if (option == "--engine" && i + 1 < argc)
+        {
+            string name = argv[++i];
+            if (name == "gate")
+                options.engine = ENGINE_GATE;
+            else if (name == "fast")
+                options.engine = ENGINE_FAST;
+            else if (name == "check")
+                options.engine = ENGINE_CHECK;
+            else if (name == "sliced")
+                options.sliced = true;
+            else
+            {
+                cerr << "Unknown engine " << name << ", use gate, fast, check or sliced" << endl;
+                return 1;
+            }
+            continue;
+        }
+        cerr << "Usage: [--width 8|16|32|64] [--engine gate|fast|check] [--radix 2|4|8] [--cross-check N]"
+             << " [--sliced N [--lanes 64|256|512]] [--radix-stats N] [--batch [FILE|-] [--trace]]"
+             << " [--threads N] [--verify [N] [--resume FILE]]"
+             << " [--gates] [--adder ripple|lookahead|select|kogge-stone] [--adder-stats N]" << endl;
+        return 1;
+    }
+    if (options.sliced && (!options.verify || options.radix != 2))
+    {
+        cerr << "--engine sliced only runs with --verify in radix 2, see --sliced for the bit-sliced sweep" << endl;
+        return 1;
+    }
+    if (options.verify && options.radix != 2 && options.engine != ENGINE_GATE)
+    {
+        cerr << "--verify runs radix " << options.radix << " on the gate-level modified Booth's, use --engine gate" << endl;
+        return 1;
+    }
+    if (options.adder != ADDER_RIPPLE && options.verify && options.radix == 2
+        && (options.sliced || options.engine == ENGINE_FAST))
+    {
+        cerr << "--adder builds the gate-level ALU, verify it with --engine gate" << endl;
+        return 1;
+    }
 
-    booths(opA,  opB);
+    switch (options.width)
+    {
+        case 8: return dispatch<8>(options);
+        case 32: return dispatch<32>(options);
+        case 64: return dispatch<64>(options);
+        default: return dispatch<16>(options);
+    }
 }
-
-
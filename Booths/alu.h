@@ -0,0 +1,436 @@
+/* Gate-level ALU of the Booth's multiplier
+ * The ALU is built the way the hardware is: a 1-bit full adder, a 1-bit ALU around it with input inverters and a
+ * .... 4 way MUX picking AND, OR or the sum, and a ripple carry chain of Width 1-bit ALUs whose last one also
+ * .... computes overflow. Numbers are Bits, bit 0 is the lowest order bit.
+ * Width is a template parameter, every function is constexpr and the loops have constant bounds so each width
+ * .... is unrolled into a straight chain of gates.
+ * ALU optionally counts its hardware cost into GateCounters, the proxies for power and latency:
+ * .... the gates evaluated (GATES_PER_ALU_BIT per 1-bit ALU and OVERFLOW_GATES for the last one),
+ * .... and the carry depth, the longest run of 1-bit ALUs a carry ripples through before it settles.
+ * .... A carry starts where both adder inputs are 1 (or at the carry in) and travels on while they differ.
+ * .... Toggles, the register bits a step changes, are counted by the engines driving the ALU.
+ * The carries can come from other adder architectures (Adder, picked by GateCounters::adder): a tree of carry
+ * .... lookahead units, carry-select blocks or a Kogge-Stone parallel prefix. They add the same, the 1-bit ALUs
+ * .... only take their carry in from the carry network instead of from the ALU below. What differs is the gates
+ * .... evaluated and the modelled delay of the ALU (adderDelay), its critical path in gate delays.
+ */
+#ifndef ALU_H
+#define ALU_H
+
+#include <string>
+
+// A Width bit number, bit 0 is the lowest order bit
+template <int Width>
+struct Bits
+{
+    bool bit[Width];
+
+    constexpr bool& operator[](int i) { return bit[i]; }
+    constexpr bool operator[](int i) const { return bit[i]; }
+};
+
+// The select lines of the ALU's 4 way MUX, operation[0] and operation[1]
+struct ALUOperation
+{
+    bool select[2];
+};
+
+constexpr ALUOperation ALU_AND = {{false, false}};    // 00
+constexpr ALUOperation ALU_OR = {{false, true}};      // 01
+constexpr ALUOperation ALU_ADD = {{true, false}};     // 10
+
+// The outputs of a 1-bit full adder
+struct AdderOut
+{
+    bool sum;
+    bool carryOut;
+};
+
+// The outputs of a 1-bit ALU, overflow is only computed by the last ALU of a chain (ALUOneBitWithOF)
+struct ALUOut
+{
+    bool result;
+    bool carryOut;
+    bool overflow;
+};
+
+// The outputs of a Width bit ALU
+template <int Width>
+struct ALUResult
+{
+    Bits<Width> result;
+    bool overflow;
+};
+
+// Gates of a 1-bit ALU: the 2 inverters, AND, OR, the full adder (2 XOR, 2 AND, 1 OR) and the 4 way MUX
+const int GATES_PER_ALU_BIT = 10;
+// Gates of the overflow logic of the last 1-bit ALU (XNOR, XOR, AND)
+const int OVERFLOW_GATES = 3;
+
+// Gates of the full adder making the carry out (2 AND, 1 OR), the carry networks replace them
+const int CARRY_GATES = 3;
+
+// The adder architectures the ALU's carries can come from
+enum Adder
+{
+    ADDER_RIPPLE,       // every 1-bit ALU passes its carry out to the next one
+    ADDER_LOOKAHEAD,    // a tree of LOOKAHEAD_GROUP bit carry lookahead units
+    ADDER_SELECT,       // SELECT_BLOCK bit ripple blocks for a carry in of 0 and of 1, the carry into the block picks one
+    ADDER_KOGGE_STONE   // a Kogge-Stone parallel prefix of the generate and propagate signals
+};
+
+const int ADDER_COUNT = 4;
+const char* const ADDER_NAMES[ADDER_COUNT] = {"ripple", "lookahead", "select", "kogge-stone"};
+const int LOOKAHEAD_GROUP = 4;
+const int SELECT_BLOCK = 4;
+
+// The hardware cost of the ALU evaluations of a multiply or a whole run
+struct GateCounters
+{
+    long long gates;            // gate evaluations
+    long long evaluations;      // evaluations of a whole ALU (of any width)
+    long long carryDepth;       // the carry depths of all the evaluations added up
+    int maxCarryDepth;          // the longest carry ripple of any evaluation, the critical path that was exercised
+    long long toggles;          // register bits the steps changed
+    long long delay;            // the modelled delays (adderDelay) of all the evaluations added up
+    int maxDelay;               // the longest modelled delay of any evaluation, the widest ALU's critical path
+    Adder adder = ADDER_RIPPLE; // the adder the ALU evaluations are built with, not added up
+
+    void add(const GateCounters& other)
+    {
+        gates += other.gates;
+        evaluations += other.evaluations;
+        carryDepth += other.carryDepth;
+        maxCarryDepth = maxCarryDepth > other.maxCarryDepth ? maxCarryDepth : other.maxCarryDepth;
+        toggles += other.toggles;
+        delay += other.delay;
+        maxDelay = maxDelay > other.maxDelay ? maxDelay : other.maxDelay;
+    }
+};
+
+//returns the number of bits needed to count down from Width - 1, the width of the cycle counter
+template <int Width>
+constexpr int counterBits()
+{
+    int bits = 0;
+    while ((1 << bits) < Width)
+        bits++;
+    return bits;
+}
+
+//Simulates a 1-bit full adder
+constexpr AdderOut OneBitFullAdder(bool a, bool b, bool carryIn)
+{
+    AdderOut out = {};
+    out.sum = (a != b) != carryIn;
+    out.carryOut = (a && b) || ((a != b) && carryIn);
+    return out;
+}
+
+// Simulates a 1-bit ALU
+// Less function has not been implemented
+constexpr ALUOut ALUOneBit(bool a, bool b, bool aInvert, bool bInvert, bool carryIn, ALUOperation operation)
+{
+    ALUOut out = {};
+    //check inversion
+    if (aInvert) a = !a;
+    if (bInvert) b = !b;
+    //perform all operations
+    bool op0 = a && b;
+    bool op1 = a || b;
+    AdderOut adder = OneBitFullAdder(a, b, carryIn);
+    out.carryOut = adder.carryOut;
+
+    //Selected with 4 way MUX
+    if (!operation.select[0] && !operation.select[1])     // AND case 00
+        out.result = op0;
+    else if (!operation.select[0] && operation.select[1]) // OR case 01
+        out.result = op1;
+    else if (operation.select[0] && !operation.select[1]) //ADD case 10
+        out.result = adder.sum;
+    return out;
+}
+
+// Simulates a 1-bit ALU with overflow
+// This is created because the last ALU is structurally different than the others and includes overflow
+constexpr ALUOut ALUOneBitWithOF(bool a, bool b, bool aInvert, bool bInvert, bool carryIn, ALUOperation operation)
+{
+    //use basic alu to get the result and carry out
+    ALUOut out = ALUOneBit(a, b, aInvert, bInvert, carryIn, operation);
+
+    //calculate overflow on the adder's inputs, after the inverters
+    //the operands have the same sign and the result does not
+    if (aInvert) a = !a;
+    if (bInvert) b = !b;
+    out.overflow = (a == b) && (out.result != b);
+    return out;
+}
+
+//the modelled delay of a width bit ALU built with the adder, in gate delays along its critical path:
+//.... the input inverter, the generate and propagate gates, the carries, the sum XOR and the 4 way MUX
+//every gate takes one delay whatever its fan-in (the unit gate model), an AND-OR and a MUX take two
+constexpr int adderDelay(Adder adder, int width)
+{
+    int levels = 0;
+    if (adder == ADDER_LOOKAHEAD)
+    {
+        for (int n = width; n > 1; n = (n + LOOKAHEAD_GROUP - 1) / LOOKAHEAD_GROUP)
+            levels++;
+        //up the tree to the group generates below the top one, then the carries back down every level
+        return 2 + 2 * (levels - 1) + 2 * levels + 3;
+    }
+    if (adder == ADDER_KOGGE_STONE)
+    {
+        for (int d = 1; d < width; d *= 2)
+            levels++;
+        return 2 + 2 * levels + 3;
+    }
+    int blocks = (width + SELECT_BLOCK - 1) / SELECT_BLOCK;
+    if (adder == ADDER_SELECT && blocks > 1)
+        //the first block ripples, the carry into every later block picks its carry out, the last one its carries
+        return 2 + 2 * SELECT_BLOCK + 2 * (blocks - 2) + 2 + 3;
+    return 2 + 2 * (width - 1) + 3;
+}
+
+//the run of 1-bit ALUs a carry has rippled through after a 1-bit ALU that generates or propagates a carry
+constexpr int carryChain(int chain, bool generate, bool propagate, bool carryIn)
+{
+    return generate ? 1 : (propagate && carryIn ? chain + 1 : 0);
+}
+
+//counts one evaluation of an ALU into counters
+constexpr void countEvaluation(GateCounters& counters, long long gates, int longest, int delay)
+{
+    counters.gates += gates;
+    counters.evaluations++;
+    counters.carryDepth += longest;
+    counters.maxCarryDepth = longest > counters.maxCarryDepth ? longest : counters.maxCarryDepth;
+    counters.delay += delay;
+    counters.maxDelay = delay > counters.maxDelay ? delay : counters.maxDelay;
+}
+
+//The carry networks, from the generate and propagate signals of the Width bits and the carry in they set
+//.... carry[i] to the carry into bit i and carry[Width] to the carry out, and return the gates they evaluated
+
+//a tree of carry lookahead units, each takes the generate and propagate of up to LOOKAHEAD_GROUP nodes below it
+//.... and gives their group generate and propagate to the level above, and the carries into its nodes back down
+//a unit's carries and group generate are sums of products, carry i needs i + 1 gates and the generate one per node
+template <int Width>
+constexpr int lookaheadCarries(const bool* generate, const bool* propagate, bool carryIn, bool* carry)
+{
+    //level 0 are the bits, 6 levels cover 1024 bits
+    bool g[6][Width] = {}, p[6][Width] = {}, in[6][Width] = {};
+    int size[6] = {Width};
+    int levels = 0, gates = 0;
+    for (int i = 0; i < Width; i++)
+    {
+        g[0][i] = generate[i];
+        p[0][i] = propagate[i];
+    }
+    for (; size[levels] > 1; levels++)
+    {
+        size[levels + 1] = (size[levels] + LOOKAHEAD_GROUP - 1) / LOOKAHEAD_GROUP;
+        for (int k = 0; k < size[levels + 1]; k++)
+        {
+            bool groupG = false, groupP = true;
+            for (int j = k * LOOKAHEAD_GROUP; j < size[levels] && j < (k + 1) * LOOKAHEAD_GROUP; j++)
+            {
+                groupG = g[levels][j] || (p[levels][j] && groupG);
+                groupP = groupP && p[levels][j];
+                gates++;
+            }
+            g[levels + 1][k] = groupG;
+            p[levels + 1][k] = groupP;
+            gates++;
+        }
+    }
+    in[levels][0] = carryIn;
+    for (int l = levels; l > 0; l--)
+        for (int k = 0; k < size[l]; k++)
+        {
+            bool c = in[l][k];
+            for (int j = k * LOOKAHEAD_GROUP; j < size[l - 1] && j < (k + 1) * LOOKAHEAD_GROUP; j++)
+            {
+                in[l - 1][j] = c;
+                c = g[l - 1][j] || (p[l - 1][j] && c);
+                if (j > k * LOOKAHEAD_GROUP)
+                    gates += j - k * LOOKAHEAD_GROUP + 1;
+            }
+        }
+    for (int i = 0; i < Width; i++)
+        carry[i] = in[0][i];
+    carry[Width] = g[levels][0] || (p[levels][0] && carryIn);
+    return gates + 2;
+}
+
+//blocks of SELECT_BLOCK bits, the first ripples from the carry in and every other one ripples twice,
+//.... for a carry in of 0 and of 1, and a MUX on the carry into the block picks the carries and the carry out
+template <int Width>
+constexpr int selectCarries(const bool* generate, const bool* propagate, bool carryIn, bool* carry)
+{
+    int gates = 0;
+    bool blockIn = carryIn;
+    for (int i = 0; i < Width && i < SELECT_BLOCK; i++)
+    {
+        carry[i] = blockIn;
+        blockIn = generate[i] || (propagate[i] && blockIn);
+        gates += CARRY_GATES;
+    }
+    for (int base = SELECT_BLOCK; base < Width; base += SELECT_BLOCK)
+    {
+        bool zero = false, one = true;
+        for (int i = base; i < Width && i < base + SELECT_BLOCK; i++)
+        {
+            carry[i] = blockIn ? one : zero;
+            zero = generate[i] || (propagate[i] && zero);
+            one = generate[i] || (propagate[i] && one);
+            gates += 2 * CARRY_GATES + 1;
+        }
+        blockIn = blockIn ? one : zero;
+        gates++;
+    }
+    carry[Width] = blockIn;
+    return gates;
+}
+
+//a Kogge-Stone parallel prefix, node 0 is the carry in and node i + 1 bit i. Every level combines each node with
+//.... the one d below it (d = 1, 2, 4 ...) until node i covers everything below it and is the carry into bit i
+//a node whose span reaches the carry in needs no propagate any more, 2 gates (gray cell) instead of 3 (black cell)
+template <int Width>
+constexpr int koggeStoneCarries(const bool* generate, const bool* propagate, bool carryIn, bool* carry)
+{
+    bool g[Width + 1] = {}, p[Width + 1] = {};
+    g[0] = carryIn;
+    for (int i = 0; i < Width; i++)
+    {
+        g[i + 1] = generate[i];
+        p[i + 1] = propagate[i];
+    }
+    int gates = 0;
+    for (int d = 1; d <= Width; d *= 2)
+        //from the top down so node i - d still holds the level below
+        for (int i = Width; i >= d; i--)
+        {
+            g[i] = g[i] || (p[i] && g[i - d]);
+            if (i >= 2 * d)
+                p[i] = p[i] && p[i - d];
+            gates += i >= 2 * d ? 3 : 2;
+        }
+    for (int i = 0; i <= Width; i++)
+        carry[i] = g[i];
+    return gates;
+}
+
+//Simulates a Width bit ALU whose 1-bit ALUs take their carries from the carry network of counters.adder
+template <int Width>
+constexpr ALUResult<Width> carryNetworkALU(const Bits<Width>& a, const Bits<Width>& b, bool aInv, bool bInv,
+                                           ALUOperation operation, GateCounters& counters)
+{
+    //generate is the 1-bit ALU's AND and propagate the first XOR of its adder
+    bool generate[Width] = {}, propagate[Width] = {}, carry[Width + 1] = {};
+    for (int i = 0; i < Width; i++)
+    {
+        bool aBit = a[i] != aInv, bBit = b[i] != bInv;
+        generate[i] = aBit && bBit;
+        propagate[i] = aBit != bBit;
+    }
+    int network = counters.adder == ADDER_LOOKAHEAD ? lookaheadCarries<Width>(generate, propagate, bInv, carry)
+                : counters.adder == ADDER_SELECT    ? selectCarries<Width>(generate, propagate, bInv, carry)
+                                                    : koggeStoneCarries<Width>(generate, propagate, bInv, carry);
+
+    ALUResult<Width> out = {};
+    int chain = 0;
+    int longest = 0;
+    for (int i = 0; i < Width - 1; i++)
+    {
+        out.result[i] = ALUOneBit(a[i], b[i], aInv, bInv, carry[i], operation).result;
+        chain = carryChain(chain, generate[i], propagate[i], carry[i]);
+        longest = chain > longest ? chain : longest;
+    }
+    ALUOut last = ALUOneBitWithOF(a[Width - 1], b[Width - 1], aInv, bInv, carry[Width - 1], operation);
+    out.result[Width - 1] = last.result;
+    out.overflow = last.overflow;
+    chain = carryChain(chain, generate[Width - 1], propagate[Width - 1], carry[Width - 1]);
+    longest = chain > longest ? chain : longest;
+    countEvaluation(counters, Width * (GATES_PER_ALU_BIT - CARRY_GATES) + network + OVERFLOW_GATES, longest,
+                    adderDelay(counters.adder, Width));
+    return out;
+}
+
+//Simulates a Width bit ALU, a ripple carry chain of 1-bit ALUs
+//the first carryIn is bInv so inverting b and adding subtracts
+//counters (if given) gets the gates evaluated, the carry depth and the modelled delay
+//.... and picks the adder, without counters it is the ripple carry chain
+template <int Width>
+constexpr ALUResult<Width> ALU(const Bits<Width>& a, const Bits<Width>& b, bool aInv, bool bInv, ALUOperation operation,
+                               GateCounters* counters = nullptr)
+{
+    if (counters != nullptr && counters->adder != ADDER_RIPPLE)
+        return carryNetworkALU(a, b, aInv, bInv, operation, *counters);
+    ALUResult<Width> out = {};
+    bool carryIn = bInv;
+    //the 1-bit ALUs the carry into the next one has rippled through
+    int chain = 0;
+    int longest = 0;
+
+    //first Width - 1 ALUs dont need overflow
+#pragma GCC unroll 64
+    for (int i = 0; i < Width - 1; i++)
+    {
+        ALUOut bit = ALUOneBit(a[i], b[i], aInv, bInv, carryIn, operation);
+        out.result[i] = bit.result;
+        if (counters != nullptr)
+        {
+            bool aBit = a[i] != aInv, bBit = b[i] != bInv;
+            chain = carryChain(chain, aBit && bBit, aBit != bBit, carryIn);
+            longest = chain > longest ? chain : longest;
+        }
+        carryIn = bit.carryOut;
+    }
+
+    ALUOut last = ALUOneBitWithOF(a[Width - 1], b[Width - 1], aInv, bInv, carryIn, operation);
+    out.result[Width - 1] = last.result;
+    out.overflow = last.overflow;
+    if (counters != nullptr)
+    {
+        bool aBit = a[Width - 1] != aInv, bBit = b[Width - 1] != bInv;
+        chain = carryChain(chain, aBit && bBit, aBit != bBit, carryIn);
+        longest = chain > longest ? chain : longest;
+        countEvaluation(*counters, Width * GATES_PER_ALU_BIT + OVERFLOW_GATES, longest, adderDelay(ADDER_RIPPLE, Width));
+    }
+    return out;
+}
+
+//the number of bits that differ between a and b
+template <int Width>
+constexpr int changedBits(const Bits<Width>& a, const Bits<Width>& b)
+{
+    int changed = 0;
+    for (int i = 0; i < Width; i++)
+        changed += a[i] != b[i];
+    return changed;
+}
+
+//Since numbers are stores with the lowest bit in the 0's place
+//I need to print starting at the higher order bit.
+template <int Width>
+std::string binaryToString(const Bits<Width>& binaryNumber)
+{
+    std::string result = "";
+    for (int i = 0; i < Width; i++)
+        result.append(1, binaryNumber[Width - 1 - i] ? '1' : '0');
+    return result;
+}
+
+//Converts a string of Width '0' and '1' characters into Bits
+//has to flip the order so that result[0] has the lowest order bit
+template <int Width>
+Bits<Width> stringToBits(const std::string& inputString)
+{
+    Bits<Width> result = {};
+    for (int i = 0; i < Width; i++)
+        result[i] = (inputString.at(Width - 1 - i) != '0');
+    return result;
+}
+
+#endif
@@ -0,0 +1,831 @@
+/* Booth's multiplication of two Width bit numbers, MD * MQ with the product left in AC MQ
+ * Every iteration looks at MQ[0] and the bit shifted out before it (MQ-1)
+ * .... 01 adds MD to AC, 10 subtracts it and 00 or 11 do nothing, then AC MQ MQ-1 shift right one bit
+ * .... arithmetically. An add or subtract can overflow AC, the ALU's overflow bit is kept until the shift
+ * .... and then the true sign of the sum, AC[Width - 1] flipped, is what shifts in at the top, and the cycle
+ * .... counter, which starts with all its counterBits<Width>() bits set, counts down.
+ * .... The multiply is done when the counter is back to all ones, after Width iterations.
+ * There are three engines computing exactly the same registers
+ * .... the gate-level engine (GateRegisters) runs the ALU chain of alu.h, it is the reference
+ * .... the fast engine (BoothRegisters) does AC +- MD, the shift and the counter with word arithmetic
+ * .... the bit-sliced engine (slicedBooths) runs the gates of the reference on a word of operand pairs at once
+ * Width is 8, 16, 32 or 64, every engine is a template over it and the gate-level and fast engines are constexpr
+ */
+#ifndef BOOTHS_H
+#define BOOTHS_H
+
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "alu.h"
+
+// The unsigned word holding a Width bit register
+template <int Width> struct RegisterWord;
+template <> struct RegisterWord<8> { typedef uint8_t type; };
+template <> struct RegisterWord<16> { typedef uint16_t type; };
+template <> struct RegisterWord<32> { typedef uint32_t type; };
+template <> struct RegisterWord<64> { typedef uint64_t type; };
+
+// What an iteration does to AC, picked by MQ[0] and MQ-1
+enum BoothAction
+{
+    BOOTH_NOTHING,
+    BOOTH_ADD,          // 01, AC <- AC + MD
+    BOOTH_SUBTRACT      // 10, AC <- AC - MD
+};
+
+constexpr BoothAction boothAction(bool low, bool previous)
+{
+    return !low && previous ? BOOTH_ADD : (low && !previous ? BOOTH_SUBTRACT : BOOTH_NOTHING);
+}
+
+// What a multiply cost, an iteration is one ALU step and one shift
+struct BoothCounts
+{
+    int iterations;
+    int aluOperations;      // the adds and subtracts of AC, and the 3MD of radix 8 (see modifiedBooths)
+};
+
+// -- Gate-level engine --
+template <int Width>
+struct GateRegisters
+{
+    Bits<Width> md;
+    Bits<Width> ac;
+    Bits<Width> mq;
+    bool mqv;
+    bool overflow;          // the ALU's overflow out of the last add or subtract, cleared by the shift
+    Bits<counterBits<Width>()> cycleCounter;
+};
+
+template <int Width>
+constexpr GateRegisters<Width> gateStart(const Bits<Width>& md, const Bits<Width>& mq)
+{
+    GateRegisters<Width> r = {md, {}, mq, false, false, {}};
+    for (int i = 0; i < counterBits<Width>(); i++)
+        r.cycleCounter[i] = true;
+    return r;
+}
+
+//AC <- AC + MD or AC <- AC - MD on the ALU
+//gates (if given) gets the ALU's cost and the register bits that toggled, as for every step below
+template <int Width>
+constexpr void gateAddSub(GateRegisters<Width>& r, bool subtract, GateCounters* gates = nullptr)
+{
+    ALUResult<Width> sum = ALU(r.ac, r.md, false, subtract, ALU_ADD, gates);
+    if (gates != nullptr)
+        gates->toggles += changedBits(r.ac, sum.result) + (r.overflow != sum.overflow);
+    r.ac = sum.result;
+    r.overflow = sum.overflow;
+}
+
+//shift bits (signed)
+template <int Width>
+constexpr void gateShift(GateRegisters<Width>& r, GateCounters* gates = nullptr)
+{
+    GateRegisters<Width> before = r;
+    r.mqv = r.mq[0];
+    for (int i = 1; i < Width; i++)
+        r.mq[i - 1] = r.mq[i];
+    r.mq[Width - 1] = r.ac[0];
+    for (int i = 1; i < Width; i++)
+        r.ac[i - 1] = r.ac[i];
+    //sign extend, if the sum overflowed AC[Width - 1] is the opposite of its sign
+    r.ac[Width - 1] = r.ac[Width - 1] != r.overflow;
+    r.overflow = false;
+    if (gates != nullptr)
+        gates->toggles += changedBits(before.ac, r.ac) + changedBits(before.mq, r.mq) + (before.mqv != r.mqv)
+                          + (before.overflow != r.overflow);
+}
+
+//decrement cycle counter, the ALU adds 1 inverted with a carry in of 1
+template <int Width>
+constexpr void gateDecrement(GateRegisters<Width>& r, GateCounters* gates = nullptr)
+{
+    Bits<counterBits<Width>()> one = {};
+    one[0] = true;
+    Bits<counterBits<Width>()> counter = ALU(r.cycleCounter, one, false, true, ALU_ADD, gates).result;
+    if (gates != nullptr)
+        gates->toggles += changedBits(r.cycleCounter, counter);
+    r.cycleCounter = counter;
+}
+
+template <int Width>
+constexpr bool counterIsFull(const GateRegisters<Width>& r)
+{
+    bool full = true;
+    for (int i = 0; i < counterBits<Width>(); i++)
+        full = full && r.cycleCounter[i];
+    return full;
+}
+
+//multiplies md * mq on the gate-level engine and returns the final registers, gates (if given) gets the cost
+template <int Width>
+constexpr GateRegisters<Width> gateBooths(const Bits<Width>& md, const Bits<Width>& mq, GateCounters* gates = nullptr)
+{
+    GateRegisters<Width> r = gateStart(md, mq);
+    do
+    {
+        BoothAction action = boothAction(r.mq[0], r.mqv);
+        if (action != BOOTH_NOTHING)
+            gateAddSub(r, action == BOOTH_SUBTRACT, gates);
+        gateShift(r, gates);
+        gateDecrement(r, gates);
+    } while (!counterIsFull(r));
+    return r;
+}
+
+// -- Fast engine --
+// The registers of the multiplier packed into words, bit i of a word is element i of the gate-level Bits
+// .... the fast engine does AC +- MD, the shift and the cycle counter decrement with word arithmetic
+// .... instead of the ALU chain, so a multiply costs a few dozen instructions instead of thousands of gates
+template <int Width>
+struct BoothRegisters
+{
+    typedef typename RegisterWord<Width>::type Word;
+    Word md;
+    Word ac;
+    Word mq;
+    bool mqv;
+    bool overflow;          // the overflow of the last add or subtract, cleared by the shift
+    uint8_t cycleCounter;   // counterBits<Width>() bits, starts with all of them set
+
+    static constexpr uint8_t fullCounter = (1u << counterBits<Width>()) - 1;
+};
+
+//packs Bits into a word, bit 0 is the lowest order bit
+template <int Width>
+constexpr uint64_t packBits(const Bits<Width>& bits)
+{
+    uint64_t word = 0;
+    for (int i = 0; i < Width; i++)
+        word |= uint64_t(bits[i]) << i;
+    return word;
+}
+
+template <int Width>
+constexpr Bits<Width> unpackBits(uint64_t word)
+{
+    Bits<Width> bits = {};
+    for (int i = 0; i < Width; i++)
+        bits[i] = (word >> i) & 1;
+    return bits;
+}
+
+//the gate-level registers packed the way the fast engine keeps them
+template <int Width>
+constexpr BoothRegisters<Width> packRegisters(const GateRegisters<Width>& r)
+{
+    typedef typename BoothRegisters<Width>::Word Word;
+    return {Word(packBits(r.md)), Word(packBits(r.ac)), Word(packBits(r.mq)), r.mqv, r.overflow,
+            uint8_t(packBits(r.cycleCounter))};
+}
+
+template <int Width>
+constexpr BoothRegisters<Width> fastStart(typename RegisterWord<Width>::type md, typename RegisterWord<Width>::type mq)
+{
+    return {md, 0, mq, false, false, BoothRegisters<Width>::fullCounter};
+}
+
+//AC <- AC + MD or AC <- AC - MD, the ALU adds MD inverted with a carry in of 1 to subtract
+//the sum wraps around at Width bits as the ripple carry chain does, overflow is set as the ALU sets it:
+//.... AC and the (inverted) MD have the same sign and the sum does not
+template <int Width>
+constexpr void fastAddSub(BoothRegisters<Width>& r, bool subtract)
+{
+    typedef typename BoothRegisters<Width>::Word Word;
+    const Word sign = Word(Word(1) << (Width - 1));
+    Word operand = subtract ? Word(~r.md) : r.md;
+    Word sum = Word(r.ac + operand + (subtract ? 1u : 0u));
+    r.overflow = (Word(~(r.ac ^ operand) & (sum ^ operand)) & sign) != 0;
+    r.ac = sum;
+}
+
+//shifts AC MQ mqv right by one bit, the same transfer as the gate-level shift (gateShift)
+//.... MQ[0] goes to mqv, AC[0] to MQ[Width - 1], AC[1..Width - 1] move down one place
+//.... and AC[Width - 1] keeps its value, flipped if the sum before overflowed
+template <int Width>
+constexpr void fastShift(BoothRegisters<Width>& r)
+{
+    typedef typename BoothRegisters<Width>::Word Word;
+    const Word sign = Word(Word(1) << (Width - 1));
+    r.mqv = r.mq & 1u;
+    r.mq = Word((r.mq >> 1) | Word(Word(r.ac & 1u) << (Width - 1)));
+    r.ac = Word((r.ac >> 1) | ((r.ac & sign) ^ (r.overflow ? sign : 0)));
+    r.overflow = false;
+}
+
+//the cycle counter counts down with the ALU, 0 wraps around to all ones
+template <int Width>
+constexpr void fastDecrement(BoothRegisters<Width>& r)
+{
+    r.cycleCounter = (r.cycleCounter - 1) & BoothRegisters<Width>::fullCounter;
+}
+
+//multiplies md * mq on the fast engine and returns the final registers
+template <int Width>
+constexpr BoothRegisters<Width> fastBooths(typename RegisterWord<Width>::type md, typename RegisterWord<Width>::type mq)
+{
+    BoothRegisters<Width> r = fastStart<Width>(md, mq);
+    do
+    {
+        BoothAction action = boothAction(r.mq & 1u, r.mqv);
+        if (action != BOOTH_NOTHING)
+            fastAddSub(r, action == BOOTH_SUBTRACT);
+        fastShift(r);
+        fastDecrement(r);
+    } while (r.cycleCounter != BoothRegisters<Width>::fullCounter);
+    return r;
+}
+
+//the engines multiply at compile time, 3 * -3 on every width
+static_assert(packBits(gateBooths(unpackBits<8>(3), unpackBits<8>(0xFD)).mq) == 0xF7, "gate-level engine");
+static_assert(fastBooths<16>(3, 0xFFFD).ac == 0xFFFF && fastBooths<16>(3, 0xFFFD).mq == 0xFFF7, "fast engine");
+static_assert(fastBooths<64>(3, ~uint64_t(2)).mq == ~uint64_t(8), "fast engine");
+//127 * 127 and -128 * -128 overflow AC on the way
+static_assert(packBits(gateBooths(unpackBits<8>(127), unpackBits<8>(127)).ac) == 0x3F, "gate-level engine");
+static_assert(fastBooths<8>(0x80, 0x80).ac == 0x40 && fastBooths<8>(0x80, 0x80).mq == 0, "fast engine");
+
+// -- Bit-sliced batch engine --
+// The gate-level ALU chain run on a whole word of operand pairs at once: every register bit is a bit plane,
+// .... a word whose lane k holds that bit of operand pair k, so each gate is one bitwise operation for all lanes.
+// .... The add, subtract or do nothing choice of Booth's is made per lane, lanes that do nothing keep their AC.
+// Lanes is uint64_t for 64 lanes or a GCC vector of them for 256 and 512 lanes (AVX2, AVX-512)
+typedef uint64_t Lanes64;
+typedef uint64_t Lanes256 __attribute__((vector_size(32)));
+typedef uint64_t Lanes512 __attribute__((vector_size(64)));
+
+template <class Lanes>
+constexpr int laneCount() { return sizeof(Lanes) * 8; }
+
+//The sliced helpers take their lanes by reference and write their outputs through references, a vector passed
+//.... or returned by value would change the ABI of the functions between builds with and without AVX
+
+//Simulates a 1-bit full adder on every lane, the same gates as OneBitFullAdder
+//sum and carryOut may be the inputs
+template <class Lanes>
+inline void slicedFullAdder(const Lanes& a, const Lanes& b, const Lanes& carryIn, Lanes& sum, Lanes& carryOut)
+{
+    Lanes half = a ^ b;
+    Lanes carry = (a & b) | (half & carryIn);
+    sum = half ^ carryIn;
+    carryOut = carry;
+}
+
+//Simulates a 1-bit ALU on every lane, the same gates and 4 way MUX as ALUOneBit
+//result gets the result and carryOut the adder's carry out, either may be an input
+template <class Lanes>
+inline void slicedALUOneBit(const Lanes& aIn, const Lanes& bIn, const Lanes& aInvert, const Lanes& bInvert,
+                            const Lanes& carryIn, const Lanes* operation, Lanes& result, Lanes& carryOut)
+{
+    Lanes a = aIn ^ aInvert;
+    Lanes b = bIn ^ bInvert;
+    Lanes op0 = a & b;
+    Lanes op1 = a | b;
+    Lanes op2;
+    slicedFullAdder(a, b, carryIn, op2, carryOut);
+    result = (~operation[0] & ~operation[1] & op0) | (~operation[0] & operation[1] & op1) | (operation[0] & ~operation[1] & op2);
+}
+
+//Simulates the ripple carry chain of ALU on width bits, result may be a
+//overflow (if given) gets the overflow of the last 1-bit ALU, as ALUOneBitWithOF computes it
+template <class Lanes>
+inline void slicedALU(const Lanes* a, const Lanes* b, const Lanes& aInv, const Lanes& bInv, const Lanes* operation, Lanes* result, int width,
+                      Lanes* overflow = nullptr)
+{
+    Lanes carryIn = bInv;
+    Lanes topA = a[width - 1] ^ aInv;
+    Lanes topB = b[width - 1] ^ bInv;
+    for (int i = 0; i < width; i++)
+        slicedALUOneBit(a[i], b[i], aInv, bInv, carryIn, operation, result[i], carryIn);
+    if (overflow != nullptr)
+        *overflow = ~(topA ^ topB) & (result[width - 1] ^ topB);
+}
+
+//returns the bit of lane 0
+template <class Lanes>
+inline bool firstLane(const Lanes& lanes)
+{
+    uint64_t low;
+    memcpy(&low, &lanes, sizeof(low));
+    return low & 1;
+}
+
+//transposes the 8x8 bit matrix in x, byte j bit i becomes byte i bit j
+inline uint64_t transpose8(uint64_t x)
+{
+    uint64_t t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+    return x ^ t ^ (t << 28);
+}
+
+//turns Width bit values into bit planes, lane k of planes[i] is bit i of values[k]
+//each byte of 8 neighbouring lanes is one 8x8 bit transpose
+template <int Width, class Lanes>
+void toPlanes(const typename RegisterWord<Width>::type* values, Lanes* planes)
+{
+    const int words = sizeof(Lanes) / 8;
+    uint64_t bits[Width][words];
+    memset(bits, 0, sizeof(bits));
+    for (int g = 0; g < laneCount<Lanes>() / 8; g++)
+    {
+        for (int b = 0; b < Width / 8; b++)
+        {
+            uint64_t rows = 0;
+            for (int j = 0; j < 8; j++)
+                rows |= uint64_t((values[g * 8 + j] >> (8 * b)) & 0xFF) << (8 * j);
+            uint64_t columns = transpose8(rows);
+            for (int i = 0; i < 8; i++)
+                bits[8 * b + i][g / 8] |= ((columns >> (8 * i)) & 0xFF) << (8 * (g % 8));
+        }
+    }
+    for (int i = 0; i < Width; i++)
+        memcpy(&planes[i], bits[i], sizeof(Lanes));
+}
+
+//turns bit planes back into Width bit values
+template <int Width, class Lanes>
+void fromPlanes(const Lanes* planes, typename RegisterWord<Width>::type* values)
+{
+    typedef typename RegisterWord<Width>::type Word;
+    const int words = sizeof(Lanes) / 8;
+    uint64_t bits[Width][words];
+    for (int i = 0; i < Width; i++)
+        memcpy(bits[i], &planes[i], sizeof(Lanes));
+    for (int g = 0; g < laneCount<Lanes>() / 8; g++)
+    {
+        uint64_t bytes[Width / 8];
+        for (int b = 0; b < Width / 8; b++)
+        {
+            uint64_t columns = 0;
+            for (int i = 0; i < 8; i++)
+                columns |= ((bits[8 * b + i][g / 8] >> (8 * (g % 8))) & 0xFF) << (8 * i);
+            bytes[b] = transpose8(columns);
+        }
+        for (int j = 0; j < 8; j++)
+        {
+            uint64_t value = 0;
+            for (int b = 0; b < Width / 8; b++)
+                value |= ((bytes[b] >> (8 * j)) & 0xFF) << (8 * b);
+            values[g * 8 + j] = Word(value);
+        }
+    }
+}
+
+//Simulates Booths algorithm on laneCount<Lanes>() operand pairs at once, ac[k] and mq[k] get the product
+//.... of md[k] * mq[k], every step is the one the gate-level engine takes, including its shift (see gateShift)
+template <int Width, class Lanes>
+void slicedBooths(const typename RegisterWord<Width>::type* md, typename RegisterWord<Width>::type* mq,
+                  typename RegisterWord<Width>::type* ac)
+{
+    const Lanes zero = Lanes();
+    const Lanes ones = ~zero;
+    const Lanes add[2] = {ones, zero};   //operation 10 selects the adder
+    const int counter = counterBits<Width>();
+    Lanes MD[Width], MQ[Width], AC[Width], sum[Width];
+    toPlanes<Width>(md, MD);
+    toPlanes<Width>(mq, MQ);
+    for (int i = 0; i < Width; i++)
+        AC[i] = zero;
+    Lanes mqv = zero;
+
+    //the cycle counter is the same in every lane, it is still counted down by the ALU
+    Lanes cycleCounter[counter], one[counter];
+    for (int i = 0; i < counter; i++)
+    {
+        cycleCounter[i] = ones;
+        one[i] = i == 0 ? ones : zero;
+    }
+    bool full = false;
+    while (!full)
+    {
+        //lanes with MQ[0] MQ-1 = 01 add MD and lanes with 10 subtract it
+        Lanes adding = ~MQ[0] & mqv;
+        Lanes subtracting = MQ[0] & ~mqv;
+        Lanes overflow;
+        slicedALU(AC, MD, zero, subtracting, add, sum, Width, &overflow);
+        Lanes changed = adding | subtracting;
+        for (int i = 0; i < Width; i++)
+            AC[i] = (sum[i] & changed) | (AC[i] & ~changed);
+        overflow = overflow & changed;
+
+        //shift bits, moving the planes, the sign of lanes whose sum overflowed flips
+        mqv = MQ[0];
+        for (int i = 1; i < Width; i++)
+            MQ[i - 1] = MQ[i];
+        MQ[Width - 1] = AC[0];
+        for (int i = 1; i < Width; i++)
+            AC[i - 1] = AC[i];
+        AC[Width - 1] = AC[Width - 1] ^ overflow;
+
+        //decrement cycle counter
+        slicedALU(cycleCounter, one, zero, ones, add, cycleCounter, counter);
+        full = true;
+        for (int i = 0; i < counter; i++)
+            full = full && firstLane(cycleCounter[i]);
+    }
+
+    fromPlanes<Width>(AC, ac);
+    fromPlanes<Width>(MQ, mq);
+}
+
+//Multiplies count operand pairs on the bit-sliced engine, mq gets the low half of each product and ac the high half
+//a final partial word is padded with zeros
+template <int Width, class Lanes>
+void slicedBatch(const typename RegisterWord<Width>::type* md, typename RegisterWord<Width>::type* mq,
+                 typename RegisterWord<Width>::type* ac, size_t count)
+{
+    typedef typename RegisterWord<Width>::type Word;
+    const int lanes = laneCount<Lanes>();
+    for (size_t start = 0; start < count; start += lanes)
+    {
+        size_t n = count - start < (size_t)lanes ? count - start : lanes;
+        Word a[lanes] = {}, b[lanes] = {}, high[lanes];
+        memcpy(a, md + start, n * sizeof(Word));
+        memcpy(b, mq + start, n * sizeof(Word));
+        slicedBooths<Width, Lanes>(a, b, high);
+        memcpy(mq + start, b, n * sizeof(Word));
+        memcpy(ac + start, high, n * sizeof(Word));
+    }
+}
+
+// -- Table of steps --
+// Which engine booths uses, ENGINE_CHECK runs both and compares them after every step
+enum Engine
+{
+    ENGINE_GATE,
+    ENGINE_FAST,
+    ENGINE_CHECK
+};
+
+//prints one row of the table, without ending the line
+template <int Width>
+void printRow(const BoothRegisters<Width>& r, const char* comment)
+{
+    std::cout << std::setw(14) << binaryToString(unpackBits<counterBits<Width>()>(r.cycleCounter)) << std::setw(3) << " | "
+        << std::setw(Width + 2) << binaryToString(unpackBits<Width>(r.md)) << std::setw(3) << " | "
+        << std::setw(Width + 2) << binaryToString(unpackBits<Width>(r.ac)) << std::setw(3) << " | "
+        << std::setw(Width + 2) << binaryToString(unpackBits<Width>(r.mq)) << std::setw(3) << " | "
+        << std::setw(5) << r.mqv << std::setw(3) << " | " << comment;
+}
+
+//compares the gate-level registers with the fast engine's after a step, returns false and reports it if they differ
+template <int Width>
+bool sameRegisters(const BoothRegisters<Width>& gate, const BoothRegisters<Width>& fast, const char* step, int iteration)
+{
+    if (gate.ac == fast.ac && gate.mq == fast.mq && gate.mqv == fast.mqv && gate.overflow == fast.overflow
+        && gate.cycleCounter == fast.cycleCounter)
+        return true;
+    //written in one piece so that reports of threads running side by side do not mix
+    std::ostringstream report;
+    report << "Engines disagree after " << step << " in iteration " << iteration << " of MD "
+           << binaryToString(unpackBits<Width>(gate.md)) << ": gate AC " << binaryToString(unpackBits<Width>(gate.ac))
+           << " MQ " << binaryToString(unpackBits<Width>(gate.mq)) << " MQ-1 " << gate.mqv << " counter "
+           << int(gate.cycleCounter) << ", fast AC " << binaryToString(unpackBits<Width>(fast.ac)) << " MQ "
+           << binaryToString(unpackBits<Width>(fast.mq)) << " MQ-1 " << fast.mqv << " counter "
+           << int(fast.cycleCounter) << "\n";
+    std::cerr << report.str();
+    return false;
+}
+
+//Simulates Booths algorithm multiplying MD*MQ
+//stores the result in AC MQ
+//The engine picks the gate-level ALU chain, the fast engine or both (see Engine), print writes the table of steps
+//returns the final registers, mismatches (if given) counts the steps where the two engines disagreed
+//and counts (if given) gets the iterations and ALU operations, gates (if given) the cost of the gate-level engine
+template <int Width>
+BoothRegisters<Width> booths(const Bits<Width>& opA, const Bits<Width>& opB, Engine engine = ENGINE_GATE,
+                             bool print = true, int* mismatches = nullptr, BoothCounts* counts = nullptr,
+                             GateCounters* gates = nullptr)
+{
+    typedef typename BoothRegisters<Width>::Word Word;
+    GateRegisters<Width> gate = gateStart(opA, opB);
+    BoothRegisters<Width> fast = fastStart<Width>(Word(packBits(opA)), Word(packBits(opB)));
+    bool gateLevel = engine != ENGINE_FAST;
+    //the registers the table shows, the gate-level ones unless only the fast engine runs
+    auto view = [&]() { return gateLevel ? packRegisters(gate) : fast; };
+    auto compare = [&](const char* step, int iteration)
+    {
+        if (engine == ENGINE_CHECK && !sameRegisters(view(), fast, step, iteration) && mismatches != nullptr)
+            (*mismatches)++;
+    };
+
+    //Output header
+    if (print)
+    {
+        std::cout << std::setw(14) << "cycle-counter" << std::setw(3) << " | " << std::setw(Width + 2) << "MD" << std::setw(3) << " | "
+            << std::setw(Width + 2) << "AC" << std::setw(3) << " | "
+            << std::setw(Width + 2) << "MQ" << std::setw(3) << " | "
+            << std::setw(5) << "MQ-1" << std::setw(3) << " | " << "Comment" << std::endl;
+
+        //output initialization
+        printRow(view(), "Initialize");
+        std::cout << std::endl;
+    }
+    int i = 0;
+    int aluOperations = 0;
+    bool enteredLoop = false;
+    //Width iterations
+    while (!(enteredLoop && view().cycleCounter == BoothRegisters<Width>::fullCounter))
+    {
+        i++;
+        enteredLoop = true;
+        BoothRegisters<Width> before = view();
+        BoothAction action = boothAction(before.mq & 1u, before.mqv);
+        const char* comment = action == BOOTH_ADD ? "AC <- AC + MD    "
+                              : (action == BOOTH_SUBTRACT ? "AC <- AC - MD    " : "Do Nothing       ");
+        if (action != BOOTH_NOTHING)
+        {
+            aluOperations++;
+            if (gateLevel)
+                gateAddSub(gate, action == BOOTH_SUBTRACT, gates);
+            if (engine != ENGINE_GATE)
+                fastAddSub(fast, action == BOOTH_SUBTRACT);
+        }
+        compare(comment, i);
+        if (print)
+        {
+            printRow(view(), comment);
+            std::cout << "Step: 1 | Iteration: " << i << std::endl;
+        }
+
+        if (gateLevel)
+            gateShift(gate, gates);
+        if (engine != ENGINE_GATE)
+            fastShift(fast);
+        compare("the shift", i);
+
+        //Output after shifting
+        if (print)
+        {
+            printRow(view(), "Shift 1 Bit >>   Step: 2 | Iteration: ");
+            std::cout << i << std::endl;
+        }
+
+        if (gateLevel)
+            gateDecrement(gate, gates);
+        if (engine != ENGINE_GATE)
+            fastDecrement(fast);
+        compare("the cycle counter", i);
+    }//end of booths, The answer is in AC MQ
+
+    if (counts != nullptr)
+        *counts = {i, aluOperations};
+
+    //Output final results
+    BoothRegisters<Width> done = view();
+    if (print)
+    {
+        std::cout << "--------------------------------------------------------------------------------------" << std::endl;
+        std::cout << std::setw(14) << "DONE" << std::setw(3) << " | "
+            << std::setw(Width + 2) << binaryToString(unpackBits<Width>(done.md)) << std::setw(3) << " | "
+            << std::setw(Width + 2) << binaryToString(unpackBits<Width>(done.ac)) << std::setw(3) << " | "
+            << std::setw(Width + 2) << binaryToString(unpackBits<Width>(done.mq)) << std::setw(3) << " | "
+            << std::setw(5) << done.mqv << std::setw(3) << " | " << "Final Result" << std::endl;
+    }
+    return done;
+}
+
+// -- Modified Booth's, radix 4 and radix 8 --
+// Radix 2^DigitBits Booth's recodes DigitBits bits of MQ and the bit before them (MQ-1) at a time into one digit
+// .... d = -2^(DigitBits - 1) * MQ[DigitBits - 1] + ... + 2 * MQ[1] + MQ[0] + MQ-1, then does AC <- AC + d * MD
+// .... with one ALU operation (none for d = 0) and shifts AC MQ MQ-1 right by DigitBits bits (arithmetic)
+// .... radix 4 (DigitBits 2) takes Width / 2 iterations with the multiples MD and 2MD, both MD wired shifted
+// .... radix 8 (DigitBits 3) takes Width / 3 iterations rounded up with MD to 4MD, 3MD costs an extra ALU operation
+// .... to compute up front
+// AC has DigitBits guard bits so that 4MD and the partial sums fit. MQ is sign extended to the digits * DigitBits bits
+// .... shifted out of it, so at the end AC MQ is the product sign extended by the guard bits.
+// The cycle counter starts at digits - 1 and is counted down by the ALU until it wraps around to all ones.
+template <int Width, int DigitBits>
+struct ModifiedRegisters
+{
+    static constexpr int digits = (Width + DigitBits - 1) / DigitBits;
+    static constexpr int acBits = Width + DigitBits;
+    static constexpr int mqBits = digits * DigitBits;
+    static constexpr int counter = counterBits<digits>();
+
+    Bits<acBits> multiples[(1 << (DigitBits - 1)) + 1];    // 0, MD, 2MD .. 2^(DigitBits - 1)MD on acBits bits
+    Bits<acBits> ac;
+    Bits<mqBits> mq;
+    bool mqv;
+    Bits<counter> cycleCounter;
+};
+
+// The low and high Width bits of a 2 * Width bit product
+template <int Width>
+struct Product
+{
+    typename RegisterWord<Width>::type high;
+    typename RegisterWord<Width>::type low;
+};
+
+//sign extends a Width bit number to Extended bits
+template <int Extended, int Width>
+constexpr Bits<Extended> signExtend(const Bits<Width>& bits)
+{
+    Bits<Extended> out = {};
+    for (int i = 0; i < Extended; i++)
+        out[i] = bits[i < Width ? i : Width - 1];
+    return out;
+}
+
+//shifts a number left by one bit, a wiring of the ALU's inputs
+template <int Width>
+constexpr Bits<Width> shiftLeft(const Bits<Width>& bits)
+{
+    Bits<Width> out = {};
+    for (int i = 1; i < Width; i++)
+        out[i] = bits[i - 1];
+    return out;
+}
+
+//loads the registers, for radix 8 counts the ALU operation computing 3MD
+template <int Width, int DigitBits>
+constexpr ModifiedRegisters<Width, DigitBits> modifiedStart(const Bits<Width>& md, const Bits<Width>& mq, int& aluOperations,
+                                                            GateCounters* gates = nullptr)
+{
+    typedef ModifiedRegisters<Width, DigitBits> Registers;
+    Registers r = {};
+    r.multiples[1] = signExtend<Registers::acBits>(md);
+    for (int m = 2; m < (1 << (DigitBits - 1)) + 1; m++)
+    {
+        if (m % 2 == 0)
+            r.multiples[m] = shiftLeft(r.multiples[m / 2]);
+        else
+        {
+            r.multiples[m] = ALU(r.multiples[m - 1], r.multiples[1], false, false, ALU_ADD, gates).result;
+            aluOperations++;
+        }
+    }
+    r.mq = signExtend<Registers::mqBits>(mq);
+    r.cycleCounter = unpackBits<Registers::counter>(Registers::digits - 1);
+    return r;
+}
+
+//the digit the low DigitBits bits of MQ and MQ-1 recode to
+template <int Width, int DigitBits>
+constexpr int boothDigit(const ModifiedRegisters<Width, DigitBits>& r)
+{
+    int digit = r.mqv;
+    for (int i = 0; i < DigitBits - 1; i++)
+        digit += r.mq[i] << i;
+    return digit - (r.mq[DigitBits - 1] << (DigitBits - 1));
+}
+
+//AC <- AC + digit * MD on the ALU, a negative digit inverts the multiple and carries in 1
+//gates (if given) gets the ALU's cost and the register bits that toggled, as for the shift and the counter
+template <int Width, int DigitBits>
+constexpr void modifiedAddSub(ModifiedRegisters<Width, DigitBits>& r, int digit, GateCounters* gates = nullptr)
+{
+    typedef ModifiedRegisters<Width, DigitBits> Registers;
+    Bits<Registers::acBits> sum = ALU(r.ac, r.multiples[digit < 0 ? -digit : digit], false, digit < 0, ALU_ADD, gates).result;
+    if (gates != nullptr)
+        gates->toggles += changedBits(r.ac, sum);
+    r.ac = sum;
+}
+
+//shifts AC MQ MQ-1 right by DigitBits bits, AC is sign extended
+template <int Width, int DigitBits>
+constexpr void modifiedShift(ModifiedRegisters<Width, DigitBits>& r, GateCounters* gates = nullptr)
+{
+    typedef ModifiedRegisters<Width, DigitBits> Registers;
+    Registers before = r;
+    for (int s = 0; s < DigitBits; s++)
+    {
+        r.mqv = r.mq[0];
+        for (int i = 1; i < Registers::mqBits; i++)
+            r.mq[i - 1] = r.mq[i];
+        r.mq[Registers::mqBits - 1] = r.ac[0];
+        for (int i = 1; i < Registers::acBits; i++)
+            r.ac[i - 1] = r.ac[i];
+    }
+    if (gates != nullptr)
+        gates->toggles += changedBits(before.ac, r.ac) + changedBits(before.mq, r.mq) + (before.mqv != r.mqv);
+}
+
+//decrement cycle counter
+template <int Width, int DigitBits>
+constexpr void modifiedDecrement(ModifiedRegisters<Width, DigitBits>& r, GateCounters* gates = nullptr)
+{
+    typedef ModifiedRegisters<Width, DigitBits> Registers;
+    Bits<Registers::counter> counter = ALU(r.cycleCounter, unpackBits<Registers::counter>(1), false, true, ALU_ADD, gates).result;
+    if (gates != nullptr)
+        gates->toggles += changedBits(r.cycleCounter, counter);
+    r.cycleCounter = counter;
+}
+
+//the product in AC MQ, bit p of it is MQ[p] below mqBits and AC[p - mqBits] above
+template <int Width, int DigitBits>
+constexpr Product<Width> modifiedProduct(const ModifiedRegisters<Width, DigitBits>& r)
+{
+    typedef ModifiedRegisters<Width, DigitBits> Registers;
+    Bits<2 * Width> product = {};
+    for (int p = 0; p < 2 * Width; p++)
+        product[p] = p < Registers::mqBits ? r.mq[p] : r.ac[p - Registers::mqBits];
+    typedef typename RegisterWord<Width>::type Word;
+    Product<Width> out = {};
+    for (int p = 0; p < Width; p++)
+    {
+        out.low |= Word(Word(product[p]) << p);
+        out.high |= Word(Word(product[Width + p]) << p);
+    }
+    return out;
+}
+
+//the comment of the add or subtract step of a digit, the same width as the radix 2 comments
+constexpr const char* digitComment(int digit)
+{
+    const char* comments[] = {"AC <- AC - 4MD   ", "AC <- AC - 3MD   ", "AC <- AC - 2MD   ", "AC <- AC - MD    ",
+                              "Do Nothing       ", "AC <- AC + MD    ", "AC <- AC + 2MD   ", "AC <- AC + 3MD   ",
+                              "AC <- AC + 4MD   "};
+    return comments[digit + 4];
+}
+
+//prints one row of the radix 2^DigitBits table, without ending the line
+template <int Width, int DigitBits>
+void printModifiedRow(const ModifiedRegisters<Width, DigitBits>& r, const char* comment)
+{
+    typedef ModifiedRegisters<Width, DigitBits> Registers;
+    std::cout << std::setw(14) << binaryToString(r.cycleCounter) << std::setw(3) << " | "
+        << std::setw(Registers::acBits + 2) << binaryToString(r.multiples[1]) << std::setw(3) << " | "
+        << std::setw(Registers::acBits + 2) << binaryToString(r.ac) << std::setw(3) << " | "
+        << std::setw(Registers::mqBits + 2) << binaryToString(r.mq) << std::setw(3) << " | "
+        << std::setw(5) << r.mqv << std::setw(3) << " | " << comment;
+}
+
+//Simulates radix 2^DigitBits modified Booths algorithm multiplying MD*MQ on the gate-level ALU
+//print writes the table of steps, counts (if given) gets the iterations and ALU operations and gates (if given) the cost
+//returns the product
+template <int Width, int DigitBits>
+constexpr Product<Width> modifiedBooths(const Bits<Width>& opA, const Bits<Width>& opB, bool print = false,
+                                        BoothCounts* counts = nullptr, GateCounters* gates = nullptr)
+{
+    typedef ModifiedRegisters<Width, DigitBits> Registers;
+    int aluOperations = 0;
+    Registers r = modifiedStart<Width, DigitBits>(opA, opB, aluOperations, gates);
+    if (print)
+    {
+        std::cout << std::setw(14) << "cycle-counter" << std::setw(3) << " | " << std::setw(Registers::acBits + 2) << "MD"
+            << std::setw(3) << " | " << std::setw(Registers::acBits + 2) << "AC" << std::setw(3) << " | "
+            << std::setw(Registers::mqBits + 2) << "MQ" << std::setw(3) << " | "
+            << std::setw(5) << "MQ-1" << std::setw(3) << " | " << "Comment" << std::endl;
+        printModifiedRow(r, DigitBits == 3 ? "Initialize, 3MD <- MD + 2MD" : "Initialize");
+        std::cout << std::endl;
+    }
+    int i = 0;
+    bool counterFull = false;
+    //digits iterations
+    while (!counterFull)
+    {
+        i++;
+        int digit = boothDigit(r);
+        if (digit != 0)
+        {
+            modifiedAddSub(r, digit, gates);
+            aluOperations++;
+        }
+        if (print)
+        {
+            printModifiedRow(r, digitComment(digit));
+            std::cout << "Step: 1 | Iteration: " << i << std::endl;
+        }
+        modifiedShift(r, gates);
+        if (print)
+        {
+            printModifiedRow(r, DigitBits == 2 ? "Shift 2 Bits >>  Step: 2 | Iteration: "
+                                               : "Shift 3 Bits >>  Step: 2 | Iteration: ");
+            std::cout << i << std::endl;
+        }
+        modifiedDecrement(r, gates);
+        counterFull = true;
+        for (int b = 0; b < Registers::counter; b++)
+            counterFull = counterFull && r.cycleCounter[b];
+    }
+
+    Product<Width> product = modifiedProduct(r);
+    if (print)
+    {
+        std::cout << "--------------------------------------------------------------------------------------" << std::endl;
+        std::cout << std::setw(14) << "DONE" << std::setw(3) << " | "
+            << std::setw(Registers::acBits + 2) << binaryToString(r.multiples[1]) << std::setw(3) << " | "
+            << std::setw(Registers::acBits + 2) << binaryToString(r.ac) << std::setw(3) << " | "
+            << std::setw(Registers::mqBits + 2) << binaryToString(r.mq) << std::setw(3) << " | "
+            << std::setw(5) << r.mqv << std::setw(3) << " | " << "Final Result" << std::endl;
+    }
+    if (counts != nullptr)
+        *counts = {i, aluOperations};
+    return product;
+}
+
+//radix 4 and radix 8 agree at compile time, 3 * -3 and -128 * -128
+static_assert(modifiedBooths<8, 2>(unpackBits<8>(3), unpackBits<8>(0xFD)).low == 0xF7, "radix 4");
+static_assert(modifiedBooths<8, 3>(unpackBits<8>(3), unpackBits<8>(0xFD)).high == 0xFF, "radix 8");
+static_assert(modifiedBooths<8, 3>(unpackBits<8>(0x80), unpackBits<8>(0x80)).high == 0x40, "radix 8");
+
+#endif
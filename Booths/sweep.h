@@ -0,0 +1,64 @@
+/* Operand sweeps over a pool of threads
+ * parallelFor splits count items into chunks and a pool of worker threads takes the next chunk as it finishes one,
+ * .... so a slow chunk does not hold up the others. work(first, last, worker) runs once per chunk, worker is the
+ * .... number of the thread running it (0 up to threads - 1) for per thread totals that are added up afterwards.
+ * The random operand pairs of a sweep come from the index of the pair (sweepOperand) instead of one shared
+ * .... generator, so a sweep multiplies the same pairs on any number of threads.
+ * The engines keep no state between calls (the ALU returns its outputs by value), so any number of
+ * .... multiplies can run at once.
+ */
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "booths.h"
+
+//the number of threads a sweep uses when --threads is not given, every core
+inline int defaultThreads()
+{
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores > 0 ? int(cores) : 1;
+}
+
+//runs work(first, last, worker) over [0, count) in chunks of chunkSize items on threads threads
+template <class Work>
+void parallelFor(long long count, int threads, long long chunkSize, Work work)
+{
+    std::atomic<long long> next(0);
+    auto worker = [&](int id)
+    {
+        for (long long first = next.fetch_add(chunkSize); first < count; first = next.fetch_add(chunkSize))
+            work(first, first + chunkSize < count ? first + chunkSize : count, id);
+    };
+    if (threads <= 1)
+    {
+        worker(0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (int id = 0; id < threads; id++)
+        workers.emplace_back(worker, id);
+    for (std::thread& thread : workers)
+        thread.join();
+}
+
+//splitmix64, a stateless mix of the 64 bits of x
+inline uint64_t mixBits(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+//the MD (which 0) or MQ (which 1) of pair n of a random sweep
+template <int Width>
+typename RegisterWord<Width>::type sweepOperand(long long n, int which)
+{
+    return typename RegisterWord<Width>::type(mixBits(uint64_t(n) * 2 + which));
+}
+
+#endif
@@ -0,0 +1,262 @@
+/* Verification of the Booth's engines against native multiplication
+ * A pass multiplies every pair of Width bit operands (exhaustive, 8 and 16 bits only, pair n is MD n >> Width
+ * .... and MQ the low Width bits of n) or count random pairs (sweepOperand) on one engine and compares AC MQ
+ * .... with the product of native signed multiplication.
+ * The pairs are split into shards of SHARD_PAIRS pairs that run on the threads of a sweep (parallelFor).
+ * .... The first failures are printed, all of them are counted.
+ * With a progress file every finished shard is appended to it as "shard <n> <failures>", after a header line naming
+ * .... the pass (width, radix, engine, the lanes of the sliced engine and the pairs). Running the same pass with
+ * .... the same file again skips the shards it lists, so an interrupted pass resumes where it stopped and a
+ * .... finished one just reports its totals.
+ */
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "booths.h"
+#include "sweep.h"
+
+// The engine a pass checks
+enum VerifyEngine
+{
+    VERIFY_GATE,        // gateBooths, or modifiedBooths in radix 4 and 8
+    VERIFY_FAST,        // fastBooths
+    VERIFY_SLICED       // slicedBatch
+};
+
+const char* const VERIFY_ENGINE_NAMES[] = {"gate", "fast", "sliced"};
+
+const long long SHARD_PAIRS = 1 << 20;
+const int MAX_REPORTED_FAILURES = 20;
+
+//the product of native multiplication of the signed Width bit numbers
+template <int Width>
+Product<Width> nativeProduct(typename RegisterWord<Width>::type md, typename RegisterWord<Width>::type mq)
+{
+    typedef typename RegisterWord<Width>::type Word;
+    typedef typename std::make_signed<Word>::type Signed;
+    __int128 product = (__int128)Signed(md) * Signed(mq);
+    return {Word(product >> Width), Word(product)};
+}
+
+//writes a signed 128 bit number in decimal
+inline std::string int128ToString(__int128 value)
+{
+    bool negative = value < 0;
+    unsigned __int128 magnitude = negative ? -(unsigned __int128)value : value;
+    std::string digits;
+    do
+    {
+        digits.insert(digits.begin(), char('0' + int(magnitude % 10)));
+        magnitude /= 10;
+    } while (magnitude != 0);
+    return negative ? "-" + digits : digits;
+}
+
+//the signed value of a product
+template <int Width>
+__int128 productValue(const Product<Width>& product)
+{
+    typedef typename std::make_signed<typename RegisterWord<Width>::type>::type Signed;
+    return (__int128)Signed(product.high) * ((__int128)1 << Width) + product.low;
+}
+
+//multiplies count pairs from md and mq on the engine in the radix, the products go to products
+//the gate-level engines build their ALU with the adder
+template <int Width>
+void verifyMultiply(const typename RegisterWord<Width>::type* md, const typename RegisterWord<Width>::type* mq,
+                    Product<Width>* products, size_t count, VerifyEngine engine, int radix, int lanes, Adder adder)
+{
+    typedef typename RegisterWord<Width>::type Word;
+    GateCounters gates = {};
+    gates.adder = adder;
+    GateCounters* counters = adder != ADDER_RIPPLE ? &gates : nullptr;
+    if (engine == VERIFY_SLICED)
+    {
+        std::vector<Word> high(count), low(mq, mq + count);
+        if (lanes == 512)
+            slicedBatch<Width, Lanes512>(md, low.data(), high.data(), count);
+        else if (lanes == 256)
+            slicedBatch<Width, Lanes256>(md, low.data(), high.data(), count);
+        else
+            slicedBatch<Width, Lanes64>(md, low.data(), high.data(), count);
+        for (size_t k = 0; k < count; k++)
+            products[k] = {high[k], low[k]};
+        return;
+    }
+    for (size_t k = 0; k < count; k++)
+    {
+        if (radix == 8)
+            products[k] = modifiedBooths<Width, 3>(unpackBits<Width>(md[k]), unpackBits<Width>(mq[k]), false, nullptr,
+                                                    counters);
+        else if (radix == 4)
+            products[k] = modifiedBooths<Width, 2>(unpackBits<Width>(md[k]), unpackBits<Width>(mq[k]), false, nullptr,
+                                                    counters);
+        else if (engine == VERIFY_FAST)
+        {
+            BoothRegisters<Width> done = fastBooths<Width>(md[k], mq[k]);
+            products[k] = {done.ac, done.mq};
+        }
+        else
+        {
+            GateRegisters<Width> done = gateBooths(unpackBits<Width>(md[k]), unpackBits<Width>(mq[k]), counters);
+            products[k] = {Word(packBits(done.ac)), Word(packBits(done.mq))};
+        }
+    }
+}
+
+//reads the shards a progress file lists as done and their failures, or writes its header if it is new
+//returns false if the file belongs to another pass or cannot be written
+inline bool readProgress(const std::string& progressFile, const std::string& header, std::vector<int8_t>& done,
+                         std::vector<long long>& failures)
+{
+    std::ifstream in(progressFile);
+    std::string line;
+    if (in && std::getline(in, line))
+    {
+        if (line != header)
+        {
+            std::cerr << progressFile << " is the progress of another pass (" << line << "), not " << header << std::endl;
+            return false;
+        }
+        //a line cut short by an interruption is skipped, its shard runs again
+        while (std::getline(in, line))
+        {
+            std::istringstream fields(line);
+            std::string word;
+            long long shard = -1, failed = 0;
+            if (fields >> word >> shard >> failed && word == "shard" && shard >= 0 && shard < (long long)done.size())
+            {
+                done[shard] = 1;
+                failures[shard] = failed;
+            }
+        }
+        return true;
+    }
+    std::ofstream out(progressFile);
+    if (!out)
+    {
+        std::cerr << "Could not write " << progressFile << std::endl;
+        return false;
+    }
+    out << header << "\n";
+    return true;
+}
+
+//verifies count random pairs, or every pair with count 0, on the engine in the radix on the given threads
+//progressFile (if not empty) records the finished shards to resume from
+//the gate-level engines build their ALU with the adder
+//returns 0 if every product was right
+template <int Width>
+int verify(long long count, VerifyEngine engine, int radix, int lanes, int threads, const std::string& progressFile,
+           Adder adder = ADDER_RIPPLE)
+{
+    typedef typename RegisterWord<Width>::type Word;
+    bool exhaustive = count == 0;
+    if (exhaustive && Width > 16)
+    {
+        std::cerr << "An exhaustive pass is only possible up to 16 bits, give the number of random pairs" << std::endl;
+        return 1;
+    }
+    //the bits of a pair index of an exhaustive pass, MD in the high half
+    const int pairBits = Width <= 16 ? 2 * Width : 0;
+    long long pairs = exhaustive ? 1ll << pairBits : count;
+    long long shards = (pairs + SHARD_PAIRS - 1) / SHARD_PAIRS;
+    std::vector<int8_t> done(shards, 0);
+    std::vector<long long> failures(shards, 0);
+
+    std::ostringstream header;
+    header << "# booths verify width " << Width << " radix " << radix << " engine " << VERIFY_ENGINE_NAMES[engine];
+    if (engine == VERIFY_SLICED)
+        header << " lanes " << lanes;
+    header << " pairs " << (exhaustive ? std::string("all") : std::to_string(count));
+    //the adder only when it is not the ripple chain
+    if (adder != ADDER_RIPPLE)
+        header << " adder " << ADDER_NAMES[adder];
+    std::ofstream progress;
+    if (!progressFile.empty())
+    {
+        if (!readProgress(progressFile, header.str(), done, failures))
+            return 1;
+        progress.open(progressFile, std::ios::app);
+    }
+    long long resumed = 0;
+    for (int8_t d : done)
+        resumed += d;
+
+    std::mutex lock;
+    std::atomic<int> reported(0);
+    std::atomic<long long> multiplied(0);
+    auto start = std::chrono::steady_clock::now();
+    parallelFor(shards, threads, 1, [&](long long first, long long last, int)
+    {
+        const size_t block = 1 << 14;
+        std::vector<Word> md(block), mq(block);
+        std::vector<Product<Width>> products(block);
+        for (long long shard = first; shard < last; shard++)
+        {
+            if (done[shard])
+                continue;
+            long long begin = shard * SHARD_PAIRS;
+            long long end = begin + SHARD_PAIRS < pairs ? begin + SHARD_PAIRS : pairs;
+            long long failed = 0;
+            for (long long from = begin; from < end; from += block)
+            {
+                size_t n = end - from < (long long)block ? end - from : block;
+                for (size_t k = 0; k < n; k++)
+                {
+                    long long pair = from + k;
+                    md[k] = exhaustive ? Word(pair >> (pairBits / 2)) : sweepOperand<Width>(pair, 0);
+                    mq[k] = exhaustive ? Word(pair) : sweepOperand<Width>(pair, 1);
+                }
+                verifyMultiply<Width>(md.data(), mq.data(), products.data(), n, engine, radix, lanes, adder);
+                for (size_t k = 0; k < n; k++)
+                {
+                    Product<Width> native = nativeProduct<Width>(md[k], mq[k]);
+                    if (products[k].high == native.high && products[k].low == native.low)
+                        continue;
+                    failed++;
+                    if (reported++ < MAX_REPORTED_FAILURES)
+                    {
+                        typedef typename std::make_signed<Word>::type Signed;
+                        std::lock_guard<std::mutex> guard(lock);
+                        std::cout << "FAIL " << int128ToString(Signed(md[k])) << " * " << int128ToString(Signed(mq[k]))
+                                  << " = " << int128ToString(productValue(products[k])) << ", expected "
+                                  << int128ToString(productValue(native)) << std::endl;
+                    }
+                }
+            }
+            multiplied += end - begin;
+            std::lock_guard<std::mutex> guard(lock);
+            failures[shard] = failed;
+            if (progress.is_open())
+                progress << "shard " << shard << " " << failed << std::endl;
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long long failed = 0;
+    for (long long f : failures)
+        failed += f;
+    std::cout << "Verified " << pairs << " " << Width << " bit operand pairs" << (exhaustive ? " (all of them)" : "")
+              << " on the " << VERIFY_ENGINE_NAMES[engine] << " engine in radix " << radix
+              << (adder != ADDER_RIPPLE ? std::string(" with the ") + ADDER_NAMES[adder] + " adder" : "") << ": " << failed
+              << " wrong";
+    if (resumed > 0)
+        std::cout << ", " << resumed << " of " << shards << " shards done before";
+    std::cout << std::endl;
+    std::cout << multiplied << " pairs in " << seconds << " seconds, "
+              << (seconds > 0 ? multiplied / seconds : 0) << " pairs per second on " << threads << " threads" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+#endif
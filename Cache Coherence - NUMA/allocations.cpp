@@ -0,0 +1,57 @@
+/* Heap allocation counter, see allocations.h
+ * Every form of operator new is replaced, the matching operator deletes have to be replaced with them
+ */
+#include "allocations.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+using namespace std;
+
+static atomic<long long> allocationCount(0);
+
+long long heapAllocations()
+{
+    return allocationCount.load(memory_order_relaxed);
+}
+
+//counts one allocation of size bytes with the given alignment, returns nullptr if there is no memory
+static void* allocate(size_t size, size_t alignment)
+{
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+    if (alignment <= alignof(max_align_t))
+        return malloc(size);
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+static void* allocateOrThrow(size_t size, size_t alignment)
+{
+    void* memory = allocate(size, alignment);
+    if (memory == nullptr)
+        throw bad_alloc();
+    return memory;
+}
+
+void* operator new(size_t size) { return allocateOrThrow(size, 0); }
+void* operator new[](size_t size) { return allocateOrThrow(size, 0); }
+void* operator new(size_t size, align_val_t alignment) { return allocateOrThrow(size, size_t(alignment)); }
+void* operator new[](size_t size, align_val_t alignment) { return allocateOrThrow(size, size_t(alignment)); }
+void* operator new(size_t size, const nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new[](size_t size, const nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept { return allocate(size, size_t(alignment)); }
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept { return allocate(size, size_t(alignment)); }
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+void operator delete(void* memory, align_val_t) noexcept { free(memory); }
+void operator delete[](void* memory, align_val_t) noexcept { free(memory); }
+void operator delete(void* memory, size_t, align_val_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t, align_val_t) noexcept { free(memory); }
+void operator delete(void* memory, const nothrow_t&) noexcept { free(memory); }
+void operator delete[](void* memory, const nothrow_t&) noexcept { free(memory); }
+void operator delete(void* memory, align_val_t, const nothrow_t&) noexcept { free(memory); }
+void operator delete[](void* memory, align_val_t, const nothrow_t&) noexcept { free(memory); }
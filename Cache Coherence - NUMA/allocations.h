@@ -0,0 +1,12 @@
+/* Heap allocation counter
+ * allocations.cpp replaces the global operator new so every heap allocation made by the program is counted.
+ * main uses it for --count-allocations, which shows that replaying a trace does not allocate per instruction:
+ * .... the count stays the same however long the trace is.
+ */
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+// Returns the number of heap allocations made so far by any thread
+long long heapAllocations();
+
+#endif
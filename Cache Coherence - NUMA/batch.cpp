@@ -0,0 +1,69 @@
+/* Batch runner for the cc-NUMA simulator
+ * Each worker thread takes the next job index from a shared counter until every job has run
+ * Jobs share nothing, so no locking is needed beyond the counter
+ */
+#include "batch.h"
+#include "system.h"
+#include "snapshot.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+using namespace std;
+
+//runs a single job and collects its result
+static BatchResult runJob(const BatchJob& job)
+{
+    BatchResult result = {};
+    auto start = chrono::steady_clock::now();
+
+    unique_ptr<System> machine = job.resumePath.empty() ? unique_ptr<System>(new System(job.geometry))
+                                                        : loadSnapshot(job.resumePath);
+    if (!machine)
+        return result;
+    System& system = *machine;
+    result.ok = system.runTrace(job.tracePath);
+    result.geometry = system.geometry;
+    result.clockCount = system.clockCount;
+    result.remoteRatio = system.stats.remoteRatio();
+    result.stateHash = system.stateHash();
+
+    if (result.ok && !job.outPath.empty())
+    {
+        ofstream out(job.outPath);
+        system.printAll(out);
+        out << "\n --------------- \nTotal Clock Count: " << system.clockCount << endl;
+        out << "Remote Access Ratio: " << result.remoteRatio << endl;
+    }
+    if (result.ok && !job.statsPath.empty())
+    {
+        ofstream out(job.statsPath);
+        writeStatsJson(out, system.stats, system.geometry, system.pageTable, system.clockCount);
+    }
+
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+vector<BatchResult> runBatch(const vector<BatchJob>& jobs, int threads)
+{
+    vector<BatchResult> results(jobs.size());
+    if (threads <= 0)
+        threads = thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1;
+    if ((size_t)threads > jobs.size())
+        threads = jobs.size();
+
+    atomic<size_t> nextJob(0);
+    auto worker = [&]()
+    {
+        for (size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+            results[i] = runJob(jobs[i]);
+    };
+
+    vector<thread> pool;
+    for (int i = 0; i < threads; i++)
+        pool.emplace_back(worker);
+    for (thread& t : pool)
+        t.join();
+    return results;
+}
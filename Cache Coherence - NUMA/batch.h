@@ -0,0 +1,37 @@
+/* Batch runner for the cc-NUMA simulator
+ * Runs many independent traces or geometries in one process, one System per job, spread over a pool of threads
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "geometry.h"
+
+// One simulation to run, the final state is written to outPath and the stats report to statsPath
+// .... when they are not empty. A job with a resumePath starts from that checkpoint instead of a fresh system
+struct BatchJob
+{
+    std::string tracePath;
+    Geometry geometry;
+    std::string outPath;
+    std::string statsPath;
+    std::string resumePath;
+};
+
+// What is collected from each job once its trace has been replayed
+struct BatchResult
+{
+    bool ok;                // false if the trace or checkpoint could not be opened
+    Geometry geometry;      // the geometry that was simulated, a resumed job's comes from its checkpoint
+    long long clockCount;
+    double remoteRatio;     // Stats::remoteRatio, the share of accesses that left the requesting node
+    uint64_t stateHash;     // System::stateHash of the final state
+    double seconds;         // wall clock time of the replay
+};
+
+// Runs every job on a pool of threads (0 uses one thread per core), results are in job order
+std::vector<BatchResult> runBatch(const std::vector<BatchJob>& jobs, int threads);
+
+#endif
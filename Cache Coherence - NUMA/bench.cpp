@@ -0,0 +1,271 @@
+/* Microbenchmarks for the cc-NUMA simulator hot paths
+ * Measures instructions per second for each path through memoryAccess and writeToMem on its own
+ * .... (local hit, sister hit, home fetch, dirty remote, write hit and write miss), the throughput of
+ * .... decodeInstruction and the cost of printAll, for machines from the original 4 nodes up to 1024 nodes.
+ *
+ * Each case sets the machine up so that every instruction takes the path being measured, and puts back the one
+ * .... piece of state the instruction changed before the next one (for example invalidating the line a sister hit
+ * .... just filled). That reset is part of the measured time but is a single store or two.
+ * The stats counters are checked afterwards so a change to the protocol cannot silently measure the wrong path.
+ *
+ * Build and run
+ *      $> g++ -O2 -pthread bench.cpp system.cpp trace.cpp stats.cpp timing.cpp workload.cpp -lz -o bench
+ *      $> ./bench --out bench.json
+ * .... --min-time   seconds each measurement runs for at least (default 0.2)
+ * .... --max-nodes  largest machine measured (default 1024)
+ *
+ * The report is a JSON object with a format version and one entry per measurement, always in the same order
+ *      {"format": 1, "benchmarks": [
+ *          {"name": "load_local_hit", "nodes": 4, "cpus_per_node": 2, "iterations": 16777216,
+ *           "seconds": 0.21, "ops_per_second": 79891500, "ns_per_op": 12.5}, ...]}
+ */
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "system.h"
+#include "trace.h"
+using namespace std;
+
+struct BenchResult
+{
+    string name;
+    Geometry geometry;
+    long long iterations;
+    double seconds;
+};
+
+// A stream buffer that throws away what is written, so printAll is measured without any I/O
+class NullBuffer : public streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize count) override { return count; }
+};
+
+//runs body(iterations) with more and more iterations until it takes at least minTime seconds
+static BenchResult measure(const string& name, const Geometry& geometry, double minTime,
+                           const function<void(long long)>& body)
+{
+    BenchResult result = {name, geometry, 0, 0};
+    for (long long iterations = 1; ; iterations *= 2)
+    {
+        auto start = chrono::steady_clock::now();
+        body(iterations);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (seconds >= minTime || iterations >= (1ll << 40))
+        {
+            result.iterations = iterations;
+            result.seconds = seconds;
+            return result;
+        }
+    }
+}
+
+static TraceRecord record(int node, int cpu, uint32_t address, OpCode op)
+{
+    return {address, uint16_t(node), uint8_t(cpu), uint8_t(op)};
+}
+
+//the cache line of the processor that holds or will hold the address
+static CacheLine& lineOf(System& system, int node, int cpu, uint32_t address)
+{
+    const Geometry& g = system.geometry;
+    return system.nodes[node].cacheSet(cpu, blockOf(g, address) % g.sets)[0];
+}
+
+//measures one access path, setup runs once, reset runs before every instruction
+static BenchResult measureCase(AccessCase path, const Geometry& geometry, double minTime, const TraceRecord& access,
+                               const function<void(System&)>& setup, const function<void(System&)>& reset)
+{
+    System system(geometry);
+    setup(system);
+    CpuStats before = system.stats.cpus[access.node * system.geometry.cpusPerNode + access.cpu];
+    long long total = 0;
+    BenchResult result = measure(ACCESS_CASE_NAMES[path], geometry, minTime, [&](long long iterations)
+    {
+        for (long long i = 0; i < iterations; i++)
+        {
+            reset(system);
+            system.execute(access);
+        }
+        total += iterations;
+    });
+
+    const CpuStats& after = system.stats.cpus[access.node * system.geometry.cpusPerNode + access.cpu];
+    if (after.cases[path] - before.cases[path] != total)
+    {
+        cerr << ACCESS_CASE_NAMES[path] << " on " << geometry.nodes << " nodes took a different path "
+             << after.cases[path] - before.cases[path] << " of " << total << " times" << endl;
+        exit(1);
+    }
+    return result;
+}
+
+//measures every access path on one geometry
+static void accessCases(const Geometry& geometry, double minTime, vector<BenchResult>& results)
+{
+    // the requester is node 0 cpu 0, the address lives on node 2 and node 1 owns it when it is dirty
+    Geometry g = geometry;
+    deriveGeometry(g);
+    uint32_t address = 2 * g.memoryWords + 1;
+    TraceRecord load = record(0, 0, address, OP_LW);
+    TraceRecord store = record(0, 0, address, OP_SW);
+    auto nothing = [](System&) {};
+
+    results.push_back(measureCase(LOAD_LOCAL_HIT, geometry, minTime, load,
+        [&](System& s) { s.execute(load); }, nothing));
+
+    results.push_back(measureCase(LOAD_SISTER_HIT, geometry, minTime, load,
+        [&](System& s) { s.execute(record(0, 1, address, OP_LW)); },
+        [&](System& s) { lineOf(s, 0, 0, address).valid = false; }));
+
+    results.push_back(measureCase(LOAD_HOME, geometry, minTime, load, nothing,
+        [&](System& s) { lineOf(s, 0, 0, address).valid = false; }));
+
+    results.push_back(measureCase(LOAD_DIRTY_REMOTE, geometry, minTime, load,
+        [&](System& s)
+        {
+            s.execute(record(1, 0, address, OP_LW));
+            s.execute(record(1, 0, address, OP_SW));
+        },
+        [&](System& s)
+        {
+            int physical = s.physicalOf(address);
+            Node& home = s.nodes[physical / s.geometry.memoryWords];
+            int index = blockOf(s.geometry, physical) % s.geometry.memoryBlocks;
+            home.directory[index].state = DIRTY;
+            clearSharers(s.geometry, home.sharersOf(index));
+            addSharer(s.geometry, home.sharersOf(index), 1);
+            lineOf(s, 0, 0, address).valid = false;
+        }));
+
+    results.push_back(measureCase(STORE_HIT, geometry, minTime, store,
+        [&](System& s) { s.execute(load); }, nothing));
+
+    results.push_back(measureCase(STORE_MISS, geometry, minTime, store, nothing, nothing));
+}
+
+// Where the decode benchmark stores the sum of the decoded addresses, so the decoding cannot be optimized away
+static volatile uint32_t decodeSink;
+
+//measures decoding ASCII machine code, the lines cycle through every node, cpu and a spread of addresses
+static BenchResult decodeCase(const Geometry& geometry, double minTime)
+{
+    Geometry g = geometry;
+    deriveGeometry(g);
+    vector<string> lines;
+    for (int i = 0; i < 4096; i++)
+    {
+        int node = i % g.nodes;
+        int cpu = i / g.nodes % g.cpusPerNode;
+        int offset = (i * 7 % 8192) * 4;
+        string line;
+        for (int b = g.nodeBits - 1; b >= 0; b--)
+            line += char('0' + ((node >> b) & 1));
+        for (int b = g.cpuBits - 1; b >= 0; b--)
+            line += char('0' + ((cpu >> b) & 1));
+        line += ": ";
+        line += i % 3 ? "100011" : "101011";
+        line += "00000";
+        line += i % 2 ? "10001" : "10010";
+        for (int b = 15; b >= 0; b--)
+            line += char('0' + ((offset >> b) & 1));
+        lines.push_back(line);
+    }
+
+    uint32_t sum = 0;
+    BenchResult result = measure("decode", geometry, minTime, [&](long long iterations)
+    {
+        TraceRecord decoded;
+        for (long long i = 0; i < iterations; i++)
+        {
+            if (!decodeInstruction(lines[i % lines.size()], g, decoded))
+            {
+                cerr << "decode benchmark built a malformed line: " << lines[i % lines.size()] << endl;
+                exit(1);
+            }
+            sum += decoded.address;
+        }
+    });
+    decodeSink = sum;
+    return result;
+}
+
+//measures printAll of a freshly built machine into a stream that discards the text
+static BenchResult printCase(const Geometry& geometry, double minTime)
+{
+    System system(geometry);
+    NullBuffer buffer;
+    ostream out(&buffer);
+    return measure("print_all", geometry, minTime, [&](long long iterations)
+    {
+        for (long long i = 0; i < iterations; i++)
+            system.printAll(out);
+    });
+}
+
+static void writeJson(ostream& out, const vector<BenchResult>& results)
+{
+    out << "{\"format\": 1, \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult& r = results[i];
+        double perSecond = r.iterations / r.seconds;
+        out << (i ? ",\n    " : "\n    ") << "{\"name\": \"" << r.name << "\", \"nodes\": " << r.geometry.nodes
+            << ", \"cpus_per_node\": " << r.geometry.cpusPerNode << ", \"iterations\": " << r.iterations
+            << ", \"seconds\": " << r.seconds << ", \"ops_per_second\": " << perSecond
+            << ", \"ns_per_op\": " << 1e9 / perSecond << "}";
+    }
+    out << "\n]}\n";
+}
+
+int main(int argc, char* argv[])
+{
+    string outPath;
+    double minTime = 0.2;
+    int maxNodes = 1024;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc)
+            outPath = argv[++i];
+        else if (arg == "--min-time" && i + 1 < argc)
+            minTime = atof(argv[++i]);
+        else if (arg == "--max-nodes" && i + 1 < argc)
+            maxNodes = atoi(argv[++i]);
+        else
+        {
+            cerr << "Usage: bench [--out results.json] [--min-time seconds] [--max-nodes N]" << endl;
+            return 1;
+        }
+    }
+
+    // the original 4 x 2 machine, then 4 times as many nodes each step
+    vector<BenchResult> results;
+    for (int nodes = 4; nodes <= maxNodes; nodes *= 4)
+    {
+        Geometry geometry;
+        geometry.nodes = nodes;
+        accessCases(geometry, minTime, results);
+        results.push_back(decodeCase(geometry, minTime));
+        results.push_back(printCase(geometry, minTime));
+    }
+
+    if (outPath.empty())
+    {
+        writeJson(cout, results);
+        return 0;
+    }
+    ofstream out(outPath);
+    if (!out)
+    {
+        cerr << "Could not open " << outPath << endl;
+        return 1;
+    }
+    writeJson(out, results);
+    return 0;
+}
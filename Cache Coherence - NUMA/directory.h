@@ -0,0 +1,135 @@
+/* Directory sharer formats
+ * Every directory entry has geometry.sharerWords 64 bit words recording which nodes may hold a copy of the block.
+ * How the words are used depends on geometry.directory
+ * .... DIR_FULL      bit n is set when node n holds a copy (the original DASH bit vector)
+ * .... DIR_COARSE    bit g is set when any node of the group g * directoryParam .. (g+1) * directoryParam - 1
+ * ....               may hold a copy, a node leaving cannot clear its group's bit
+ * .... DIR_POINTERS  up to directoryParam node numbers kept as 16 bit slots after a 16 bit count,
+ * ....               when more nodes share the block the count becomes BROADCAST and every node may hold a copy
+ * The coarse and pointer formats need fewer bits per entry but invalidate nodes that may not hold the block.
+ * Sharers are visited with forEachSharer, which only looks at the set bits or the listed pointers,
+ * .... so the cost of an invalidation follows the number of sharers and not the number of nodes
+ */
+#ifndef DIRECTORY_H
+#define DIRECTORY_H
+
+#include <cstdint>
+#include "geometry.h"
+
+const uint16_t BROADCAST = 0xFFFF;
+
+//the 16 bit slot of a pointer directory entry, slot 0 is the count and slots 1 .. directoryParam the nodes
+inline uint16_t pointerSlot(const uint64_t* sharers, int slot)
+{
+    return uint16_t(sharers[slot / 4] >> (slot % 4 * 16));
+}
+
+inline void setPointerSlot(uint64_t* sharers, int slot, uint16_t value)
+{
+    int shift = slot % 4 * 16;
+    sharers[slot / 4] = (sharers[slot / 4] & ~(uint64_t(0xFFFF) << shift)) | (uint64_t(value) << shift);
+}
+
+//calls visit with every node that may hold a copy of the block, in increasing order for the bit vector formats
+template <class Visit>
+inline void forEachSharer(const Geometry& geometry, const uint64_t* sharers, Visit visit)
+{
+    if (geometry.directory == DIR_POINTERS)
+    {
+        uint16_t count = pointerSlot(sharers, 0);
+        if (count == BROADCAST)
+        {
+            for (int node = 0; node < geometry.nodes; node++)
+                visit(node);
+        }
+        for (int i = 1; count != BROADCAST && i <= count; i++)
+            visit(pointerSlot(sharers, i));
+        return;
+    }
+
+    int group = geometry.directory == DIR_COARSE ? geometry.directoryParam : 1;
+    for (int w = 0; w < geometry.sharerWords; w++)
+    {
+        for (uint64_t bits = sharers[w]; bits != 0; bits &= bits - 1)
+        {
+            int first = (w * 64 + __builtin_ctzll(bits)) * group;
+            int last = first + group < geometry.nodes ? first + group : geometry.nodes;
+            for (int node = first; node < last; node++)
+                visit(node);
+        }
+    }
+}
+
+//returns true if the node may hold a copy of the block
+inline bool hasSharer(const Geometry& geometry, const uint64_t* sharers, int node)
+{
+    if (geometry.directory == DIR_POINTERS)
+    {
+        uint16_t count = pointerSlot(sharers, 0);
+        if (count == BROADCAST)
+            return true;
+        for (int i = 1; i <= count; i++)
+            if (pointerSlot(sharers, i) == node)
+                return true;
+        return false;
+    }
+    int bit = geometry.directory == DIR_COARSE ? node / geometry.directoryParam : node;
+    return (sharers[bit / 64] >> (bit % 64)) & 1u;
+}
+
+inline void addSharer(const Geometry& geometry, uint64_t* sharers, int node)
+{
+    if (geometry.directory == DIR_POINTERS)
+    {
+        uint16_t count = pointerSlot(sharers, 0);
+        if (count == BROADCAST || hasSharer(geometry, sharers, node))
+            return;
+        if (count == geometry.directoryParam)
+            setPointerSlot(sharers, 0, BROADCAST);
+        else
+        {
+            setPointerSlot(sharers, count + 1, node);
+            setPointerSlot(sharers, 0, count + 1);
+        }
+        return;
+    }
+    int bit = geometry.directory == DIR_COARSE ? node / geometry.directoryParam : node;
+    sharers[bit / 64] |= uint64_t(1) << (bit % 64);
+}
+
+//the node no longer holds a copy, coarse vectors and overflowed pointer entries cannot record that
+inline void removeSharer(const Geometry& geometry, uint64_t* sharers, int node)
+{
+    if (geometry.directory == DIR_FULL)
+        sharers[node / 64] &= ~(uint64_t(1) << (node % 64));
+    else if (geometry.directory == DIR_POINTERS)
+    {
+        uint16_t count = pointerSlot(sharers, 0);
+        for (int i = 1; count != BROADCAST && i <= count; i++)
+        {
+            if (pointerSlot(sharers, i) == node)
+            {
+                setPointerSlot(sharers, i, pointerSlot(sharers, count));
+                setPointerSlot(sharers, count, 0);
+                setPointerSlot(sharers, 0, count - 1);
+                return;
+            }
+        }
+    }
+}
+
+inline void clearSharers(const Geometry& geometry, uint64_t* sharers)
+{
+    for (int i = 0; i < geometry.sharerWords; i++)
+        sharers[i] = 0;
+}
+
+inline bool anySharer(const Geometry& geometry, const uint64_t* sharers)
+{
+    for (int i = 0; i < geometry.sharerWords; i++)
+        if (sharers[i])
+            return true;
+    return false;
+}
+
+#endif
@@ -0,0 +1,224 @@
+/* Incremental event log of the simulation, see events.h
+ */
+#include "events.h"
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+static const char* stateName(DirState state)
+{
+    switch (state)
+    {
+        case UNCACHED: return "uncached";
+        case SHARED: return "shared";
+        case OWNED: return "owned";
+        case DIRTY: return "dirty";
+    }
+    return "unknown";
+}
+
+bool EventLog::open(const string& path)
+{
+    out.open(path);
+    if (!out)
+    {
+        cerr << "Could not open " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+//remembers the memory words and directory entry of a block
+//a block whose page has not been placed yet has its starting values and is uncached (see placement.h)
+void EventLog::capture(const System& system, int block)
+{
+    const Geometry& geometry = system.geometry;
+    BlockState state;
+    state.address = block * geometry.lineWords;
+    if (system.pageTable.frames[state.address >> geometry.pageBits] == NO_FRAME)
+    {
+        for (int w = 0; w < geometry.lineWords; w++)
+            state.values.push_back(state.address + w + 5);
+        state.state = UNCACHED;
+        state.sharers.assign(geometry.sharerWords, 0);
+        blocks.push_back(state);
+        return;
+    }
+    int physical = system.physicalOf(state.address);
+    const Node& home = system.nodes[physical / geometry.memoryWords];
+    int localBlock = blockOf(geometry, physical) % geometry.memoryBlocks;
+    const uint32_t* memory = &home.memory[localBlock * geometry.lineWords];
+    const uint64_t* sharers = home.sharersOf(localBlock);
+
+    state.values.assign(memory, memory + geometry.lineWords);
+    state.state = home.directory[localBlock].state;
+    state.sharers.assign(sharers, sharers + geometry.sharerWords);
+    blocks.push_back(state);
+}
+
+void EventLog::before(System& system, const TraceRecord& record)
+{
+    const Geometry& geometry = system.geometry;
+    blocks.clear();
+    invalidated.clear();
+    downgraded.clear();
+    inside = record.node < geometry.nodes && record.cpu < geometry.cpusPerNode
+             && record.address < (uint32_t)geometry.totalWords;
+    if (!inside)
+        return;
+
+    const Node& node = system.nodes[record.node];
+    int block = blockOf(geometry, record.address);
+    int set = block % geometry.sets;
+    regBefore = node.reg(record.cpu, registerOf(record));
+    const CacheLine* lines = node.cacheSet(record.cpu, set);
+    setBefore.assign(lines, lines + geometry.ways);
+    dataBefore.assign(node.dataOf(lines[0]), node.dataOf(lines[0]) + geometry.ways * geometry.lineWords);
+    clocksBefore = system.clockCount;
+    const CpuStats& cpu = system.stats.cpus[record.node * geometry.cpusPerNode + record.cpu];
+    memcpy(casesBefore, cpu.cases, sizeof(casesBefore));
+
+    capture(system, block);
+    for (const CacheLine& line : setBefore)
+    {
+        int evicted = line.tag * geometry.sets + set;
+        if (line.valid && evicted != block)
+            capture(system, evicted);
+    }
+
+    system.invalidationLog = &invalidated;
+    system.downgradeLog = &downgraded;
+}
+
+//writes a change record for every word of the block whose memory changed and for its directory entry if it changed
+void EventLog::writeBlock(const System& system, const BlockState& block, bool& first)
+{
+    const Geometry& geometry = system.geometry;
+    if (system.pageTable.frames[block.address >> geometry.pageBits] == NO_FRAME)
+        return;
+    int physical = system.physicalOf(block.address);
+    const Node& home = system.nodes[physical / geometry.memoryWords];
+    int localIndex = physical % geometry.memoryWords;
+    int localBlock = localIndex / geometry.lineWords;
+    const uint64_t* sharers = home.sharersOf(localBlock);
+
+    for (int w = 0; w < geometry.lineWords; w++)
+    {
+        if (home.memory[localIndex + w] != block.values[w])
+        {
+            out << (first ? "" : ", ") << "{\"memory\": " << block.address + w << ", \"value\": " << home.memory[localIndex + w] << "}";
+            first = false;
+        }
+    }
+    if (home.directory[localBlock].state != block.state
+        || memcmp(sharers, block.sharers.data(), geometry.sharerWords * sizeof(uint64_t)) != 0)
+    {
+        out << (first ? "" : ", ") << "{\"directory\": " << block.address << ", \"state\": \""
+            << stateName(home.directory[localBlock].state) << "\", \"sharers\": [";
+        bool firstSharer = true;
+        forEachSharer(geometry, sharers, [&](int i)
+        {
+            out << (firstSharer ? "" : ", ") << i;
+            firstSharer = false;
+        });
+        out << "]}";
+        first = false;
+    }
+}
+
+void EventLog::after(System& system, const TraceRecord& record)
+{
+    const Geometry& geometry = system.geometry;
+    system.invalidationLog = nullptr;
+    system.downgradeLog = nullptr;
+    out << "{\"i\": " << index++ << ", \"node\": " << record.node << ", \"cpu\": " << (int)record.cpu;
+    OpCode op = opcodeOf(record);
+    out << ", \"op\": ";
+    if (op == OP_LW)
+        out << "\"lw\"";
+    else if (op == OP_SW)
+        out << "\"sw\"";
+    else
+        out << (int)op;
+    out << ", \"address\": " << record.address;
+    if (!inside)
+    {
+        out << ", \"skipped\": true}\n";
+        return;
+    }
+
+    const CpuStats& cpu = system.stats.cpus[record.node * geometry.cpusPerNode + record.cpu];
+    for (int i = 0; i < CASE_COUNT; i++)
+        if (cpu.cases[i] != casesBefore[i])
+            out << ", \"case\": \"" << ACCESS_CASE_NAMES[i] << "\"";
+    out << ", \"clocks\": " << system.clockCount - clocksBefore << ", \"changes\": [";
+
+    bool first = true;
+    const Node& node = system.nodes[record.node];
+    int reg = registerOf(record);
+    if (node.reg(record.cpu, reg) != regBefore)
+    {
+        out << "{\"reg\": \"$s" << reg + 1 << "\", \"node\": " << record.node << ", \"cpu\": " << (int)record.cpu
+            << ", \"value\": " << node.reg(record.cpu, reg) << "}";
+        first = false;
+    }
+
+    int set = blockOf(geometry, record.address) % geometry.sets;
+    for (int way = 0; way < geometry.ways; way++)
+    {
+        const CacheLine& line = node.cacheSet(record.cpu, set)[way];
+        const CacheLine& lineBefore = setBefore[way];
+        const uint32_t* data = node.dataOf(line);
+        if (line.valid != lineBefore.valid || line.tag != lineBefore.tag || line.state != lineBefore.state
+            || memcmp(data, &dataBefore[way * geometry.lineWords], geometry.lineWords * sizeof(uint32_t)) != 0)
+        {
+            out << (first ? "" : ", ") << "{\"cache\": " << set * geometry.ways + way << ", \"node\": " << record.node
+                << ", \"cpu\": " << (int)record.cpu << ", \"valid\": " << line.valid << ", \"tag\": " << line.tag
+                << ", \"data\": ";
+            if (geometry.lineWords == 1)
+                out << data[0];
+            else
+            {
+                for (int w = 0; w < geometry.lineWords; w++)
+                    out << (w == 0 ? "[" : ", ") << data[w];
+                out << "]";
+            }
+            if (geometry.protocol != PROTO_DASH)
+                out << ", \"state\": \"" << LINE_STATE_NAMES[line.state] << "\"";
+            out << "}";
+            first = false;
+        }
+    }
+    for (int invalidatedLine : invalidated)
+    {
+        int globalCpu = invalidatedLine / geometry.cacheLines;
+        out << (first ? "" : ", ") << "{\"cache\": " << invalidatedLine % geometry.cacheLines << ", \"node\": "
+            << globalCpu / geometry.cpusPerNode << ", \"cpu\": " << globalCpu % geometry.cpusPerNode << ", \"valid\": 0}";
+        first = false;
+    }
+    for (int downgradedLine : downgraded)
+    {
+        int globalCpu = downgradedLine / geometry.cacheLines;
+        const CacheLine& line = system.nodes[globalCpu / geometry.cpusPerNode].cache(globalCpu % geometry.cpusPerNode,
+                                                                                    downgradedLine % geometry.cacheLines);
+        out << (first ? "" : ", ") << "{\"cache\": " << downgradedLine % geometry.cacheLines << ", \"node\": "
+            << globalCpu / geometry.cpusPerNode << ", \"cpu\": " << globalCpu % geometry.cpusPerNode << ", \"state\": \""
+            << LINE_STATE_NAMES[line.state] << "\"}";
+        first = false;
+    }
+
+    for (const BlockState& block : blocks)
+        writeBlock(system, block, first);
+    out << "]}\n";
+}
+
+bool runTraceWithEvents(System& system, const string& path, EventLog& log, long long until)
+{
+    log.startAt(system.instructionCount);
+    return forEachRecord(path, system.geometry, [&](const TraceRecord& record)
+    {
+        log.before(system, record);
+        system.execute(record);
+        log.after(system, record);
+    }, system.instructionCount, until);
+}
@@ -0,0 +1,71 @@
+/* Incremental event log of the simulation
+ * Instead of dumping every bit of the machine at the end, one JSON line is written per instruction
+ * .... listing only the state it changed. For example
+ *
+ * {"i": 7, "node": 3, "cpu": 0, "op": "lw", "address": 27, "case": "load_dirty_remote", "clocks": 135, "changes": [
+ *     {"reg": "$s1", "node": 3, "cpu": 0, "value": 62},
+ *     {"cache": 3, "node": 3, "cpu": 0, "valid": 1, "tag": 6, "data": 62},
+ *     {"memory": 27, "value": 62},
+ *     {"directory": 27, "state": "shared", "sharers": [1, 3]}]}
+ *
+ * "i" is the instruction's position in the trace, a run resumed from a checkpoint carries on from the checkpoint's
+ * .... instructionCount so its log lines up with the log of the run that saved it.
+ * An instruction can only change its own register, the lines of its own cache set, lines it invalidates and the memory words
+ * .... and directory entry of its block or of the block it evicts, so only those are compared.
+ * With more than one word per line (--line-size) "data" is the array of the line's words
+ * .... and a directory entry is named by the address of its block's first word.
+ * Under MSI, MESI and MOESI a load can also change the state of the copy it was served from, which is listed with its "state".
+ */
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "system.h"
+
+class EventLog
+{
+public:
+    // opens the log file, returns false if it could not be created
+    bool open(const std::string& path);
+
+    // numbers the next instruction logged, its position in the trace
+    void startAt(long long instruction) { index = instruction; }
+
+    // call before and after executing each instruction in trace order
+    void before(System& system, const TraceRecord& record);
+    void after(System& system, const TraceRecord& record);
+
+private:
+    // the memory words and directory entry of one block
+    struct BlockState
+    {
+        int address;                    // the block's first word
+        std::vector<uint32_t> values;
+        DirState state;
+        std::vector<uint64_t> sharers;
+    };
+
+    std::ofstream out;
+    long long index = 0;
+    bool inside;
+    uint32_t regBefore;
+    std::vector<CacheLine> setBefore;   // the ways of the instruction's cache set
+    std::vector<uint32_t> dataBefore;   // and their words
+    long long clocksBefore;
+    long long casesBefore[CASE_COUNT];
+    std::vector<BlockState> blocks;     // the address's block and the blocks the access may evict
+    std::vector<int> invalidated;       // filled in by the system while the instruction runs
+    std::vector<int> downgraded;
+
+    void capture(const System& system, int block);
+    void writeBlock(const System& system, const BlockState& block, bool& first);
+};
+
+// Replays a trace through the system writing an event for every instruction
+// .... from system.instructionCount up to until (-1 for the whole trace), the same as System::runTrace
+// returns false if the trace could not be opened
+bool runTraceWithEvents(System& system, const std::string& path, EventLog& log, long long until = -1);
+
+#endif
@@ -0,0 +1,187 @@
+/* Geometry of the simulated cc-NUMA machine
+ * The defaults are the original 4 node DASH system: 2 cpus/node, 4 cache lines/cpu and 16 words of memory/node
+ */
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+// How a processor's cache picks the way to replace within a set, see replacement.h
+enum Replacement
+{
+    REPLACE_LRU,        // least recently used
+    REPLACE_PLRU,       // tree pseudo-LRU, needs a power of two ways
+    REPLACE_RANDOM      // a per-set random sequence, the same on every run
+};
+
+// How a directory entry records the nodes sharing a block, see directory.h
+enum DirectoryFormat
+{
+    DIR_FULL,           // one bit per node
+    DIR_COARSE,         // one bit per group of directoryParam nodes
+    DIR_POINTERS        // directoryParam node numbers, every node once they overflow
+};
+
+// The coherence protocol of the caches, see protocol.h
+enum Protocol
+{
+    PROTO_DASH,         // the original uncached/shared/dirty scheme, a store hit never leaves the cache
+    PROTO_MSI,          // per line states, a store hit on a shared copy upgrades it at home
+    PROTO_MESI,         // adds an Exclusive state, a load of an uncached block can be written without an upgrade
+    PROTO_MOESI         // also adds an Owned state, a dirty block is shared without writing it back first
+};
+
+// How the nodes are connected, see topology.h
+enum Topology
+{
+    TOPO_FLAT,          // the original model, every remote access costs its fixed latency whichever nodes it involves
+    TOPO_RING,          // a bidirectional ring
+    TOPO_MESH,          // a 2D mesh of topologyParam columns
+    TOPO_TORUS,         // a 2D mesh whose rows and columns wrap around
+    TOPO_FAT_TREE       // the nodes are the leaves of a topologyParam-ary tree whose links widen towards the root
+};
+
+// How pages of the global address space are given frames of the nodes' memory, see placement.h
+enum Placement
+{
+    PLACE_BLOCK,        // the original layout, node n holds the words n * memoryWords onwards
+    PLACE_INTERLEAVED,  // page p lives on node p % nodes
+    PLACE_FIRST_TOUCH,  // a page lives on the node that accessed it first
+    PLACE_ROUND_ROBIN   // pages are handed to the nodes in turn as they are first accessed
+};
+
+// The names used for the policies and formats on the command line and in reports
+static const char* const REPLACEMENT_NAMES[] = {"lru", "plru", "random"};
+static const char* const DIRECTORY_NAMES[] = {"full", "coarse", "pointers"};
+static const char* const PROTOCOL_NAMES[] = {"dash", "msi", "mesi", "moesi"};
+static const char* const TOPOLOGY_NAMES[] = {"flat", "ring", "mesh", "torus", "fat-tree"};
+static const char* const PLACEMENT_NAMES[] = {"block", "interleaved", "first-touch", "round-robin"};
+
+/*
+ * Geometry holds the size of the simulated machine
+ * The derived fields are filled in by deriveGeometry()
+ */
+struct Geometry
+{
+    int nodes = 4;          // SMP nodes in the system
+    int cpusPerNode = 2;    // processors per node
+    int cacheLines = 4;     // lines in each processor's cache
+    int memoryWords = 16;   // words of memory per node
+    int lineWords = 1;      // words in each cache line and directory block, a power of two dividing memoryWords
+    int ways = 1;           // lines per cache set, 1 is direct mapped and cacheLines is fully associative
+    Replacement replacement = REPLACE_LRU;
+    DirectoryFormat directory = DIR_FULL;
+    int directoryParam = 1;     // nodes per bit of a coarse vector or pointers per entry
+    Protocol protocol = PROTO_DASH;
+    bool writeAllocate = false; // a write miss loads the block into the cache instead of only updating memory
+    Topology topology = TOPO_FLAT;
+    int topologyParam = 0;      // columns of a mesh or torus, arity of a fat tree, 0 picks the default
+    int hopClocks = 10;         // clocks each hop of a message beyond the first adds under a topology
+    Placement placement = PLACE_BLOCK;
+    int pageWords = 0;          // words per page, a power of two, 0 picks a quarter of a node's memory (at least a line)
+    int migrateAfter = 0;       // remote accesses in a row from one node that move a page there, 0 never migrates
+
+    int sets;               // cacheLines / ways sets in each cache
+    int totalWords;         // size of the global address space in words
+    int memoryBlocks;       // memoryWords / lineWords blocks of memory per node, each with a directory entry
+    int lineBits;           // width of the word offset within a block
+    int nodeBits;           // width of the node field in an instruction
+    int cpuBits;            // width of the cpu field in an instruction
+    int tagBits;            // width of the cache tag field
+    int sharerWords;        // 64 bit words needed for one directory entry's sharers
+    int columns;            // mesh and torus columns or fat tree arity, topologyParam or its default
+    int rows;               // mesh and torus rows or fat tree levels
+    int pageBits;           // width of the word offset within a page, pageWords or its default
+    int framesPerNode;      // memoryWords >> pageBits page frames in each node
+};
+
+//returns the number of bits needed to represent the values 0 to count-1
+inline int bitsFor(int count)
+{
+    int bits = 0;
+    while ((1 << bits) < count)
+        bits++;
+    return bits;
+}
+
+//fills in the derived fields of the geometry from the configured sizes
+inline void deriveGeometry(Geometry& geometry)
+{
+    geometry.sets = geometry.cacheLines / geometry.ways;
+    geometry.totalWords = geometry.nodes * geometry.memoryWords;
+    geometry.memoryBlocks = geometry.memoryWords / geometry.lineWords;
+    geometry.lineBits = bitsFor(geometry.lineWords);
+    geometry.nodeBits = bitsFor(geometry.nodes);
+    geometry.cpuBits = bitsFor(geometry.cpusPerNode);
+    int blocks = geometry.nodes * geometry.memoryBlocks;
+    int tags = (blocks + geometry.sets - 1) / geometry.sets;
+    geometry.tagBits = bitsFor(tags) > 0 ? bitsFor(tags) : 1;
+    if (geometry.directory == DIR_POINTERS)
+        geometry.sharerWords = ((geometry.directoryParam + 1) * 16 + 63) / 64;
+    else if (geometry.directory == DIR_COARSE)
+        geometry.sharerWords = ((geometry.nodes + geometry.directoryParam - 1) / geometry.directoryParam + 63) / 64;
+    else
+        geometry.sharerWords = (geometry.nodes + 63) / 64;
+
+    int pageSize = geometry.pageWords;
+    if (pageSize <= 0)
+    {
+        pageSize = geometry.lineWords;
+        while (pageSize * 2 <= geometry.memoryWords / 4 && geometry.memoryWords % (pageSize * 2) == 0)
+            pageSize *= 2;
+    }
+    geometry.pageBits = bitsFor(pageSize);
+    geometry.framesPerNode = geometry.memoryWords >> geometry.pageBits;
+
+    // a mesh is as square as the node count allows, a fat tree is 4-ary unless told otherwise
+    geometry.columns = geometry.topologyParam;
+    if (geometry.columns <= 0 && geometry.topology == TOPO_FAT_TREE)
+        geometry.columns = 4;
+    else if (geometry.columns <= 0)
+    {
+        geometry.columns = geometry.nodes;
+        for (int rows = 1; rows * rows <= geometry.nodes; rows++)
+            if (geometry.nodes % rows == 0)
+                geometry.columns = geometry.nodes / rows;
+    }
+    geometry.rows = geometry.nodes / geometry.columns;
+    if (geometry.topology == TOPO_FAT_TREE && geometry.columns >= 2)
+    {
+        geometry.rows = 0;
+        for (long long leaves = 1; leaves < geometry.nodes; leaves *= geometry.columns)
+            geometry.rows++;
+    }
+}
+
+//returns the block holding a word address, the block picks the cache set, tag and directory entry
+inline int blockOf(const Geometry& geometry, int address)
+{
+    return address >> geometry.lineBits;
+}
+
+//returns why the cache shape cannot be simulated, or nullptr if it can
+inline const char* cacheShapeError(const Geometry& geometry)
+{
+    // word addresses are ints in the simulator and 32 bit in a trace record
+    if ((long long)geometry.nodes * geometry.memoryWords > 0x7FFFFFFF)
+        return "--nodes times --memory has to be below 2^31 words, the size of the global address space";
+    if (geometry.lineWords <= 0 || geometry.lineWords > 32 || (geometry.lineWords & (geometry.lineWords - 1)) != 0
+        || geometry.memoryWords % geometry.lineWords != 0)
+        return "--line-size has to be a power of two from 4 to 128 bytes and divide the memory of a node";
+    if (geometry.ways <= 0 || geometry.ways > 32 || geometry.cacheLines % geometry.ways != 0)
+        return "--ways has to be between 1 and 32 and divide --lines";
+    if (geometry.replacement == REPLACE_PLRU && (geometry.ways & (geometry.ways - 1)) != 0)
+        return "plru replacement needs a power of two ways";
+    if (geometry.directoryParam <= 0 || (geometry.directory == DIR_POINTERS && geometry.directoryParam >= 0xFFFF))
+        return "--directory needs a group size or pointer count of at least 1 (and below 65535 pointers)";
+    if (geometry.topologyParam < 0 || ((geometry.topology == TOPO_MESH || geometry.topology == TOPO_TORUS)
+                                       && geometry.topologyParam > 0 && geometry.nodes % geometry.topologyParam != 0)
+        || (geometry.topology == TOPO_FAT_TREE && geometry.topologyParam == 1))
+        return "--topology needs mesh and torus columns that divide --nodes and a fat tree arity of at least 2";
+    if (geometry.pageWords < 0 || (geometry.pageWords > 0 && ((geometry.pageWords & (geometry.pageWords - 1)) != 0
+                                   || geometry.pageWords < geometry.lineWords || geometry.memoryWords % geometry.pageWords != 0)))
+        return "--page-size has to be a power of two of at least --line-size that divides the memory of a node";
+    if (geometry.migrateAfter < 0)
+        return "--migrate needs a count of remote accesses";
+    return nullptr;
+}
+
+#endif
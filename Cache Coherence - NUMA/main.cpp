@@ -7,7 +7,7 @@
  * ........ 1 memory module
  * ........ 1 directory
  * The system has 64 words of globally addressed memory which evenly distributed across all 4 nodes (16 words/Node)
- * The cache system is direct mapped and uses WB when write hit and no-write allocate on write miss
+ * The cache system is direct mapped (or set-associative with --ways) and uses WB when write hit and no-write allocate on write miss
  *
  * This program will take an input file containing machine code ("machine_code.txt") with load and store instructions.
  * After performing the instructions (8 in the test case) it will output the contents of each Node's contents
@@ -18,595 +18,577 @@
  * To run the program make sure that both this file and machine_code.txt are in the same directory.
  * Compile this program using a c++ compiler. The following steps are for a linux machine, some steps may be different depending on your system/
  * Execute the following instructions in while inside the correct directory
- *      $> g++ main.cpp -o XanderIsCool
+ *      $> g++ -O2 -pthread main.cpp system.cpp trace.cpp batch.cpp shard.cpp stats.cpp \
+ *              events.cpp snapshot.cpp timing.cpp allocations.cpp workload.cpp -lz -o XanderIsCool
  *      $> ./XanderIsCool
+ * .... or build the XanderIsCool target with the CMakeLists.txt at the top of the repository
+ *
+ * The default machine is the 4 node system described above. The geometry can be changed on the command line
+ *      $> ./XanderIsCool --nodes 64 --cpus 4 --lines 1024 --memory 256
+ * .... --nodes   number of SMP nodes
+ * .... --cpus    processors per node
+ * .... --lines   cache lines per processor
+ * .... --memory  words of memory per node
+ * .... --ways    lines per cache set (default 1, direct mapped)
+ * .... --line-size bytes in each cache line and directory block, a power of two from 4 (one word, the default) to 128
+ * ........ a miss loads the whole block so sequential accesses hit on the words after the first
+ * .... --replacement lru, plru or random, how a set-associative cache picks the line to replace (see replacement.h)
+ * .... --directory full, coarse:K or pointers:P, the sharer format of the directory entries (see directory.h)
+ * ........ coarse:K keeps one bit per K nodes and pointers:P keeps up to P node numbers before broadcasting
+ * .... --protocol dash, msi, mesi or moesi, the coherence protocol (see protocol.h), dash is the original scheme
+ * .... --write-allocate  a write miss loads the block into the writer's cache instead of only updating memory
+ * .... --topology flat, ring, mesh[:C], torus[:C] or fat-tree[:K], how the nodes are connected (see topology.h)
+ * ........ flat is the original model, otherwise every hop of a message beyond the first adds --hop-clocks (default 10)
+ * ........ a mesh or torus has C columns (as square as possible by default) and a fat tree K children per switch (4)
+ * .... --placement block, interleaved, first-touch or round-robin, which node's memory each page lives in (see placement.h)
+ * ........ block is the original layout, first-touch and round-robin place a page when it is first accessed
+ * .... --page-size bytes in each page, a power of two of at least --line-size (a quarter of a node's memory by default)
+ * .... --migrate N  a page moves to a node after N remote accesses from it in a row
+ * ........ the remote access ratio is printed after the clock count, and with the migrations in the stats report
+ * The node and cpu fields at the front of each instruction grow to fit the geometry (see decodeInstruction)
+ *
+ * Large traces can be compiled once into a binary trace which is memory mapped and replayed without any parsing
+ *      $> ./XanderIsCool --trace big_trace.txt --compile big_trace.trc
+ *      $> ./XanderIsCool --trace big_trace.trc
+ * .... the trace records the nodes, cpus and memory it was compiled for and is rejected under any others
+ *
+ * Traces that are not compiled are read and decoded ahead on a separate thread (see TraceStream in trace.h),
+ * .... they may be gzip compressed, and "-" reads the trace from stdin
+ *      $> ./XanderIsCool --trace big_trace.txt.gz
+ *      $> generate_trace | ./XanderIsCool --trace - --compile big_trace.trc
+ *
+ * Instead of a trace a synthetic workload can generate the instructions in memory (see workload.h), the patterns
+ * .... are producer-consumer, migratory, read-mostly, false-sharing, uniform and hot-spot, each with a seed
+ * .... and its own parameters. --workload SPEC is the same as --trace workload:SPEC
+ *      $> ./XanderIsCool --nodes 64 --workload migratory,count=10000000,seed=7,objects=16 --no-dump --stats report.json
+ *      $> ./XanderIsCool --workload hot-spot,count=1000000,hot=90 --compile hot_spot.trc
+ *
+ * Many independent simulations can be run in one process with a batch file, one job per line
+ *      $> ./XanderIsCool --batch jobs.txt --threads 8
+ * .... each line holds the same options as the command line plus --out to save that job's final state, for example
+ * ........ --trace big_trace.trc --nodes 64 --lines 1024 --out big_64.txt
+ * .... the clock count and a hash of the final state of each job are printed once all jobs finish
+ *
+ * Counters for every path through the memory system (local hit, sister hit, home memory, dirty remote,
+ * .... write hit and write miss) per processor, invalidations, write-backs and per-address hotness
+ * .... can be written as a JSON report (see stats.h)
+ *      $> ./XanderIsCool --stats report.json
+ *
+ * Instead of the full text dump the simulator can write only what each instruction changed,
+ * .... one JSON line per instruction (see events.h), and the final state as a packed binary snapshot.
+ * .... The text dump of a snapshot can be printed later with --view
+ *      $> ./XanderIsCool --events changes.jsonl --snapshot final.snp --no-dump
+ *      $> ./XanderIsCool --view final.snp
+ *
+ * A single large trace can be replayed on several threads, each owning a slice of the cache sets (see shard.h)
+ *      $> ./XanderIsCool --trace big_trace.trc --nodes 1024 --lines 4096 --shards 8
+ *
+ * The fixed latencies add up as if the whole machine did one access at a time. --timing also times the run in
+ * .... an event-driven model where the processors overlap and queue for node buses, directory and memory ports
+ * .... and network links (see timing.h), and writes when each processor finished and how busy each resource was
+ * .... the model holds a fixed window of accesses, the report's overruns count the accesses the run got ahead of it
+ *      $> ./XanderIsCool --trace big_trace.trc --nodes 64 --timing timing.json
+ * .... with --topology the messages queue for every link on their route and the report adds the use of each link
+ * .... and a heatmap of the link utilization
+ *      $> ./XanderIsCool --trace big_trace.trc --nodes 64 --topology mesh --timing timing.json
+ *
+ * Replaying a trace does not allocate any memory per instruction, --count-allocations prints how many heap
+ * .... allocations the replay made (see allocations.h), the number does not grow with the length of the trace
+ *      $> ./XanderIsCool --trace big_trace.trc --no-dump --count-allocations
+ *
+ * Checkpoints of the whole machine, including how far into the trace it got and its stats, can be written
+ * .... after chosen numbers of instructions, and a later run (or batch job) can resume from one instead of
+ * .... replaying the warm-up again. The geometry is taken from the checkpoint
+ *      $> ./XanderIsCool --trace big_trace.trc --nodes 64 --checkpoint warm --checkpoint-at 1000000,5000000
+ *      $> ./XanderIsCool --trace big_trace.trc --resume warm.1000000.snp
+ * .... the first writes warm.1000000.snp and warm.5000000.snp, the resumed run skips the first 1000000 instructions
+ * .... of its trace, which must start with the same instructions as the trace the checkpoint was made from
+ *
+ * bench.cpp builds a separate executable timing each access path, decoding and printAll on machines of
+ * .... 4 to 1024 nodes, and writes the results as JSON (see the top of bench.cpp)
+ *      $> g++ -O2 -pthread bench.cpp system.cpp trace.cpp stats.cpp timing.cpp workload.cpp -lz -o bench
+ *      $> ./bench --out bench.json
  *
  */
 //TODO Format output
-// TODO Count clocks
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "geometry.h"
+#include "trace.h"
+#include "system.h"
+#include "batch.h"
+#include "shard.h"
+#include "events.h"
+#include "snapshot.h"
+#include "allocations.h"
+#include "workload.h"
 using namespace std;
- fstream inFile ("machine_code.txt"); //global fstream for file input
-struct Node;
-Node* systemNodes [4];
-int clockCount;
-
-// Function Declarations
-void fetch();
-void decode(string line);
-void execute(int nodeIndex, int cpuIndex, string opCode, int rs, int rt, int byteOffset);
-void memoryAccess(int nodeIndex, int cpuIndex, const string& opCode, int memoryAddress, int reg);
-void writeToMem(int nodeIndex, int cpuIndex, const  string& opCode, int memoryAddress, int reg);
-void writeBack(int nodeIndex, int cpuIndex, int cacheIndex);
 
-int binaryToDecimal(string binaryNumber)
+// The options for one run of the simulator, also used for each line of a batch file
+struct RunOptions
 {
-    int size = binaryNumber.size();
-    int result = 0;
-    for(int i = 0; i<size; i++)
-    {
-        result*=2;
-        if(binaryNumber[i]=='1')
-            result++;
-    }
-    return result;
-}
-
-//this function takes in an integer value and returns a 32 bit binary number as a boolean array
-bool * decimalTo32BitBinary(int decimalValue)
-{
-    static bool binaryNumber [32];
-    for(int i = 31; i>=0; i--)
-    {
-        binaryNumber[i] = decimalValue % 2 == 1;
-        decimalValue/=2;
-    }
-    return binaryNumber;
-}
-
-/*
- * -- Detailed description of a Node --
- * This is a Node class that's purpose is to simulate a MIPS based SMP Node
- * The system contains 4 of these nodes each of which consists of the following components:
- * 2 scalar processors each with a local cache (4 lines/cache, 1 word/line, 32 bits/word + valid bit + tag field)
- * .....each processor also has 2 registers (1 words/reg) each
- * .....Cache is direct-mapped and uses WB when write hit and no-write-allocate when write miss;
- *
- * 1 memory module (16 words),
- * .....Memory is globally addressed and the total memory size in the system is 64 words (16 words/node);
- * .....Physical address is 6 bits (2 bits for index, 4 bits for tag),
- * .....and the memory address is word address and we ignore byte level addressing.
- *
- *  1 directory (6 bits/entry)
- * .... Each directory also consists of 16 entries, one for each line (1 word) in the node memory.
- * .... Bits [0,1] are for the status of the respective memory location
- * ........ 00 - uncached
- * ........ 01 - shared
- * ........ 11 - dirty
- * .... Bits [2,3,4,5] are to indicate which nodes ([0,1,2,3] respectively) have the memory in their cache
- */
-struct Node{
-public:
-    bool registers [2][2][32];  // Each node also has 2 processors
-                                // Each processor has 2 registers (word size each)
-                                // Each register has 32 bits
-
-    bool caches [2][4][37];     // Each processor has a cache, there are 2 processors
-                                // each cache has 4 lines
-                                // each line has (1 valid bit + 4 bits tag field + 32 bit word for data)
-
-    bool memory [16][32];       // Each node has 16 words of memory
-    bool directory [16][6];     // Each memory location has 6 bits of status information
-                                // .... bits 0-1 are for state, bits 2-6 are to indicate which nodes contain the data
+    Geometry geometry;
+    string tracePath = "machine_code.txt";
+    string compilePath;     // --compile, write a compiled trace instead of simulating
+    string outPath;         // --out, where a batch job writes its final state
+    string statsPath;       // --stats, where the JSON stats report is written
+    string eventsPath;      // --events, where the per-instruction change log is written
+    string snapshotPath;    // --snapshot, where the packed binary final state is written
+    string viewPath;        // --view, snapshot to print instead of simulating
+    string checkpointPath;  // --checkpoint, prefix of the checkpoint files
+    vector<long long> checkpointAt;     // --checkpoint-at, instruction counts to write a checkpoint at
+    string resumePath;      // --resume, checkpoint to continue from instead of a fresh system
+    string timingPath;      // --timing, where the event-driven timing report is written
+    bool dump = true;       // --no-dump turns off the printAll text dump
+    bool countAllocations = false;      // --count-allocations, print the heap allocations made by the replay
+    string batchPath;       // --batch, file with one job per line
+    int threads = 0;        // --threads, worker threads for a batch (0 = one per core)
+    int shards = 1;         // --shards, worker threads for replaying a single trace
 };
 
-
-/*
- * The fetch function access the input file (simulated instruction memory) and retrieves the next instruction.
- * If there are no more instructions it terminates
- * If an instruction is successfully fetched then it will move to decode the instruction
-*/
- void fetch()
-{
-    string line;
-    if(getline( inFile, line ))
-    {
-        decode(line);
-    }
-}
-
-/* The decode function takes a machine instruction as input and decodes it in preparation for execution.
- * This includes separating the parts of the instruction into the correct fields
- * Decode also converts the parts of the instruction from binary to decimal to allow easier computation
- * .... In an actual system all arithmetic would be done in binary.
- * All instructions have the same length and follow this pattern
- * .... [N,N,C, :,(space), OP,OP,OP,OP,OP,OP, rs,rs,rs,rs,rs, rt,rt,rt,rt,rt, b,b,b,b,b,b,b,b,b,b,b,b,b,b,b,b]
- * .... [0,1,2, 3,  4    ,  5, 6, 7, 8, 9,10, 11,12,13,14,15, 16,17,18,19,20, 21,22,23,..............34,35,36]
- * .... Where N = Node Index
- * .........  C = CPU Index
- * .........  OP = Op Code
- * .........  rs = rs field
- * .........  rt = rt field
- * .........  b = Byte Offset
-*/
-void decode(string line)
+//reads text as a whole decimal number from least to most, returns false if it is anything else
+static bool parseWhole(const string& text, long long least, long long most, long long& value)
 {
-    //The first two bits indicate which node number the instruction is for
-    int nodeIndex = 0;
-    if (line[0] == '1')
-        nodeIndex += 2;
-    if (line[1] == '1')
-        nodeIndex += 1;
-
-    //The third bit indicates what cpu the instruction is for
-   int cpuIndex = 0;
-   if(line[2] == '1')
-       cpuIndex = 1;
-
-   //There are two spaces in our input string that need to be ignored. These are at indexes 3 & 4
-
-   // There are 6 bits for the opcode located at index 5
-   string opCode = line.substr(5,6);
-
-   // The rs field has 5 bits starting at index 11
-   int rs = binaryToDecimal(line.substr(11,5));
-   // The rt field has 5 bits starting at index 16
-   int rt = binaryToDecimal(line.substr(16,5));
-
-   //The byte offset is 16 bits long starting at index 21
-   int byteOffset = binaryToDecimal(line.substr(21,16));
-
-   execute(nodeIndex,cpuIndex,opCode,rs,rt,byteOffset);
+    char* end = nullptr;
+    errno = 0;
+    value = strtoll(text.c_str(), &end, 10);
+    return !text.empty() && *end == '\0' && errno != ERANGE && value >= least && value <= most;
 }
 
-// The execute function performs the ALU arithmetic needed to properly execute the instruction.
-// For load/store instructions this includes adding the word offset to the base address
-void execute(int nodeIndex, int cpuIndex, string opCode, int rs, int rt, int byteOffset)
-{
-    // shift right 2 bits to get word offset........ (I wasn't sure if shifting should be in decode or execute stage)
-    int wordOffset = byteOffset/4;
-    int memoryAddress = rs + wordOffset;
-    // each instruction we will be loading to or storing from a register
-    // if the rt field is odd then it is $s1 register
-    // if the rt field is even then it is $s2 register
-    int reg = (rt+1) % 2;
-    memoryAccess(nodeIndex, cpuIndex, opCode, memoryAddress, reg);
-}
-/*
- * The memoryAccess function is responsible for retrieving the correct value from memory
- * First: The function will check the local processors cache in search of the value in the memory address
- * .... making sure that the valid bit is 1. If found load it into register and done (one clock)
- * .... if not found go to next step
- * Second: Check other cache in local node, if found load it into local cache & reg then done (30 clocks)
- * .... if not found go to next step
- * Third: Search home node's memory/directory. If 'uncached' or 'shared' then load it into local cache/reg (100 clocks)
- * .... if not found go to next step
- * Fourth: Search all caches in the "dirty" node. (use MOD 4 for cache address)
- * .... When found perform necessary operations (135 clocks)
- * .... go to dirty node and find valid value in cache
- * .... share write-back to home
- * .... dirty -> shared
- * .... load into local cache/reg
- *** In all the above steps manage the directories and cache invalid/valid bits correctly ***
-*/
-void memoryAccess(int nodeIndex, int cpuIndex, const  string& opCode, int memoryAddress, int reg)
+//reads the options in args, returns false with a message if an option is not recognized
+bool parseOptions(const vector<string>& args, RunOptions& options)
 {
-    // 10011 is the op code for load word
-    if (opCode == "100011")
+    for (size_t i = 0; i < args.size(); i++)
     {
-        //compute the cache index and the tag
-        // I convert the tag to a bool array for easy comparison
-        int cacheIndex = memoryAddress % 4;
-        int iTag = memoryAddress / 4;
-        bool tag [4];
-        tag [3] = iTag % 2 == 1;
-        iTag /= 2;
-        tag [2] = iTag % 2 == 1;
-        iTag /= 2;
-        tag [1] = iTag % 2 == 1;
-        iTag /= 2;
-        tag [0] = iTag % 2 == 1;
-
-        if  (systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][0]            &&   // valid bit is true
-             systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][1] == tag[0]  &&   //check tag field is the same
-             systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][2] == tag[1]  &&   //check tag field is the same
-             systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][3] == tag[2]  &&   //check tag field is the same
-             systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][4] == tag[3]       //check tag field is the same
-            )
-        { // Case 1: Valid copy found in local cache
-            //Copy cached value into register
-            clockCount++;
-            for(int i =0; i<32; i++)
-                systemNodes[nodeIndex]->registers[cpuIndex][reg][i] = systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][i+4];
-        }//end if case 1
-        else //else not case 1
+        bool hasValue = i + 1 < args.size();
+        string* text = nullptr;
+        if (args[i] == "--trace")
+            text = &options.tracePath;
+        else if (args[i] == "--compile")
+            text = &options.compilePath;
+        else if (args[i] == "--out")
+            text = &options.outPath;
+        else if (args[i] == "--batch")
+            text = &options.batchPath;
+        else if (args[i] == "--stats")
+            text = &options.statsPath;
+        else if (args[i] == "--events")
+            text = &options.eventsPath;
+        else if (args[i] == "--snapshot")
+            text = &options.snapshotPath;
+        else if (args[i] == "--view")
+            text = &options.viewPath;
+        else if (args[i] == "--checkpoint")
+            text = &options.checkpointPath;
+        else if (args[i] == "--resume")
+            text = &options.resumePath;
+        else if (args[i] == "--timing")
+            text = &options.timingPath;
+        if (text != nullptr && hasValue)
         {
-            //since not found in local cache write back current cache contents before loading new value
-            writeBack(nodeIndex,cpuIndex,cacheIndex);
-
-            //Check sister processors cache
-            int otherCPU = (cpuIndex + 1) % 2;    //There are two cpus so add one mod 2 will get the other one
-            if  (systemNodes[nodeIndex]->caches[otherCPU][cacheIndex][0]            &&   // valid bit is true
-                 systemNodes[nodeIndex]->caches[otherCPU][cacheIndex][1] == tag[0]  &&   //check tag field is the same
-                 systemNodes[nodeIndex]->caches[otherCPU][cacheIndex][2] == tag[1]  &&   //check tag field is the same
-                 systemNodes[nodeIndex]->caches[otherCPU][cacheIndex][3] == tag[2]  &&   //check tag field is the same
-                 systemNodes[nodeIndex]->caches[otherCPU][cacheIndex][4] == tag[3]       //check tag field is the same
-                )
-            { //Case 2 valid copy found in sister cache
-                clockCount+=30;
-                for(int i =0; i<32; i++)
-                {
-                    systemNodes[nodeIndex]->registers[cpuIndex][reg][i] =
-                            systemNodes[nodeIndex]->caches[otherCPU][cacheIndex][i + 5]; //Copy value into local register
-
-                    systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][i + 5] =       //Copy value into local cache
-                            systemNodes[nodeIndex]->caches[otherCPU][cacheIndex][i + 5];
-                }
-
-
-                for( int i =0; i<4; i++) //this loop copies the valid bit and tag field into local cache from sister cache
-                {
-                    systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][i] =
-                            systemNodes[nodeIndex]->caches[otherCPU][cacheIndex][i];
-                }
-            } //end if case 2
-            else //else not case 2
+            *text = args[++i];
+            continue;
+        }
+        if (args[i] == "--workload" && hasValue)
+        {
+            options.tracePath = WORKLOAD_PREFIX + args[++i];
+            continue;
+        }
+        if (args[i] == "--replacement" && hasValue)
+        {
+            const string& name = args[++i];
+            if (name == "lru")
+                options.geometry.replacement = REPLACE_LRU;
+            else if (name == "plru")
+                options.geometry.replacement = REPLACE_PLRU;
+            else if (name == "random")
+                options.geometry.replacement = REPLACE_RANDOM;
+            else
             {
-                int homeNode = memoryAddress / 16;
-                int localMemIndex = memoryAddress % 16;
-                if ( //uncached or shared
-                     ( systemNodes[homeNode]->directory[localMemIndex][0] == 0 &&
-                       systemNodes[homeNode]->directory[localMemIndex][1] == 0
-                     )  // 00 is uncached
-                  || ( systemNodes[homeNode]->directory[localMemIndex][0] == 0 &&
-                       systemNodes[homeNode]->directory[localMemIndex][1] == 1
-                     ) // 01 is shared
-                  )
-                {// if case 3, copy from home node (uncached or shared)
-                    clockCount+=100;
-                    for(int i = 0; i<32; i++)
-                    {
-                        systemNodes[nodeIndex]->registers[cpuIndex][reg][i] =
-                                systemNodes[homeNode]->memory[localMemIndex][i];            //Copy value into local register
-
-                        systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][i + 5] =       //Copy value into local cache
-                                systemNodes[homeNode]->memory[localMemIndex][i];
-                    }
-                    systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][0] = true;         //set local cache to valid
-
-                    for(int i = 0; i<4; i++)
-                        systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][i+1] = tag[i];       //Copy tag field
-
-                    //set directory to shared
-                    systemNodes[homeNode]->directory[localMemIndex][0] = false;
-                    systemNodes[homeNode]->directory[localMemIndex][1] = true;
-                    systemNodes[homeNode]->directory[localMemIndex][2+nodeIndex] = true;
-
-                }//end if case 3
-
-                else //case 4
-                {
-                    clockCount+=135;
-                    //Find which node contains the dirty data
-                    int dirtyNode = -1;
-                    for(int i = 0; i<4 && dirtyNode<0; i++)
-                    {
-                        if(systemNodes[homeNode]->directory[localMemIndex][2+i])
-                            dirtyNode = i;
-                    }
-
-                    //Find what CPU in the dirty node contains the data
-                    int dirtyCPU = -1;
-                    if ( systemNodes[dirtyNode]->caches[0][cacheIndex][0] &&
-                        systemNodes[dirtyNode]->caches[0][cacheIndex][1] == tag[0]  &&   //check tag field is the same
-                        systemNodes[dirtyNode]->caches[0][cacheIndex][2] == tag[1]  &&   //check tag field is the same
-                        systemNodes[dirtyNode]->caches[0][cacheIndex][3] == tag[2]  &&   //check tag field is the same
-                        systemNodes[dirtyNode]->caches[0][cacheIndex][4] == tag[3]       //check tag field is the same
-                       )
-                    {
-                        dirtyCPU = 0;
-                    }
-                    else if ( systemNodes[dirtyNode]->caches[1][cacheIndex][0] &&
-                             systemNodes[dirtyNode]->caches[1][cacheIndex][1] == tag[0]  &&   //check tag field is the same
-                             systemNodes[dirtyNode]->caches[1][cacheIndex][2] == tag[1]  &&   //check tag field is the same
-                             systemNodes[dirtyNode]->caches[1][cacheIndex][3] == tag[2]  &&   //check tag field is the same
-                             systemNodes[dirtyNode]->caches[1][cacheIndex][4] == tag[3]       //check tag field is the same
-                            )
-                    {
-                        dirtyCPU = 1;
-                    }
-
-                    for(int i =0; i<32; i++)
-                    {
-                        systemNodes[homeNode]->memory[localMemIndex][i] =                   // WB to home
-                                systemNodes[nodeIndex]->registers[cpuIndex][reg][i] =       // load value in local reg
-                                systemNodes[homeNode]->caches[cpuIndex][cacheIndex][i+5] =  // load value into local cache
-                                systemNodes[dirtyNode]->caches[dirtyCPU][cacheIndex][i+5];  //value to load
-                    }
-
-                    //set local cache valid and tag fields
-                    systemNodes[homeNode]->caches[cpuIndex][cacheIndex][0] = true;      // set local cache to valid
-                    systemNodes[homeNode] ->caches[cpuIndex][cacheIndex][1] = tag[0];   //tag field
-                    systemNodes[homeNode] ->caches[cpuIndex][cacheIndex][2] = tag[1];
-                    systemNodes[homeNode] ->caches[cpuIndex][cacheIndex][3] = tag[2];
-                    systemNodes[homeNode] ->caches[cpuIndex][cacheIndex][4] = tag[3];
-
-                    //Set to shared
-                    systemNodes[homeNode]->directory[localMemIndex][0] = false;
-                    systemNodes[homeNode]->directory[localMemIndex][1] = true;
-                    //Indicate that current cache has the memory value
-                    systemNodes[homeNode]->directory[localMemIndex][2+homeNode] = true;
-                }//end else case 4
-            } //end else not case 2
-        } //end else not case 1
-    }
-    if(opCode=="101011")
-    {
-        writeToMem(nodeIndex, cpuIndex, opCode, memoryAddress, reg);
-    }
-}
-
-/* writeToMem will write the value in a given register to a given memory position
- * 1: Search local cache (local to each processor) (check valid bit and tag)
- * .... if found get exclusive access to it:
- * ........ using home directory invalidate all others that are shared
- * ........ update value in (local cache?) with contents of register (1 clock)
- * ........ home directory is dirty
- * .... else go to step 2
- * 2: Update home node memory with the content of the register (100 clocks)
- * .... if directory indicates "uncached" -> "uncached"
- * ........................... "shared"   -> "shared", but invalidate all shared cached copies (valid bit = 0)
- * ........................... "dirty"    -> "shared", but invalidate all shared cached copies
- * */
-void writeToMem(int nodeIndex, int cpuIndex, const  string& opCode, int memoryAddress, int reg)
-{
-    if(opCode == "101011") //opcode for store instruction
-    {
-        //compute the cache index and the tag
-        // I convert the tag to a bool array for easy comparison
-        int cacheIndex = memoryAddress % 4;
-        int iTag = memoryAddress / 4;
-        bool tag [4];
-        tag [3] = iTag % 2 == 1;
-        iTag /= 2;
-        tag [2] = iTag % 2 == 1;
-        iTag /= 2;
-        tag [1] = iTag % 2 == 1;
-        iTag /= 2;
-        tag [0] = iTag % 2 == 1;
-
-        int otherCPU = (cpuIndex + 1) % 2;
-        int homeNode = memoryAddress / 16;
-        int localMemIndex = memoryAddress % 16;
-
-        //search local cache
-        if  (systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][0]            &&   // valid bit is true
-             systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][1] == tag[0]  &&   //check tag field is the same
-             systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][2] == tag[1]  &&   //check tag field is the same
-             systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][3] == tag[2]  &&   //check tag field is the same
-             systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][4] == tag[3]       //check tag field is the same
-            )
-        {   //Case 1: write hit
-            //Found in local cache
-            clockCount++;
-            //set home dir to dirty 11
-            systemNodes[homeNode]->directory[localMemIndex][0] = true;
-            systemNodes[homeNode]->directory[localMemIndex][1] = true;
-
-            //invalidate all cached values of this
-            for(int i = 0; i<4; i++)
+                cerr << "Unknown replacement policy " << name << ", use lru, plru or random" << endl;
+                return false;
+            }
+            continue;
+        }
+        if (args[i] == "--directory" && hasValue)
+        {
+            const string& format = args[++i];
+            size_t colon = format.find(':');
+            string name = format.substr(0, colon);
+            long long param = 1;
+            if (colon != string::npos && !parseWhole(format.substr(colon + 1), 1, INT_MAX, param))
+            {
+                cerr << "--directory " << format << " needs a group size or pointer count of at least 1 after the ':'" << endl;
+                return false;
+            }
+            options.geometry.directoryParam = int(param);
+            if (name == "full" && colon == string::npos)
+                options.geometry.directory = DIR_FULL;
+            else if (name == "coarse" && colon != string::npos)
+                options.geometry.directory = DIR_COARSE;
+            else if (name == "pointers" && colon != string::npos)
+                options.geometry.directory = DIR_POINTERS;
+            else
+            {
+                cerr << "Unknown directory format " << format << ", use full, coarse:K or pointers:P" << endl;
+                return false;
+            }
+            continue;
+        }
+        if (args[i] == "--checkpoint-at" && hasValue)
+        {
+            istringstream counts(args[++i]);
+            string count;
+            while (getline(counts, count, ','))
             {
-                if(systemNodes[homeNode]->directory[localMemIndex][i+2])
+                long long at = 0;
+                if (!parseWhole(count, 1, LLONG_MAX, at))
                 {
-                    for (int j = 0; j<2; j++)
-                    {
-                        //if the value in the cache is the one being updated
-                        if( systemNodes[i]->caches[j][cacheIndex][0] &&             //check if valid
-                            systemNodes[i]->caches[j][cacheIndex][1] == tag[0] &&   //check tag field
-                            systemNodes[i]->caches[j][cacheIndex][2] == tag[1] &&
-                            systemNodes[i]->caches[j][cacheIndex][3] == tag[2] &&
-                            systemNodes[i]->caches[j][cacheIndex][4] == tag[3]
-                        )
-                            systemNodes[i]->caches[j][cacheIndex][0] = false;       //invalidate all cached values
-                    }
+                    cerr << "--checkpoint-at needs instruction counts of at least 1, not " << count << endl;
+                    return false;
                 }
-            } //end cache invalidation
-
-            //mark local cache as valid
-            systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][0] = true;
-
-            //update tag field
-            for( int i =0; i<4; i++)
+                options.checkpointAt.push_back(at);
+            }
+            sort(options.checkpointAt.begin(), options.checkpointAt.end());
+            continue;
+        }
+        if (args[i] == "--no-dump")
+        {
+            options.dump = false;
+            continue;
+        }
+        if (args[i] == "--count-allocations")
+        {
+            options.countAllocations = true;
+            continue;
+        }
+        if (args[i] == "--topology" && hasValue)
+        {
+            const string& format = args[++i];
+            size_t colon = format.find(':');
+            string name = format.substr(0, colon);
+            int topology = 0;
+            while (topology <= TOPO_FAT_TREE && name != TOPOLOGY_NAMES[topology])
+                topology++;
+            if (topology > TOPO_FAT_TREE || (topology == TOPO_FLAT && colon != string::npos))
             {
-                systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][i+1] = tag[i];
+                cerr << "Unknown topology " << format << ", use flat, ring, mesh[:C], torus[:C] or fat-tree[:K]" << endl;
+                return false;
             }
-
-            //update register
-            for(int i =0; i< 32; i++)
+            long long param = 0;
+            if (colon != string::npos && !parseWhole(format.substr(colon + 1), 1, INT_MAX, param))
             {
-                systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][i+5] =     //store in local cache
-                    systemNodes[nodeIndex]->registers[cpuIndex][reg][i];    //the value to be used is in the reg
+                cerr << "--topology " << format << " needs a column count or arity of at least 1 after the ':'" << endl;
+                return false;
             }
-        } //end case 1:  (write-hit)
-        else
-        { //case 2: write-miss
-            //update home memory
-            clockCount+=100;
-            for(int i =0; i<32; i++)
+            options.geometry.topology = Topology(topology);
+            options.geometry.topologyParam = int(param);
+            continue;
+        }
+        if (args[i] == "--placement" && hasValue)
+        {
+            const string& name = args[++i];
+            int placement = 0;
+            while (placement <= PLACE_ROUND_ROBIN && name != PLACEMENT_NAMES[placement])
+                placement++;
+            if (placement > PLACE_ROUND_ROBIN)
             {
-                systemNodes[homeNode]->memory[localMemIndex][i] = systemNodes[nodeIndex]->registers[cpuIndex][reg][i];
+                cerr << "Unknown placement " << name << ", use block, interleaved, first-touch or round-robin" << endl;
+                return false;
             }
-
-            //invalidate all cached values of this
-            for(int i = 0; i<4; i++)
+            options.geometry.placement = Placement(placement);
+            continue;
+        }
+        if (args[i] == "--page-size" && hasValue)
+        {
+            long long bytes = 0;
+            if (!parseWhole(args[++i], 1, INT_MAX, bytes))
             {
-                if(systemNodes[homeNode]->directory[localMemIndex][i+2])
-                {
-                    for (int j = 0; j<2; j++)
-                    {
-                        //if the value in the cache is the one being updated
-                        if( systemNodes[i]->caches[j][cacheIndex][0] &&             //check if valid
-                            systemNodes[i]->caches[j][cacheIndex][1] == tag[0] &&   //check tag field
-                            systemNodes[i]->caches[j][cacheIndex][2] == tag[1] &&
-                            systemNodes[i]->caches[j][cacheIndex][3] == tag[2] &&
-                            systemNodes[i]->caches[j][cacheIndex][4] == tag[3]
-                                )
-                            systemNodes[i]->caches[j][cacheIndex][0] = false;       //valid bit = 0
-                    }
-                }
-            } //end cache invalidation
-
-            // if the status is "shared" or "uncached" we do nothing BUT...
-            // if the status is dirty "11" then we switch it to shared "01"
-            if(systemNodes[homeNode]->directory[localMemIndex][0] &&
-                systemNodes[homeNode]->directory[localMemIndex][1])
+                cerr << "--page-size needs a whole number of bytes, not " << args[i] << endl;
+                return false;
+            }
+            options.geometry.pageWords = bytes % 4 == 0 ? int(bytes / 4) : -1;
+            continue;
+        }
+        if (args[i] == "--line-size" && hasValue)
+        {
+            long long bytes = 0;
+            if (!parseWhole(args[++i], 1, INT_MAX, bytes))
             {
-                systemNodes[homeNode]->directory[localMemIndex][0] = false;
-                systemNodes[homeNode]->directory[localMemIndex][1] = true;
+                cerr << "--line-size needs a whole number of bytes, not " << args[i] << endl;
+                return false;
             }
-        } //end case 2 write-miss
-    }
-}
-
-/* writeBack is used whan a cache block is being replaced
- * if the cached value is valid it will go to the correct memory location and update it
-*/
-void writeBack(int nodeIndex, int cpuIndex, int cacheIndex)
-{
-    //check if block to be replaced is valid
-    if(systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][0])
-    {
-        int memoryAddress = 0;
-        for(int i =1; i<5; i++)
+            options.geometry.lineWords = bytes % 4 == 0 ? int(bytes / 4) : 0;
+            continue;
+        }
+        if (args[i] == "--write-allocate")
         {
-            //convert tag field into decimal number
-            if(systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][i])
+            options.geometry.writeAllocate = true;
+            continue;
+        }
+        if (args[i] == "--protocol" && hasValue)
+        {
+            const string& name = args[++i];
+            if (name == "dash")
+                options.geometry.protocol = PROTO_DASH;
+            else if (name == "msi")
+                options.geometry.protocol = PROTO_MSI;
+            else if (name == "mesi")
+                options.geometry.protocol = PROTO_MESI;
+            else if (name == "moesi")
+                options.geometry.protocol = PROTO_MOESI;
+            else
             {
-                memoryAddress *= 2;
-                memoryAddress += 1;
+                cerr << "Unknown protocol " << name << ", use dash, msi, mesi or moesi" << endl;
+                return false;
             }
+            continue;
         }
-        memoryAddress *= 4;
-        memoryAddress += cacheIndex;
 
-        int homeNode = memoryAddress/16;
-        int localMemAddress = memoryAddress % 16;
+        int* field = nullptr;
+        int least = 1;          // the smallest value the option accepts
+        if (args[i] == "--nodes")
+            field = &options.geometry.nodes;
+        else if (args[i] == "--cpus")
+            field = &options.geometry.cpusPerNode;
+        else if (args[i] == "--lines")
+            field = &options.geometry.cacheLines;
+        else if (args[i] == "--memory")
+            field = &options.geometry.memoryWords;
+        else if (args[i] == "--ways")
+            field = &options.geometry.ways;
+        else if (args[i] == "--hop-clocks")
+        {
+            field = &options.geometry.hopClocks;
+            least = 0;
+        }
+        else if (args[i] == "--migrate")
+        {
+            field = &options.geometry.migrateAfter;
+            least = 0;
+        }
+        else if (args[i] == "--threads")
+            field = &options.threads;
+        else if (args[i] == "--shards")
+            field = &options.shards;
 
-        //write it back to memory if the valid block is dirty
-        if(systemNodes[homeNode]->directory[localMemAddress][0] && systemNodes[homeNode]->directory[localMemAddress][1])
-        for(int i =0; i<32; i++)
+        if (field == nullptr || !hasValue)
+        {
+            cerr << "Unrecognized option " << args[i] << endl;
+            cerr << "Usage: [--nodes N] [--cpus N] [--lines N] [--memory N] [--ways N] [--line-size bytes] [--replacement lru|plru|random]"
+                 << " [--directory full|coarse:K|pointers:P] [--protocol dash|msi|mesi|moesi] [--write-allocate] [--topology flat|ring|mesh[:C]|torus[:C]|fat-tree[:K]] [--hop-clocks N]"
+                 << " [--placement block|interleaved|first-touch|round-robin] [--page-size bytes] [--migrate N] [--trace file] [--workload spec] [--compile out.trc] [--stats report.json]"
+                 << " [--events log.jsonl] [--snapshot state.snp] [--view state.snp] [--no-dump] [--count-allocations]"
+                 << " [--checkpoint prefix --checkpoint-at N,N...] [--resume state.snp] [--timing timing.json]"
+                 << " [--batch jobs.txt] [--threads N] [--shards N]" << endl;
+            return false;
+        }
+        long long value = 0;
+        if (!parseWhole(args[i + 1], least, INT_MAX, value))
         {
-            systemNodes[homeNode]->memory[localMemAddress][i] = systemNodes[nodeIndex]->caches[cpuIndex][cacheIndex][i+5];
+            cerr << args[i] << " needs a whole number of at least " << least << ", not " << args[i + 1] << endl;
+            return false;
         }
+        *field = int(value);
+        i++;
     }
+    if (options.geometry.nodes > 65536 || options.geometry.cpusPerNode > 256)
+    {
+        cerr << "At most 65536 nodes and 256 cpus per node are supported" << endl;
+        return false;
+    }
+    if (cacheShapeError(options.geometry) != nullptr)
+    {
+        cerr << cacheShapeError(options.geometry) << endl;
+        return false;
+    }
+    if (options.checkpointAt.empty() != options.checkpointPath.empty())
+    {
+        cerr << "--checkpoint and --checkpoint-at have to be used together" << endl;
+        return false;
+    }
+    return true;
 }
 
+//reads one job per line from the batch file, blank lines and lines starting with # are skipped
+//paths containing spaces can be written in double quotes
+bool readBatchFile(const string& path, vector<BatchJob>& jobs)
+{
+    ifstream in(path);
+    if (!in)
+    {
+        cerr << "Could not open " << path << endl;
+        return false;
+    }
+    string line;
+    while (getline(in, line))
+    {
+        istringstream words(line);
+        vector<string> args;
+        string word;
+        while (words >> quoted(word))
+            args.push_back(word);
+        if (args.empty() || args[0][0] == '#')
+            continue;
+
+        RunOptions options;
+        if (!parseOptions(args, options))
+            return false;
+        jobs.push_back({options.tracePath, options.geometry, options.outPath, options.statsPath, options.resumePath});
+    }
+    return true;
+}
 
-
-//printAll takes the array of 4 nodes as input displays all the values within the nodes
-// this includes registers, caches, memory, directories
-void printAll(Node *nodes[])
+//runs every job in the batch file and prints one line of results per job
+int runBatchFile(const RunOptions& options)
 {
-    //loop through all 4 nodes
-    for(int i =0; i<4; i++)
+    vector<BatchJob> jobs;
+    if (!readBatchFile(options.batchPath, jobs))
+        return 1;
+    vector<BatchResult> results = runBatch(jobs, options.threads);
+
+    bool allOk = true;
+    cout << "job\ttrace\tnodes\tcpus\tlines\tways\tline_bytes\tmemory\tprotocol\ttopology\tplacement\tclocks\tremote_ratio"
+         << "\tstate_hash\tseconds" << endl;
+    for (size_t i = 0; i < jobs.size(); i++)
     {
-        cout<<"\n----------------------------------------";
-        cout<<"\nNode #"<<i<<endl;
+        const Geometry& g = results[i].ok ? results[i].geometry : jobs[i].geometry;
+        cout << i << "\t" << jobs[i].tracePath << "\t" << g.nodes << "\t" << g.cpusPerNode << "\t" << g.cacheLines
+             << "\t" << g.ways << "\t" << g.lineWords * 4 << "\t" << g.memoryWords << "\t" << PROTOCOL_NAMES[g.protocol]
+             << (g.writeAllocate ? "+wa" : "") << "\t" << TOPOLOGY_NAMES[g.topology] << "\t" << PLACEMENT_NAMES[g.placement]
+             << (g.migrateAfter > 0 ? "+migrate" : "") << "\t";
+        if (results[i].ok)
+            cout << results[i].clockCount << "\t" << results[i].remoteRatio << "\t" << hex << results[i].stateHash << dec << "\t" << results[i].seconds << endl;
+        else
+            cout << "failed" << endl;
+        allOk = allOk && results[i].ok;
+    }
+    return allOk ? 0 : 1;
+}
 
-        //There are two processors
-        for(int j =0 ; j<2; j++) {
-            cout << "\n-- Processor #" << j <<" --"<<endl;
-            for (int k = 0; k < 2; k++)                //each processor has 2 registers
-            {
-                cout << "$s" << k+1 << ": ";
-                //each register has 32 bits
-                for (int l = 0; l < 32; l++)
-                    cout << nodes[i]->registers[j][k][l];
-                cout<<endl;
-            }
 
-            cout<<"Cache #: V : Tag  : Data Contents"<<endl;
-            for (int k = 0; k < 4; k++)                 //each processor has 4 cache sets
-            {
-                cout << "Cache " << k << ": ";
-                //each cache has 37 bits (1 valid bit: 4 tag field: 32 Data)
-                for (int l = 0; l < 37; l++)
-                {
-                    cout << nodes[i]->caches[j][k][l];
+int main(int argc, char* argv[]) {
+    RunOptions options;
+    if (!parseOptions(vector<string>(argv + 1, argv + argc), options))
+        return 1;
 
-                    if(l==0 || l==4)
-                    {
-                        cout<<" : ";
-                    }
+    if (!options.batchPath.empty())
+        return runBatchFile(options);
 
-                }cout<<endl;
-            }
-        }
-        cout<<"\n-- Memory --"<<endl;
-        for (int j = i * 16; j < (i+1) * 16; ++j)
-        {
+    // Print a saved snapshot the same way as the end of a run
+    if (!options.viewPath.empty())
+    {
+        unique_ptr<System> system = loadSnapshot(options.viewPath);
+        if (!system)
+            return 1;
+        system->printAll(cout);
+        cout<<"\n --------------- \nTotal Clock Count: "<<system->clockCount<<endl;
+        cout<<"Remote Access Ratio: "<<system->stats.remoteRatio()<<endl;
+        return 0;
+    }
 
-            cout<<setw(3)<<left<<j<<": ";
+    // Compile the ASCII trace once so later runs can replay it without parsing
+    if (!options.compilePath.empty())
+    {
+        Geometry geometry = options.geometry;
+        deriveGeometry(geometry);
+        long long count = compileTrace(options.tracePath, options.compilePath, geometry);
+        if (count < 0)
+            return 1;
+        cout << "Compiled " << count << " instructions into " << options.compilePath << endl;
+        return 0;
+    }
 
-            for(int k = 0; k<32; k++)
-            {
-                cout<<nodes[i]->memory[j%16][k];
-            }
-            cout<<endl;
-        }
+    unique_ptr<System> machine = options.resumePath.empty() ? unique_ptr<System>(new System(options.geometry))
+                                                            : loadSnapshot(options.resumePath);
+    if (!machine)
+        return 1;
+    System& system = *machine;
 
-        cout<<"\n-- Directory --"<<endl;
-        for (int j = 0; j < 16; j++)
+    if ((!options.eventsPath.empty() || !options.timingPath.empty()) && options.shards > 1)
+    {
+        cerr << "--events and --timing need the instructions in trace order and cannot be used with --shards" << endl;
+        return 1;
+    }
+    EventLog log;
+    if (!options.eventsPath.empty() && !log.open(options.eventsPath))
+        return 1;
+    unique_ptr<TimingModel> timing;
+    if (!options.timingPath.empty())
+    {
+        timing.reset(new TimingModel(system.geometry));
+        system.timing = timing.get();
+    }
+
+    // The trace is run in stretches ending at each checkpoint, the last one runs to the end of the trace
+    vector<long long> stops = options.checkpointAt;
+    stops.push_back(-1);
+    long long allocationsBefore = heapAllocations();
+    long long instructionsBefore = system.instructionCount;
+    for (long long stop : stops)
+    {
+        if (stop >= 0 && stop < system.instructionCount)
+            continue;
+        bool ok = options.eventsPath.empty() ? runSharded(system, options.tracePath, options.shards, stop)
+                                             : runTraceWithEvents(system, options.tracePath, log, stop);
+        if (!ok)
+            return 1;
+        if (stop >= 0 && system.instructionCount < stop)
         {
-            cout<<setw(3)<<left<<j+(i*16)<<": ";
-            for(int k = 0; k < 6; k++)
-            {
-                if(k>=2)
-                {
-                    cout<<" : ";
-                }
-                cout<<nodes[i]->directory[j][k];
-            }
-            cout<<endl;
+            cerr << "The trace ended after " << system.instructionCount << " instructions, before the checkpoint at "
+                 << stop << endl;
+            break;
         }
-   } //End Node Loop
-}//end printAll
-
-
-/* initializeSystem will reset the contents of the systems 4 nodes to be all 0s except for in memory
- * the value at each memory location will be the memory address + 5
- *  .... For example Mem[0] = 5, Mem[1] = 6, ... , Mem[62] = 67, Mem[63]= = 68
- * */
-void initializeSystem()
-{
-    clockCount=0;
-   for (int i =0; i<4; i++)
-   {
-        systemNodes[i] = new Node;
-        for(int j =0; j<16; j++)
+        if (stop >= 0 && !saveSnapshot(options.checkpointPath + "." + to_string(stop) + ".snp", system))
+            return 1;
+    }
+    if (options.countAllocations)
+        cout << "Heap allocations while replaying " << system.instructionCount - instructionsBefore << " instructions: "
+             << heapAllocations() - allocationsBefore << endl;
+
+    if (options.dump)
+        system.printAll(cout);
+    cout<<"\n --------------- \nTotal Clock Count: "<<system.clockCount<<endl;
+    cout<<"Remote Access Ratio: "<<system.stats.remoteRatio()<<endl;
+    if (system.geometry.migrateAfter > 0)
+        cout<<"Page Migrations: "<<system.stats.migrations<<endl;
+
+    if (!options.timingPath.empty())
+    {
+        system.timing = nullptr;
+        TimingResult timed = timing->finish();
+        cout << "Timed Completion: " << timed.completion << endl;
+        if (timed.overruns > 0)
+            cout << "Timing Window Overruns: " << timed.overruns << endl;
+        ofstream out(options.timingPath);
+        if (!out)
         {
-            int memoryValue = i*16 + j + 5;
-            bool *binaryMemValue = decimalTo32BitBinary(memoryValue);
-
-            for(int k =0; k<32; k++)
-            {
-                systemNodes[i]->memory[j][k] = binaryMemValue[k];
-            }
+            cerr << "Could not open " << options.timingPath << endl;
+            return 1;
         }
-   }
-}
+        writeTimingJson(out, timed, system.geometry);
+    }
 
+    if (!options.snapshotPath.empty() && !saveSnapshot(options.snapshotPath, system))
+        return 1;
 
-int main() {
-    initializeSystem();
-    // This is the main loop to fetch instructions until the end of the file
-    int i =1;
-    while(!inFile.eof()) {
-        fetch();
+    if (!options.statsPath.empty())
+    {
+        ofstream out(options.statsPath);
+        if (!out)
+        {
+            cerr << "Could not open " << options.statsPath << endl;
+            return 1;
+        }
+        writeStatsJson(out, system.stats, system.geometry, system.pageTable, system.clockCount);
     }
-    printAll(systemNodes);
-    cout<<"\n --------------- \nTotal Clock Count: "<<clockCount<<endl;
     return 0;
 }
@@ -0,0 +1,107 @@
+/* Page placement and migration
+ * The global addresses of the trace are split into pages of 2^pageBits words, and every page lives in one frame,
+ * .... a page sized piece of the memory of one node. The frame decides the home node of the page's words,
+ * .... its memory words and its directory entries. A frame is numbered node * framesPerNode + frame within the node,
+ * .... so frame << pageBits is the physical address of its first word, physical address / memoryWords its node.
+ * Caches are tagged by the global address of the trace, so where a page lives never changes what a cache holds.
+ * The placement policy picks the frame of every page
+ * .... PLACE_BLOCK        page p lives in frame p, every node holds the memoryWords neighbouring words it always had
+ * .... PLACE_INTERLEAVED  page p lives on node p % nodes, neighbouring pages are spread over all the nodes
+ * .... PLACE_FIRST_TOUCH  a page gets a frame of the node that first accesses it
+ * .... PLACE_ROUND_ROBIN  a page gets a frame of the next node in turn when it is first accessed
+ * The first free frame of the node is taken, once a node is full the next node with a free frame after it.
+ * Where a page has not been placed yet its words hold their starting values (address + 5), which it takes along
+ * .... into its frame, so the values a run loads do not depend on the policy.
+ *
+ * Free frames hold zeros and uncached directory entries.
+ *
+ * With migration (migrateAfter > 0) a page moves to a node once that node has made migrateAfter remote accesses
+ * .... to it in a row, remote as counted in the stats (see AddressStats). A remote access from another node starts
+ * .... the count again and an access of the home node clears it, cache hits leave it alone.
+ * .... The page moves into a free frame of the node or trades frames with the page in the node's next frame in turn.
+ * .... Moving a page copies its memory words and its directory entries, the cached copies stay valid.
+ * .... A migration costs a home load (ACCESS_LATENCIES and the hops between the two nodes) for every block moved,
+ * .... a trade moves the blocks of both pages. Migrations are counted in the stats, the timing model does not see them.
+ * A dynamic placement or migration depends on the order of all the accesses, so --shards replays those serially.
+ */
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <cstdint>
+#include <vector>
+#include "geometry.h"
+
+const int32_t NO_FRAME = -1;
+const int32_t NO_PAGE = -1;
+
+// Remote accesses to one page from one node in a row
+struct PageUse
+{
+    int32_t node;
+    int32_t count;
+};
+
+struct PageTable
+{
+    std::vector<int32_t> frames;        // the frame of every page, NO_FRAME until it is placed
+    std::vector<int32_t> pages;         // the page in every frame, NO_PAGE while it is free
+    std::vector<int32_t> firstFree;     // per node, no frame of the node below it is free
+    std::vector<int32_t> nextSwap;      // per node, the frame a page migrating in trades with next
+    std::vector<PageUse> uses;          // per page, only kept with migration
+    int32_t nextNode = 0;               // PLACE_ROUND_ROBIN, the node the next page goes to
+
+    // sizes the table for the geometry, block and interleaved placement place every page up front
+    void reset(const Geometry& geometry)
+    {
+        int count = geometry.nodes * geometry.framesPerNode;
+        frames.assign(count, NO_FRAME);
+        pages.assign(count, NO_PAGE);
+        firstFree.assign(geometry.nodes, 0);
+        nextSwap.assign(geometry.nodes, 0);
+        uses.assign(geometry.migrateAfter > 0 ? count : 0, PageUse{-1, 0});
+        nextNode = 0;
+        if (geometry.placement == PLACE_BLOCK || geometry.placement == PLACE_INTERLEAVED)
+            for (int page = 0; page < count; page++)
+                assign(geometry, page, geometry.placement == PLACE_BLOCK ? page
+                       : page % geometry.nodes * geometry.framesPerNode + page / geometry.nodes);
+    }
+
+    // the physical address of a word of a placed page
+    int physical(const Geometry& geometry, int address) const
+    {
+        return (frames[address >> geometry.pageBits] << geometry.pageBits) | (address & ((1 << geometry.pageBits) - 1));
+    }
+
+    //returns the first free frame of the node, or NO_FRAME when it is full
+    int32_t freeFrame(const Geometry& geometry, int node) const
+    {
+        return firstFree[node] < geometry.framesPerNode ? node * geometry.framesPerNode + firstFree[node] : NO_FRAME;
+    }
+
+    // puts the page in the frame
+    void assign(const Geometry& geometry, int32_t page, int32_t frame)
+    {
+        frames[page] = frame;
+        pages[frame] = page;
+        int node = frame / geometry.framesPerNode;
+        while (firstFree[node] < geometry.framesPerNode && pages[node * geometry.framesPerNode + firstFree[node]] != NO_PAGE)
+            firstFree[node]++;
+    }
+
+    // frees the frame, the page that was in it has moved on
+    void release(const Geometry& geometry, int32_t frame)
+    {
+        pages[frame] = NO_PAGE;
+        int node = frame / geometry.framesPerNode;
+        if (frame % geometry.framesPerNode < firstFree[node])
+            firstFree[node] = frame % geometry.framesPerNode;
+    }
+
+    // true while every page keeps the frame it started in, so the placement does not depend on the trace
+    static bool isStatic(const Geometry& geometry)
+    {
+        return (geometry.placement == PLACE_BLOCK || geometry.placement == PLACE_INTERLEAVED) && geometry.migrateAfter == 0;
+    }
+};
+
+#endif
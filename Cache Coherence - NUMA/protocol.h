@@ -0,0 +1,71 @@
+/* Coherence protocols of the cc-NUMA machine
+ * memoryAccess, writeToMem and writeBack are templates over a protocol policy and the write-allocate choice,
+ * .... each combination is its own instantiation selected once through the opcode table (see system.cpp),
+ * .... so an instruction pays no dispatch for the protocol and the policy's flags fold away.
+ *
+ * DASH is the original scheme: the directory alone says whether a node's copies are dirty, cache lines only
+ * .... have a valid bit and a store hit costs one clock however many copies it invalidates.
+ * MSI, MESI and MOESI give every valid cache line a state, the directory entry of a block then means
+ * ........ uncached  no cache holds the block
+ * ........ shared    the nodes in the sharer vector may hold read-only (S) copies, memory is current
+ * ........ dirty     exactly one line of one node holds the block Exclusive (clean) or Modified
+ * ........ owned     (MOESI) one line holds it Owned and is newer than memory, the other sharers hold S copies
+ * .... A store hit on an S or O copy pays a home upgrade (STORE_UPGRADE) that invalidates the other copies
+ * .... while a store hit on an E or M copy is silent. Under MESI and MOESI a load that finds the block uncached
+ * .... at home gets it Exclusive, MSI always loads it Shared, so comparing the two shows what the E state saves.
+ * .... A load of a dirty block downgrades the owner: E -> S, M -> S with a share write-back to home (MSI, MESI)
+ * .... or M -> O without one (MOESI). A sister cache in the same node downgrades the same way, so within a node
+ * .... the caches never disagree and a silent store never leaves a stale copy behind.
+ * .... Replacing an M or O line writes it back, replacing an E line only tells home, S lines are dropped silently.
+ * With write-allocate a write miss fetches the block for ownership and keeps it Modified (or, under DASH,
+ * .... dirty at home) instead of only updating home memory. It is charged as a write miss.
+ * The fixed latencies stay those of DASH (see ACCESS_LATENCIES), an upgrade costs the same as a write miss.
+ */
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+
+// The state of a valid cache line under MSI, MESI and MOESI, DASH leaves every line LINE_SHARED
+enum LineState : uint8_t
+{
+    LINE_SHARED = 0,
+    LINE_EXCLUSIVE = 1,
+    LINE_MODIFIED = 2,
+    LINE_OWNED = 3
+};
+
+static const char LINE_STATE_NAMES[] = {'S', 'E', 'M', 'O'};
+
+// The protocol policies
+// .... lineStates keeps a state per line and charges a store hit on a shared copy as an upgrade
+// .... exclusive gives a load of an uncached block the E state, owned adds the O state
+struct DashProtocol
+{
+    static constexpr bool lineStates = false;
+    static constexpr bool exclusive = false;
+    static constexpr bool owned = false;
+};
+
+struct MsiProtocol
+{
+    static constexpr bool lineStates = true;
+    static constexpr bool exclusive = false;
+    static constexpr bool owned = false;
+};
+
+struct MesiProtocol
+{
+    static constexpr bool lineStates = true;
+    static constexpr bool exclusive = true;
+    static constexpr bool owned = false;
+};
+
+struct MoesiProtocol
+{
+    static constexpr bool lineStates = true;
+    static constexpr bool exclusive = true;
+    static constexpr bool owned = true;
+};
+
+#endif
@@ -0,0 +1,79 @@
+/* Replacement policies for set-associative caches
+ * Each processor keeps per set an age for every way (LRU) and one word of policy state (the PLRU tree bits or
+ * .... the random sequence). Lookups in a set never depend on the policy, see findWay in system.h.
+ * An invalid way is always filled first, the policy only picks among valid ways.
+ * All the state belongs to the set, so a set's replacement decisions only depend on the accesses to that set
+ * .... and the sharded runner stays exact (see shard.h)
+ */
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+#include <cstdint>
+#include "geometry.h"
+
+/*
+ * LRU keeps the ways' ages as a permutation of 0 .. ways-1, 0 being the most recently used
+ * PLRU keeps ways-1 tree bits in state, bit n (heap numbering from 1) points to the half of the subtree to replace next
+ * RANDOM keeps a xorshift generator in state
+ */
+
+// the starting state of a set, ages must hold ways entries
+inline void resetWays(uint8_t* ages, uint32_t& state, int ways, Replacement policy, uint32_t seed)
+{
+    for (int w = 0; w < ways; w++)
+        ages[w] = w;
+    state = policy == REPLACE_RANDOM ? (seed * 2654435761u) | 1u : 0;
+}
+
+// records a use of way, on a hit or when a block was just loaded into it
+inline void touchWay(uint8_t* ages, uint32_t& state, int ways, int way, Replacement policy)
+{
+    if (policy == REPLACE_LRU)
+    {
+        uint8_t age = ages[way];
+        for (int w = 0; w < ways; w++)
+            ages[w] += ages[w] < age;
+        ages[way] = 0;
+    }
+    else if (policy == REPLACE_PLRU)
+    {
+        int node = 1;
+        for (int half = ways >> 1; half > 0; half >>= 1)
+        {
+            uint32_t right = (way & half) != 0;
+            state = (state & ~(1u << node)) | ((right ^ 1u) << node);
+            node = node * 2 + right;
+        }
+    }
+}
+
+// picks the way a new block is loaded into, bit w of validWays is set when way w holds a valid block
+inline int victimWay(uint32_t validWays, const uint8_t* ages, uint32_t& state, int ways, Replacement policy)
+{
+    uint32_t invalidWays = ~validWays & (ways == 32 ? ~0u : (1u << ways) - 1);
+    if (invalidWays != 0)
+        return __builtin_ctz(invalidWays);
+    if (policy == REPLACE_LRU)
+    {
+        for (int w = 0; w < ways; w++)
+            if (ages[w] == ways - 1)
+                return w;
+    }
+    if (policy == REPLACE_PLRU)
+    {
+        int node = 1;
+        while (node < ways)
+            node = node * 2 + ((state >> node) & 1u);
+        return node - ways;
+    }
+    if (policy == REPLACE_RANDOM)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state % ways;
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,145 @@
+/* Sharded multi-threaded replay of a single trace, see shard.h
+ */
+#include "shard.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// How an instruction uses its register
+enum RegisterUse : uint8_t
+{
+    USE_NONE,   // unknown opcode or an instruction outside the system
+    USE_WRITE,  // load, writes the register
+    USE_READ    // store, reads the register
+};
+
+// Counts the completed loads (writes) and stores (reads) of one register
+struct alignas(64) RegisterGate
+{
+    atomic<uint64_t> writes{0};
+    atomic<uint64_t> reads{0};
+};
+
+// One instruction sent to a worker, with how many earlier uses of its register must finish first
+struct ShardItem
+{
+    TraceRecord record;
+    RegisterUse use;
+    uint32_t gate;
+    uint64_t writesBefore;
+    uint64_t readsBefore;
+};
+
+//spins briefly then yields until a counter reaches the wanted value
+static void waitFor(const atomic<uint64_t>& counter, uint64_t wanted)
+{
+    for (int spins = 0; counter.load(memory_order_acquire) != wanted; spins++)
+    {
+        if (spins > 64)
+            this_thread::yield();
+    }
+}
+
+//executes every instruction the reader sends to this shard until the reader is finished
+static void shardWorker(System& view, SpscQueue<ShardItem>& queue, vector<RegisterGate>& gates, const atomic<bool>& finished)
+{
+    ShardItem item;
+    while (true)
+    {
+        if (!queue.pop(item))
+        {
+            if (finished.load(memory_order_acquire) && !queue.pop(item))
+                return;
+            if (!queue.pop(item))
+            {
+                this_thread::yield();
+                continue;
+            }
+        }
+
+        if (item.use == USE_WRITE)
+        {
+            RegisterGate& gate = gates[item.gate];
+            waitFor(gate.writes, item.writesBefore);
+            waitFor(gate.reads, item.readsBefore);
+            view.execute(item.record);
+            gate.writes.store(item.writesBefore + 1, memory_order_release);
+        }
+        else if (item.use == USE_READ)
+        {
+            RegisterGate& gate = gates[item.gate];
+            waitFor(gate.writes, item.writesBefore);
+            view.execute(item.record);
+            gate.reads.fetch_add(1, memory_order_release);
+        }
+        else
+            view.execute(item.record);
+    }
+}
+
+bool runSharded(System& system, const string& path, int shards, long long until)
+{
+    const Geometry& geometry = system.geometry;
+    if (shards > geometry.sets)
+        shards = geometry.sets;
+    if (shards <= 1 || !PageTable::isStatic(geometry))
+        return system.runTrace(path, until);
+
+    int registerCount = geometry.nodes * geometry.cpusPerNode * 2;
+    vector<RegisterGate> gates(registerCount);
+    vector<uint64_t> writesIssued(registerCount, 0);
+    vector<uint64_t> readsIssued(registerCount, 0);
+
+    vector<unique_ptr<System>> views;
+    vector<unique_ptr<SpscQueue<ShardItem>>> queues;
+    for (int i = 0; i < shards; i++)
+    {
+        views.emplace_back(new System(system, SHARE_NODES));
+        queues.emplace_back(new SpscQueue<ShardItem>(4096));
+    }
+
+    atomic<bool> finished(false);
+    vector<thread> workers;
+    for (int i = 0; i < shards; i++)
+        workers.emplace_back(shardWorker, ref(*views[i]), ref(*queues[i]), ref(gates), cref(finished));
+
+    bool ok = forEachRecord(path, geometry, [&](const TraceRecord& record)
+    {
+        ShardItem item = {record, USE_NONE, 0, 0, 0};
+        bool inside = record.node < geometry.nodes && record.cpu < geometry.cpusPerNode
+                      && record.address < (uint32_t)geometry.totalWords;
+        OpCode op = opcodeOf(record);
+        if (inside && (op == OP_LW || op == OP_SW))
+        {
+            item.gate = (record.node * geometry.cpusPerNode + record.cpu) * 2 + registerOf(record);
+            item.writesBefore = writesIssued[item.gate];
+            item.readsBefore = readsIssued[item.gate];
+            if (op == OP_LW)
+            {
+                item.use = USE_WRITE;
+                writesIssued[item.gate]++;
+            }
+            else
+            {
+                item.use = USE_READ;
+                readsIssued[item.gate]++;
+            }
+        }
+        int shard = inside ? (blockOf(geometry, record.address) % geometry.sets) % shards : 0;
+        queues[shard]->push(item);
+    }, system.instructionCount, until);
+
+    finished.store(true, memory_order_release);
+    for (thread& worker : workers)
+        worker.join();
+    for (int i = 0; i < shards; i++)
+    {
+        system.clockCount += views[i]->clockCount;
+        system.instructionCount += views[i]->instructionCount;
+        system.stats.merge(views[i]->stats);
+    }
+    return ok;
+}
@@ -0,0 +1,30 @@
+/* Sharded multi-threaded replay of a single trace
+ *
+ * Every piece of state an instruction touches, other than the registers, belongs to its cache set:
+ * .... the cache set at block % sets in every processor (with its replacement state), the home directory
+ * .... entry and memory words of the block, and the directory entry and memory words of any block evicted from that set.
+ * So the address space is split into shards by cache set and each worker thread owns the caches,
+ * .... directory entries and memory words of its shard. The reading thread sends each instruction to the worker
+ * .... that owns its set over a lock-free queue, which keeps trace order for every address.
+ *
+ * Registers are shared by all shards, a store reads the register written by the last load of that register.
+ * Each register has a gate counting the loads and stores that have used it. A load waits until every earlier use
+ * .... of its register is done and a store waits until the load before it is done, so registers see exactly the
+ * .... values of a serial run. The waits only ever point back to earlier instructions so the workers cannot deadlock.
+ *
+ * The final state and clock count are identical to System::runTrace.
+ * A placement that places pages as they are first accessed or migrates them changes the home of other shards' blocks,
+ * .... so under one the trace is replayed serially (see PageTable::isStatic).
+ */
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <string>
+#include "system.h"
+
+// Replays the trace at path through system using the given number of worker threads
+// .... from system.instructionCount up to until (-1 for the whole trace), the same as System::runTrace
+// returns false if the trace could not be opened
+bool runSharded(System& system, const std::string& path, int shards, long long until = -1);
+
+#endif
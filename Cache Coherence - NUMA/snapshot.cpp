@@ -0,0 +1,258 @@
+/* Packed binary snapshots of the whole machine, see snapshot.h
+ * Layout (little endian, no padding)
+ * .... "NUMASNP1", int32 nodes, cpusPerNode, cacheLines, memoryWords, ways, replacement, directory, directoryParam,
+ * .... protocol, writeAllocate, lineWords, topology, topologyParam, hopClocks, placement, pageWords, migrateAfter,
+ * .... int64 clockCount, int64 instructionCount
+ * .... then for each node
+ * ........ uint32 registers[cpusPerNode * 2]
+ * ........ per cache line: uint32 data[lineWords], uint32 tag, uint8 valid, uint8 state
+ * ........ uint8 ages[cpusPerNode * cacheLines], uint32 setStates[cpusPerNode * sets]
+ * ........ uint32 memory[memoryWords]
+ * ........ uint8 directory state[memoryBlocks]
+ * ........ uint64 sharers[memoryBlocks * sharerWords], in the directory format (see directory.h)
+ * .... then the stats
+ * ........ per processor: int64 cases[CASE_COUNT], invalidations, writebacks, clocks, probes
+ * ........ per address: int64 loads, stores, remote, invalidations
+ * ........ int64 latencies[CASE_COUNT][LATENCY_BUCKETS]
+ * .... then the page table (see placement.h)
+ * ........ int32 frames[pages], nextSwap[nodes], nextNode
+ * ........ with migration per page: int32 node, count of its remote accesses in a row
+ * ........ int64 migrations
+ * The stats are written as they are in memory, so a snapshot only loads in a build with the same Stats layout.
+ * .... There is one format, a file with any other magic is rejected
+ */
+#include "snapshot.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+using namespace std;
+
+static const char SNAPSHOT_MAGIC[8] = {'N','U','M','A','S','N','P','1'};
+
+template <class T>
+static void put(ostream& out, const T& value)
+{
+    out.write((const char*)&value, sizeof(value));
+}
+
+template <class T>
+static bool get(istream& in, T& value)
+{
+    return (bool)in.read((char*)&value, sizeof(value));
+}
+
+void writeSnapshot(ostream& out, const System& system)
+{
+    const Geometry& geometry = system.geometry;
+    out.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    put<int32_t>(out, geometry.nodes);
+    put<int32_t>(out, geometry.cpusPerNode);
+    put<int32_t>(out, geometry.cacheLines);
+    put<int32_t>(out, geometry.memoryWords);
+    put<int32_t>(out, geometry.ways);
+    put<int32_t>(out, geometry.replacement);
+    put<int32_t>(out, geometry.directory);
+    put<int32_t>(out, geometry.directoryParam);
+    put<int32_t>(out, geometry.protocol);
+    put<int32_t>(out, geometry.writeAllocate);
+    put<int32_t>(out, geometry.lineWords);
+    put<int32_t>(out, geometry.topology);
+    put<int32_t>(out, geometry.topologyParam);
+    put<int32_t>(out, geometry.hopClocks);
+    put<int32_t>(out, geometry.placement);
+    put<int32_t>(out, geometry.pageWords);
+    put<int32_t>(out, geometry.migrateAfter);
+    put<int64_t>(out, system.clockCount);
+    put<int64_t>(out, system.instructionCount);
+
+    for (int i = 0; i < geometry.nodes; i++)
+    {
+        const Node& node = system.nodes[i];
+        out.write((const char*)node.registers.data(), node.registers.size() * sizeof(uint32_t));
+        for (const CacheLine& line : node.caches)
+        {
+            out.write((const char*)node.dataOf(line), geometry.lineWords * sizeof(uint32_t));
+            put(out, line.tag);
+            put<uint8_t>(out, line.valid);
+            put(out, line.state);
+        }
+        out.write((const char*)node.ages.data(), node.ages.size());
+        out.write((const char*)node.setStates.data(), node.setStates.size() * sizeof(uint32_t));
+        out.write((const char*)node.memory.data(), node.memory.size() * sizeof(uint32_t));
+        for (const DirEntry& entry : node.directory)
+            put<uint8_t>(out, entry.state);
+        out.write((const char*)node.sharers.data(), node.sharers.size() * sizeof(uint64_t));
+    }
+
+    const Stats& stats = system.stats;
+    out.write((const char*)stats.cpus.data(), stats.cpus.size() * sizeof(CpuStats));
+    out.write((const char*)stats.addresses.data(), stats.addresses.size() * sizeof(AddressStats));
+    out.write((const char*)stats.latencies, sizeof(stats.latencies));
+
+    const PageTable& table = system.pageTable;
+    out.write((const char*)table.frames.data(), table.frames.size() * sizeof(int32_t));
+    out.write((const char*)table.nextSwap.data(), table.nextSwap.size() * sizeof(int32_t));
+    put<int32_t>(out, table.nextNode);
+    out.write((const char*)table.uses.data(), table.uses.size() * sizeof(PageUse));
+    put<int64_t>(out, stats.migrations);
+}
+
+unique_ptr<System> readSnapshot(istream& in)
+{
+    char magic[8];
+    int32_t shape[17];
+    int64_t clockCount = 0;
+    int64_t instructionCount = 0;
+    bool ok = in.read(magic, sizeof(magic)) && memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0
+              && in.read((char*)shape, sizeof(shape)) && get(in, clockCount) && get(in, instructionCount);
+
+    Geometry geometry;
+    if (ok)
+    {
+        geometry.nodes = shape[0];
+        geometry.cpusPerNode = shape[1];
+        geometry.cacheLines = shape[2];
+        geometry.memoryWords = shape[3];
+        geometry.ways = shape[4];
+        geometry.replacement = Replacement(shape[5]);
+        geometry.directory = DirectoryFormat(shape[6]);
+        geometry.directoryParam = shape[7];
+        geometry.protocol = Protocol(shape[8]);
+        geometry.writeAllocate = shape[9] != 0;
+        geometry.lineWords = shape[10];
+        geometry.topology = Topology(shape[11]);
+        geometry.topologyParam = shape[12];
+        geometry.hopClocks = shape[13];
+        geometry.placement = Placement(shape[14]);
+        geometry.pageWords = shape[15];
+        geometry.migrateAfter = shape[16];
+    }
+    if (!ok || shape[0] <= 0 || shape[1] <= 0 || shape[2] <= 0 || shape[3] <= 0 || shape[0] > 65536 || shape[1] > 256
+        || shape[5] < REPLACE_LRU || shape[5] > REPLACE_RANDOM
+        || shape[6] < DIR_FULL || shape[6] > DIR_POINTERS
+        || shape[8] < PROTO_DASH || shape[8] > PROTO_MOESI
+        || shape[11] < TOPO_FLAT || shape[11] > TOPO_FAT_TREE
+        || shape[14] < PLACE_BLOCK || shape[14] > PLACE_ROUND_ROBIN || cacheShapeError(geometry) != nullptr)
+    {
+        cerr << "Not a valid snapshot" << endl;
+        return nullptr;
+    }
+
+    unique_ptr<System> system(new System(geometry));
+    system->clockCount = clockCount;
+    system->instructionCount = instructionCount;
+
+    // every state is checked against its enum before the protocol or a printer can index by it,
+    // .... a valid line's tag has to name a block of the machine and a pointer entry has to list nodes of it
+    const Geometry& derived = system->geometry;
+    long long blocks = (long long)derived.nodes * derived.memoryBlocks;
+    bool statesValid = true;
+    for (int i = 0; i < geometry.nodes && in && statesValid; i++)
+    {
+        Node& node = system->nodes[i];
+        in.read((char*)node.registers.data(), node.registers.size() * sizeof(uint32_t));
+        for (size_t index = 0; index < node.caches.size(); index++)
+        {
+            CacheLine& line = node.caches[index];
+            uint8_t valid = 0;
+            in.read((char*)node.dataOf(line), geometry.lineWords * sizeof(uint32_t));
+            get(in, line.tag);
+            get(in, valid);
+            line.valid = valid;
+            get(in, line.state);
+            int set = int(index % derived.cacheLines) / derived.ways;
+            statesValid = statesValid && line.state <= LINE_OWNED
+                          && (!line.valid || (long long)line.tag * derived.sets + set < blocks);
+        }
+        in.read((char*)node.ages.data(), node.ages.size());
+        in.read((char*)node.setStates.data(), node.setStates.size() * sizeof(uint32_t));
+        in.read((char*)node.memory.data(), node.memory.size() * sizeof(uint32_t));
+        for (DirEntry& entry : node.directory)
+        {
+            uint8_t state = 0;
+            get(in, state);
+            entry.state = DirState(state);
+            statesValid = statesValid && state <= DIRTY;
+        }
+        in.read((char*)node.sharers.data(), node.sharers.size() * sizeof(uint64_t));
+        for (int block = 0; derived.directory == DIR_POINTERS && block < derived.memoryBlocks; block++)
+        {
+            const uint64_t* sharers = node.sharersOf(block);
+            uint16_t count = pointerSlot(sharers, 0);
+            statesValid = statesValid && (count == BROADCAST || count <= derived.directoryParam);
+            for (int slot = 1; statesValid && count != BROADCAST && slot <= count; slot++)
+                statesValid = pointerSlot(sharers, slot) < derived.nodes;
+        }
+    }
+    if (!in || !statesValid)
+    {
+        cerr << "Not a valid snapshot" << endl;
+        return nullptr;
+    }
+
+    Stats& stats = system->stats;
+    in.read((char*)stats.cpus.data(), stats.cpus.size() * sizeof(CpuStats));
+    in.read((char*)stats.addresses.data(), stats.addresses.size() * sizeof(AddressStats));
+    in.read((char*)stats.latencies, sizeof(stats.latencies));
+    {
+        // the free frames and the first free frame of every node follow from where the pages are
+        PageTable& table = system->pageTable;
+        vector<int32_t> frames(table.frames.size());
+        in.read((char*)frames.data(), frames.size() * sizeof(int32_t));
+        table.frames.assign(frames.size(), NO_FRAME);
+        table.pages.assign(frames.size(), NO_PAGE);
+        table.firstFree.assign(geometry.nodes, 0);
+        for (size_t page = 0; page < frames.size(); page++)
+        {
+            if (frames[page] < NO_FRAME || frames[page] >= (int32_t)frames.size()
+                || (frames[page] != NO_FRAME && table.pages[frames[page]] != NO_PAGE))
+            {
+                cerr << "Not a valid snapshot" << endl;
+                return nullptr;
+            }
+            if (frames[page] != NO_FRAME)
+                table.assign(system->geometry, page, frames[page]);
+        }
+        in.read((char*)table.nextSwap.data(), table.nextSwap.size() * sizeof(int32_t));
+        get(in, table.nextNode);
+        in.read((char*)table.uses.data(), table.uses.size() * sizeof(PageUse));
+        get(in, system->stats.migrations);
+        bool inRange = table.nextNode >= 0 && table.nextNode < geometry.nodes;
+        for (int32_t frame : table.nextSwap)
+            inRange = inRange && frame >= 0 && frame < system->geometry.framesPerNode;
+        if (in && !inRange)
+        {
+            cerr << "Not a valid snapshot" << endl;
+            return nullptr;
+        }
+    }
+    if (!in)
+    {
+        cerr << "Not a valid snapshot" << endl;
+        return nullptr;
+    }
+    return system;
+}
+
+bool saveSnapshot(const string& path, const System& system)
+{
+    ofstream out(path, ios::binary);
+    if (!out)
+    {
+        cerr << "Could not open " << path << endl;
+        return false;
+    }
+    writeSnapshot(out, system);
+    return (bool)out;
+}
+
+unique_ptr<System> loadSnapshot(const string& path)
+{
+    ifstream in(path, ios::binary);
+    if (!in)
+    {
+        cerr << "Could not open " << path << endl;
+        return nullptr;
+    }
+    return readSnapshot(in);
+}
@@ -0,0 +1,27 @@
+/* Packed binary snapshots of the whole machine
+ * A snapshot holds the geometry, the clock count and every register, cache line, memory word and directory entry
+ * .... of every node. It is a fraction of the size of the printAll text dump, which can be recreated from it
+ * .... with --view
+ * A snapshot also holds how many trace records have been executed and the stats counters, so it doubles as a
+ * .... checkpoint: a system loaded from it continues the trace where it stopped (--checkpoint and --resume)
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include "system.h"
+
+// Writes the state of the system to out
+void writeSnapshot(std::ostream& out, const System& system);
+
+// Reads a snapshot into a new system, returns nullptr with a message on cerr if it is not a valid snapshot
+std::unique_ptr<System> readSnapshot(std::istream& in);
+
+// The same as above for a file
+bool saveSnapshot(const std::string& path, const System& system);
+std::unique_ptr<System> loadSnapshot(const std::string& path);
+
+#endif
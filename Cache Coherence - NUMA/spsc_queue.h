@@ -0,0 +1,54 @@
+/* A bounded lock-free queue for exactly one producer thread and one consumer thread
+ * The producer only writes tail and the consumer only writes head, so no locks or compare-and-swap are needed
+ */
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+template <class T>
+class SpscQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    // Adds an item, waits while the queue is full
+    void push(const T& item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        while (t - head.load(std::memory_order_acquire) > mask)
+            std::this_thread::yield();
+        slots[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    // Removes the oldest item into item, returns false if the queue is empty
+    bool pop(T& item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        item = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
+
+#endif
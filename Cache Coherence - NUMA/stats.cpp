@@ -0,0 +1,191 @@
+/* Counters collected while simulating the cc-NUMA machine, see stats.h
+ */
+#include "stats.h"
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+const char* const ACCESS_CASE_NAMES[CASE_COUNT] = {
+    "load_local_hit", "load_sister_hit", "load_home", "load_dirty_remote", "store_hit", "store_miss",
+    "store_upgrade"
+};
+
+const int ACCESS_LATENCIES[CASE_COUNT] = {1, 30, 100, 135, 1, 100, 100};
+
+//returns the histogram bucket for a latency
+static int latencyBucket(int latency)
+{
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (2 << bucket) <= latency)
+        bucket++;
+    return bucket;
+}
+
+void Stats::reset(const Geometry& geometry)
+{
+    cpus.assign(geometry.nodes * geometry.cpusPerNode, CpuStats());
+    addresses.assign(geometry.totalWords, AddressStats());
+    memset(latencies, 0, sizeof(latencies));
+    migrations = 0;
+}
+
+void Stats::count(AccessCase path, int cpu, int memoryAddress, bool remote, int latency)
+{
+    CpuStats& c = cpus[cpu];
+    c.cases[path]++;
+    c.clocks += latency;
+    AddressStats& a = addresses[memoryAddress];
+    if (path < STORE_HIT)
+        a.loads++;
+    else
+        a.stores++;
+    if (remote)
+        a.remote++;
+    latencies[path][latencyBucket(latency)]++;
+}
+
+void Stats::merge(const Stats& other)
+{
+    for (size_t i = 0; i < cpus.size(); i++)
+    {
+        for (int j = 0; j < CASE_COUNT; j++)
+            cpus[i].cases[j] += other.cpus[i].cases[j];
+        cpus[i].invalidations += other.cpus[i].invalidations;
+        cpus[i].writebacks += other.cpus[i].writebacks;
+        cpus[i].clocks += other.cpus[i].clocks;
+        cpus[i].probes += other.cpus[i].probes;
+    }
+    for (size_t i = 0; i < addresses.size(); i++)
+    {
+        addresses[i].loads += other.addresses[i].loads;
+        addresses[i].stores += other.addresses[i].stores;
+        addresses[i].remote += other.addresses[i].remote;
+        addresses[i].invalidations += other.addresses[i].invalidations;
+    }
+    for (int i = 0; i < CASE_COUNT; i++)
+        for (int j = 0; j < LATENCY_BUCKETS; j++)
+            latencies[i][j] += other.latencies[i][j];
+    migrations += other.migrations;
+}
+
+long long Stats::remoteAccesses() const
+{
+    long long remote = 0;
+    for (const AddressStats& a : addresses)
+        remote += a.remote;
+    return remote;
+}
+
+double Stats::remoteRatio() const
+{
+    long long accesses = 0;
+    for (const AddressStats& a : addresses)
+        accesses += a.loads + a.stores;
+    return accesses > 0 ? double(remoteAccesses()) / accesses : 0.0;
+}
+
+//writes the case counters, invalidations, write-backs, clocks and probes of one processor or a sum of processors
+static void writeCounters(ostream& out, const CpuStats& c)
+{
+    for (int i = 0; i < CASE_COUNT; i++)
+        out << "\"" << ACCESS_CASE_NAMES[i] << "\": " << c.cases[i] << ", ";
+    out << "\"invalidations\": " << c.invalidations << ", \"writebacks\": " << c.writebacks
+        << ", \"clocks\": " << c.clocks << ", \"probes\": " << c.probes;
+}
+
+static void addCounters(CpuStats& sum, const CpuStats& c)
+{
+    for (int i = 0; i < CASE_COUNT; i++)
+        sum.cases[i] += c.cases[i];
+    sum.invalidations += c.invalidations;
+    sum.writebacks += c.writebacks;
+    sum.clocks += c.clocks;
+    sum.probes += c.probes;
+}
+
+void writeStatsJson(ostream& out, const Stats& stats, const Geometry& geometry, const PageTable& pageTable,
+                    long long clockCount)
+{
+    out << "{\n";
+    out << "  \"geometry\": {\"nodes\": " << geometry.nodes << ", \"cpus_per_node\": " << geometry.cpusPerNode
+        << ", \"cache_lines\": " << geometry.cacheLines << ", \"line_bytes\": " << geometry.lineWords * 4 << ", \"ways\": " << geometry.ways << ", \"replacement\": \""
+        << REPLACEMENT_NAMES[geometry.replacement] << "\", \"memory_words\": " << geometry.memoryWords
+        << ", \"directory\": \"" << DIRECTORY_NAMES[geometry.directory] << "\", \"directory_param\": " << geometry.directoryParam
+        << ", \"protocol\": \"" << PROTOCOL_NAMES[geometry.protocol] << "\", \"write_allocate\": "
+        << (geometry.writeAllocate ? "true" : "false") << ", \"topology\": \"" << TOPOLOGY_NAMES[geometry.topology]
+        << "\", \"topology_param\": " << geometry.topologyParam << ", \"hop_clocks\": " << geometry.hopClocks
+        << ", \"placement\": \"" << PLACEMENT_NAMES[geometry.placement] << "\", \"page_words\": " << (1 << geometry.pageBits)
+        << ", \"migrate_after\": " << geometry.migrateAfter << "},\n";
+    out << "  \"clock_count\": " << clockCount << ",\n";
+
+    CpuStats total = {};
+    for (const CpuStats& c : stats.cpus)
+        addCounters(total, c);
+    out << "  \"totals\": {";
+    writeCounters(out, total);
+    out << ", \"remote_accesses\": " << stats.remoteAccesses() << ", \"remote_ratio\": " << stats.remoteRatio()
+        << ", \"migrations\": " << stats.migrations << "},\n";
+
+    out << "  \"latency_histograms\": {";
+    for (int i = 0; i < CASE_COUNT; i++)
+    {
+        out << (i ? ", " : "") << "\"" << ACCESS_CASE_NAMES[i] << "\": [";
+        bool first = true;
+        for (int b = 0; b < LATENCY_BUCKETS; b++)
+        {
+            if (stats.latencies[i][b] == 0)
+                continue;
+            out << (first ? "" : ", ") << "{\"min\": " << (1ll << b) << ", \"max\": " << ((2ll << b) - 1)
+                << ", \"count\": " << stats.latencies[i][b] << "}";
+            first = false;
+        }
+        out << "]";
+    }
+    out << "},\n";
+
+    out << "  \"nodes\": [";
+    for (int n = 0; n < geometry.nodes; n++)
+    {
+        CpuStats sum = {};
+        for (int c = 0; c < geometry.cpusPerNode; c++)
+            addCounters(sum, stats.cpus[n * geometry.cpusPerNode + c]);
+        out << (n ? ",\n    " : "\n    ") << "{\"node\": " << n << ", ";
+        writeCounters(out, sum);
+        out << "}";
+    }
+    out << "\n  ],\n";
+
+    out << "  \"cpus\": [";
+    for (int n = 0; n < geometry.nodes; n++)
+    {
+        for (int c = 0; c < geometry.cpusPerNode; c++)
+        {
+            out << (n || c ? ",\n    " : "\n    ") << "{\"node\": " << n << ", \"cpu\": " << c << ", ";
+            writeCounters(out, stats.cpus[n * geometry.cpusPerNode + c]);
+            out << "}";
+        }
+    }
+    out << "\n  ],\n";
+
+    // hottest addresses first, an address is hotter the more it is used and invalidated
+    vector<int> used;
+    for (size_t i = 0; i < stats.addresses.size(); i++)
+        if (stats.addresses[i].loads || stats.addresses[i].stores)
+            used.push_back(i);
+    auto heat = [&stats](int address)
+    {
+        const AddressStats& a = stats.addresses[address];
+        return a.loads + a.stores + a.invalidations;
+    };
+    stable_sort(used.begin(), used.end(), [&heat](int a, int b) { return heat(a) > heat(b); });
+
+    out << "  \"addresses\": [";
+    for (size_t i = 0; i < used.size(); i++)
+    {
+        const AddressStats& a = stats.addresses[used[i]];
+        out << (i ? ",\n    " : "\n    ") << "{\"address\": " << used[i] << ", \"home\": " << pageTable.physical(geometry, used[i]) / geometry.memoryWords
+            << ", \"loads\": " << a.loads << ", \"stores\": " << a.stores << ", \"remote\": " << a.remote
+            << ", \"invalidations\": " << a.invalidations << "}";
+    }
+    out << "\n  ]\n}\n";
+}
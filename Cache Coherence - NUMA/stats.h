@@ -0,0 +1,82 @@
+/* Counters collected while simulating the cc-NUMA machine
+ * Every load and store is counted by the path it took through memoryAccess/writeToMem, per processor,
+ * .... together with the invalidations and write-backs it caused and how often each address is used.
+ * writeStatsJson writes them out as a machine readable report
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "geometry.h"
+#include "placement.h"
+
+// The paths an access can take, see memoryAccess and writeToMem
+enum AccessCase
+{
+    LOAD_LOCAL_HIT,     // case 1, found in the local cache
+    LOAD_SISTER_HIT,    // case 2, found in another cache of the same node
+    LOAD_HOME,          // case 3, read from the home node's memory
+    LOAD_DIRTY_REMOTE,  // case 4, fetched from the cache holding the dirty copy
+    STORE_HIT,          // write hit
+    STORE_MISS,         // write miss
+    STORE_UPGRADE,      // write hit on a shared copy that had to ask home for ownership (MSI, MESI and MOESI)
+    CASE_COUNT
+};
+
+extern const char* const ACCESS_CASE_NAMES[CASE_COUNT];
+
+// The clocks charged for each path: 1, 30, 100, 135, 1, 100 and 100
+extern const int ACCESS_LATENCIES[CASE_COUNT];
+
+// Latencies are bucketed by powers of two, bucket b counts latencies from 2^b to 2^(b+1)-1
+const int LATENCY_BUCKETS = 32;
+
+struct CpuStats
+{
+    long long cases[CASE_COUNT];
+    long long invalidations;    // cached copies invalidated by this processor's stores
+    long long writebacks;       // dirty blocks this processor wrote back when replacing them
+    long long clocks;           // clocks spent on this processor's accesses
+    long long probes;           // nodes this processor's stores sent invalidations to, more than the copies
+                                // .... invalidated when the directory format is not exact (see directory.h)
+};
+
+struct AddressStats
+{
+    long long loads;
+    long long stores;
+    long long remote;           // accesses that had to leave the requesting node (cases 3 and 4, write misses)
+    long long invalidations;    // cached copies of this address that were invalidated
+};
+
+struct Stats
+{
+    std::vector<CpuStats> cpus;             // indexed by node * cpusPerNode + cpu
+    std::vector<AddressStats> addresses;    // indexed by memory address
+    long long latencies[CASE_COUNT][LATENCY_BUCKETS];
+    long long migrations;                   // pages moved to another node, see placement.h
+
+    void reset(const Geometry& geometry);
+
+    // counts one access that took the given path and latency
+    void count(AccessCase path, int cpu, int memoryAddress, bool remote, int latency);
+
+    // adds the counters of other into this one, used to combine the shards of a sharded run
+    void merge(const Stats& other);
+
+    // the accesses that had to leave the requesting node and their share of all loads and stores (0 without any)
+    long long remoteAccesses() const;
+    double remoteRatio() const;
+};
+
+/*
+ * Writes the counters as a JSON object with
+ * .... totals per access case, latency histograms per access case, counters per processor and per node
+ * .... and every address that was used, hottest first, with the node its page lives on in the end
+ */
+void writeStatsJson(std::ostream& out, const Stats& stats, const Geometry& geometry, const PageTable& pageTable,
+                    long long clockCount);
+
+#endif
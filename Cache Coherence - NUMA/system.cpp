@@ -0,0 +1,772 @@
+/* The simulated cc-NUMA (DASH) machine
+ * see system.h for a description of the Node and the System
+ */
+#include "system.h"
+#include "topology.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+using namespace std;
+
+/*
+ * Each decoded opcode is dispatched through a table of handlers indexed by the 6 bit opcode
+ * .... lw -> memoryAccess, sw -> writeToMem, every other opcode -> unknownOp
+ * There is one table per protocol and write-allocate choice holding that combination's instantiations,
+ * .... the System picks its table once so the protocol costs nothing per instruction (see protocol.h)
+ * New instructions are added by giving them an OpCode and an entry in the tables
+ */
+template <class Protocol, bool WriteAllocate>
+static const System::OpHandler* protocolTable()
+{
+    static const struct Table
+    {
+        System::OpHandler handlers[OPCODE_COUNT];
+        Table()
+        {
+            for (int i = 0; i < OPCODE_COUNT; i++)
+                handlers[i] = &System::unknownOp;
+            handlers[OP_LW] = &System::memoryAccess<Protocol>;
+            handlers[OP_SW] = &System::writeToMem<Protocol, WriteAllocate>;
+        }
+    } table;
+    return table.handlers;
+}
+
+static const System::OpHandler* opTable(const Geometry& geometry)
+{
+    switch (geometry.protocol)
+    {
+        case PROTO_MSI:
+            return geometry.writeAllocate ? protocolTable<MsiProtocol, true>() : protocolTable<MsiProtocol, false>();
+        case PROTO_MESI:
+            return geometry.writeAllocate ? protocolTable<MesiProtocol, true>() : protocolTable<MesiProtocol, false>();
+        case PROTO_MOESI:
+            return geometry.writeAllocate ? protocolTable<MoesiProtocol, true>() : protocolTable<MoesiProtocol, false>();
+        default:
+            return geometry.writeAllocate ? protocolTable<DashProtocol, true>() : protocolTable<DashProtocol, false>();
+    }
+}
+
+/* The System constructor (initializeSystem) resets the contents of the systems nodes to be all 0s except for in memory
+ * the value at each memory location will be the memory address + 5
+ *  .... For example Mem[0] = 5, Mem[1] = 6, ... , Mem[62] = 67, Mem[63]= = 68
+ * (the global address of the page in the frame, frames without a page stay 0 until one is placed, see placement.h)
+ * */
+System::System(const Geometry& config) : geometry(config), clockCount(0), instructionCount(0)
+{
+    deriveGeometry(geometry);
+    stats.reset(geometry);
+    pageTable.reset(geometry);
+    handlers = opTable(geometry);
+
+    size_t lines = geometry.cpusPerNode * geometry.cacheLines;
+    size_t sets = geometry.cpusPerNode * geometry.sets;
+    size_t words = geometry.memoryWords;
+    size_t blocks = geometry.memoryBlocks;
+    size_t nodeBytes = NodeArena::padded(geometry.cpusPerNode * 2 * sizeof(uint32_t))
+                       + NodeArena::padded(lines * sizeof(CacheLine)) + NodeArena::padded(lines * geometry.lineWords * sizeof(uint32_t))
+                       + NodeArena::padded(words * sizeof(uint32_t)) + NodeArena::padded(blocks * sizeof(DirEntry))
+                       + NodeArena::padded(blocks * geometry.sharerWords * sizeof(uint64_t))
+                       + NodeArena::padded(lines * sizeof(uint8_t)) + NodeArena::padded(sets * sizeof(uint32_t));
+    arena.reserve(nodeBytes * geometry.nodes);
+
+    nodeStorage.assign(geometry.nodes, Node());
+    nodes = nodeStorage.data();
+    for (int i =0; i<geometry.nodes; i++)
+    {
+        Node& node = nodes[i];
+        node.cacheLines = geometry.cacheLines;
+        node.ways = geometry.ways;
+        node.lineWords = geometry.lineWords;
+        node.sharerWords = geometry.sharerWords;
+        node.registers = arena.take<uint32_t>(geometry.cpusPerNode * 2);
+        node.caches = arena.take<CacheLine>(lines);
+        node.lineData = arena.take<uint32_t>(lines * geometry.lineWords);
+        node.memory = arena.take<uint32_t>(words);
+        node.directory = arena.take<DirEntry>(blocks);
+        node.sharers = arena.take<uint64_t>(blocks * geometry.sharerWords);
+        node.ages = arena.take<uint8_t>(lines);
+        node.setStates = arena.take<uint32_t>(sets);
+        for (int cpu = 0; cpu < geometry.cpusPerNode; cpu++)
+            for (int set = 0; set < geometry.sets; set++)
+                resetWays(node.agesOf(cpu, set), node.setState(cpu, set), geometry.ways, geometry.replacement,
+                          (i * geometry.cpusPerNode + cpu) * geometry.sets + set + 1);
+        for(int j =0; j<geometry.memoryWords; j++)
+        {
+            int page = pageTable.pages[(i*geometry.memoryWords + j) >> geometry.pageBits];
+            if (page != NO_PAGE)
+                node.memory[j] = (page << geometry.pageBits | (j & ((1 << geometry.pageBits) - 1))) + 5;
+        }
+    }
+}
+
+void NodeArena::reserve(size_t bytes)
+{
+    // operator new only promises 16 byte alignment, the extra 64 bytes let the first array start on a boundary
+    storage.reset(new unsigned char[bytes + 64]);
+    used = (64 - reinterpret_cast<uintptr_t>(storage.get()) % 64) % 64;
+}
+
+System::System(System& parent, ShareNodes) : geometry(parent.geometry), nodes(parent.nodes), clockCount(0),
+    instructionCount(0), pageTable(parent.pageTable), handlers(parent.handlers)
+{
+    stats.reset(geometry);
+}
+
+/*
+ * runTrace replays a trace file through the system
+ * Each instruction is fetched from the file (simulated instruction memory), decoded and executed
+ * .... until there are no more instructions (see forEachRecord in trace.h)
+ * The instructions already executed are skipped, so a system restored from a checkpoint carries on where it stopped
+*/
+bool System::runTrace(const string& path, long long until)
+{
+    return forEachRecord(path, geometry, [this](const TraceRecord& record) { execute(record); }, instructionCount, until);
+}
+
+uint64_t System::stateHash() const
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint64_t value)
+    {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+    for (int i = 0; i < geometry.nodes; i++)
+    {
+        const Node& node = nodes[i];
+        for (uint32_t value : node.registers)
+            mix(value);
+        for (const CacheLine& line : node.caches)
+        {
+            mix(line.valid);
+            mix(line.tag);
+            const uint32_t* data = node.dataOf(line);
+            for (int w = 0; w < geometry.lineWords; w++)
+                mix(data[w]);
+            if (geometry.protocol != PROTO_DASH)
+                mix(line.state);
+        }
+        for (uint32_t value : node.memory)
+            mix(value);
+        for (const DirEntry& entry : node.directory)
+            mix(entry.state);
+        for (uint64_t value : node.sharers)
+            mix(value);
+    }
+    //where the pages ended up, only a dynamic placement or migration moves them
+    if (!PageTable::isStatic(geometry))
+        for (int32_t frame : pageTable.frames)
+            mix(uint32_t(frame));
+    return hash;
+}
+
+//returns the line of a processor in the node other than cpuIndex that holds a valid copy of the block
+//or nullptr if no sister cache holds it
+CacheLine* System::findInSister(int nodeIndex, int cpuIndex, int set, uint32_t tag)
+{
+    for (int i = 1; i < geometry.cpusPerNode; i++)
+    {
+        CacheLine* lines = nodes[nodeIndex].cacheSet((cpuIndex + i) % geometry.cpusPerNode, set);
+        int way = findWay(lines, geometry.ways, tag);
+        if (way >= 0)
+            return &lines[way];
+    }
+    return nullptr;
+}
+
+//returns a valid copy of a dirty or owned block in the nodes listed in the sharer vector, or nullptr if
+//the owner no longer holds it, ownerNode is set to the node holding it
+//a dirty block has exactly one owner, a coarse vector only narrows it down to a group of nodes
+//under MSI, MESI and MOESI the owner is the copy that is not shared, the others are S copies of an owned block
+template <class Protocol>
+CacheLine* System::findOwner(const uint64_t* sharers, int set, uint32_t tag, int& ownerNode)
+{
+    ownerNode = -1;
+    CacheLine* owner = nullptr;
+    forEachSharer(geometry, sharers, [&](int i)
+    {
+        for(int j = 0; j<geometry.cpusPerNode && owner == nullptr; j++)
+        {
+            CacheLine* lines = nodes[i].cacheSet(j, set);
+            int way = findWay(lines, geometry.ways, tag);
+            if (way >= 0 && (!Protocol::lineStates || lines[way].state != LINE_SHARED))
+            {
+                ownerNode = i;
+                owner = &lines[way];
+            }
+        }
+        if (ownerNode < 0)
+            ownerNode = i;
+    });
+    return owner;
+}
+
+//copies the lineWords words of one block between cache lines and memory
+void System::copyBlock(uint32_t* to, const uint32_t* from) const
+{
+    for (int w = 0; w < geometry.lineWords; w++)
+        to[w] = from[w];
+}
+
+//tells the replacement policy that a processor used one way of a set
+void System::touch(int nodeIndex, int cpuIndex, int set, int way)
+{
+    Node& node = nodes[nodeIndex];
+    touchWay(node.agesOf(cpuIndex, set), node.setState(cpuIndex, set), geometry.ways, way, geometry.replacement);
+}
+
+//invalidates every cached copy of the block in the nodes listed in the sharer vector
+//except for the requesting processor's own line, returns the number of copies invalidated
+//only the sharers are visited (see forEachSharer), not every node
+int System::invalidateSharers(const uint64_t* sharers, int set, uint32_t tag, int nodeIndex, int cpuIndex)
+{
+    int invalidated = 0;
+    long long& probes = stats.cpus[nodeIndex * geometry.cpusPerNode + cpuIndex].probes;
+    forEachSharer(geometry, sharers, [&](int i)
+    {
+        probes++;
+        if (timing != nullptr && i != nodeIndex)
+            timing->addTarget(i);
+        for (int j = 0; j<geometry.cpusPerNode; j++)
+        {
+            //if the value in the cache is the one being updated
+            CacheLine* lines = nodes[i].cacheSet(j, set);
+            int way = findWay(lines, geometry.ways, tag);
+            if(way >= 0 && !(i == nodeIndex && j == cpuIndex))
+            {
+                lines[way].valid = false;
+                invalidated++;
+                if (invalidationLog != nullptr)
+                    invalidationLog->push_back((i * geometry.cpusPerNode + j) * geometry.cacheLines + set * geometry.ways + way);
+            }
+        }
+    });
+    return invalidated;
+}
+
+//charge adds the latency of one access (see ACCESS_LATENCIES) to the clock count and counts it in the stats
+//.... under a topology the hops of its messages add to the latency (see distanceClocks in topology.h)
+//owner is the node that held a dirty block, it is only needed for the distance and the timing model
+void System::charge(AccessCase path, int nodeIndex, int cpuIndex, int memoryAddress, bool remote, int owner)
+{
+    int homeNode = physicalOf(memoryAddress) / geometry.memoryWords;
+    int latency = ACCESS_LATENCIES[path] + distanceClocks(geometry, path, nodeIndex, homeNode, owner);
+    clockCount += latency;
+    stats.count(path, nodeIndex * geometry.cpusPerNode + cpuIndex, memoryAddress, remote, latency);
+    if (timing != nullptr)
+        timing->record(nodeIndex * geometry.cpusPerNode + cpuIndex, path, homeNode, owner);
+}
+
+//counts the copies invalidated by a store of the given processor
+void System::countInvalidations(int nodeIndex, int cpuIndex, int memoryAddress, int invalidated)
+{
+    stats.cpus[nodeIndex * geometry.cpusPerNode + cpuIndex].invalidations += invalidated;
+    stats.addresses[memoryAddress].invalidations += invalidated;
+}
+
+//changes the state of a copy held by another processor of the node, when a load shares or takes over its block
+void System::downgrade(int nodeIndex, CacheLine& line, LineState state)
+{
+    line.state = state;
+    if (downgradeLog != nullptr)
+        downgradeLog->push_back(nodeIndex * geometry.cpusPerNode * geometry.cacheLines + int(&line - nodes[nodeIndex].caches.data()));
+}
+
+// The execute function checks that a decoded instruction is inside the system and dispatches it to its handler
+// .... the ALU step (adding the word offset to the base address) was already done when decoding
+void System::execute(const TraceRecord& record)
+{
+    instructionCount++;
+    if (record.node >= geometry.nodes || record.cpu >= geometry.cpusPerNode)
+    {
+        cerr << "Skipping instruction for node " << record.node << " cpu " << (int)record.cpu << " outside the system" << endl;
+        return;
+    }
+    if (record.address >= (uint32_t)geometry.totalWords)
+    {
+        cerr << "Skipping access to address " << record.address << " outside of memory" << endl;
+        return;
+    }
+    if (geometry.migrateAfter > 0 && (opcodeOf(record) == OP_LW || opcodeOf(record) == OP_SW))
+    {
+        //the access was remote if it added to its address's remote count
+        long long remote = stats.addresses[record.address].remote;
+        (this->*handlers[opcodeOf(record)])(record.node, record.cpu, record.address, registerOf(record));
+        trackPage(record.node, record.address, stats.addresses[record.address].remote != remote);
+        return;
+    }
+    (this->*handlers[opcodeOf(record)])(record.node, record.cpu, record.address, registerOf(record));
+}
+
+//unknownOp handles every opcode that is not a load or store, the instruction is ignored
+void System::unknownOp(int nodeIndex, int cpuIndex, int /*memoryAddress*/, int /*reg*/)
+{
+    cerr << "Skipping unsupported instruction on node " << nodeIndex << " cpu " << cpuIndex << endl;
+}
+
+/*
+ * The memoryAccess function is responsible for retrieving the correct value from memory (lw)
+ * First: The function will check the local processors cache in search of the value in the memory address
+ * .... making sure that the valid bit is 1. If found load it into register and done (one clock)
+ * .... if not found go to next step
+ * Second: Check other caches in local node, if found load it into local cache & reg then done (30 clocks)
+ * .... if not found go to next step
+ * Third: Search home node's memory/directory. If 'uncached' or 'shared' then load it into local cache/reg (100 clocks)
+ * .... if not found go to next step
+ * Fourth: Search all caches in the "dirty" node. (use MOD sets for the cache set)
+ * .... When found perform necessary operations (135 clocks)
+ * .... go to dirty node and find valid value in cache
+ * .... share write-back to home
+ * .... dirty -> shared
+ * .... load into local cache/reg
+ *** In all the above steps manage the directories and cache invalid/valid bits correctly ***
+ * On a miss the block is loaded into the way of the set picked by the replacement policy (see replacement.h)
+ * .... all lineWords words of it, so a later load of a neighbouring word hits
+ * Under MSI, MESI and MOESI the sister or owner copy is downgraded, MESI and MOESI load an uncached block Exclusive
+ * .... (see protocol.h)
+*/
+template <class Protocol>
+void System::memoryAccess(int nodeIndex, int cpuIndex, int memoryAddress, int reg)
+{
+    //compute the cache set and the tag of the block, and the word within it
+    int block = blockOf(geometry, memoryAddress);
+    int offset = memoryAddress & (geometry.lineWords - 1);
+    int set = block % geometry.sets;
+    uint32_t tag = block / geometry.sets;
+    Node& local = nodes[nodeIndex];
+    CacheLine* localSet = local.cacheSet(cpuIndex, set);
+    int way = findWay(localSet, geometry.ways, tag);
+
+    if  (way >= 0)
+    { // Case 1: Valid copy found in local cache
+        //Copy cached value into register
+        charge(LOAD_LOCAL_HIT, nodeIndex, cpuIndex, memoryAddress, false);
+        local.reg(cpuIndex, reg) = local.dataOf(localSet[way])[offset];
+        touch(nodeIndex, cpuIndex, set, way);
+    }//end if case 1
+    else //else not case 1
+    {
+        //since not found in local cache write back the replaced line's contents before loading new value
+        way = victimWay(validWays(localSet, geometry.ways), local.agesOf(cpuIndex, set), local.setState(cpuIndex, set),
+                        geometry.ways, geometry.replacement);
+        writeBack<Protocol>(nodeIndex, cpuIndex, set * geometry.ways + way);
+        CacheLine& localLine = localSet[way];
+        touch(nodeIndex, cpuIndex, set, way);
+
+        int physical = physicalAddress(memoryAddress, nodeIndex);
+        int homeNode = physical / geometry.memoryWords;
+        int localBlock = blockOf(geometry, physical) % geometry.memoryBlocks;
+        Node& home = nodes[homeNode];
+        uint32_t* homeData = &home.memory[localBlock * geometry.lineWords];
+        DirEntry& entry = home.directory[localBlock];
+        uint32_t* localData = local.dataOf(localLine);
+
+        //Check sister processors caches
+        CacheLine* sisterLine = findInSister(nodeIndex, cpuIndex, set, tag);
+        if  (sisterLine != nullptr)
+        { //Case 2 valid copy found in sister cache
+            charge(LOAD_SISTER_HIT, nodeIndex, cpuIndex, memoryAddress, false);
+            localLine = *sisterLine;                        //Copy valid bit, tag field and value into local cache
+            copyBlock(localData, local.dataOf(*sisterLine));
+            localLine.state = LINE_SHARED;
+            local.reg(cpuIndex, reg) = localData[offset];   //Copy value into local register
+
+            //an exclusive sister copy is shared now, a modified one is written back or becomes the owner
+            if (Protocol::lineStates && (sisterLine->state == LINE_EXCLUSIVE || sisterLine->state == LINE_MODIFIED))
+            {
+                if (Protocol::owned && sisterLine->state == LINE_MODIFIED)
+                {
+                    downgrade(nodeIndex, *sisterLine, LINE_OWNED);
+                    entry.state = OWNED;
+                }
+                else
+                {
+                    copyBlock(homeData, localData);
+                    downgrade(nodeIndex, *sisterLine, LINE_SHARED);
+                    entry.state = SHARED;
+                }
+            }
+        } //end if case 2
+        else //else not case 2
+        {
+            uint64_t* sharers = home.sharersOf(localBlock);
+            if (entry.state == UNCACHED || entry.state == SHARED)
+            {// if case 3, copy from home node (uncached or shared)
+                charge(LOAD_HOME, nodeIndex, cpuIndex, memoryAddress, homeNode != nodeIndex);
+                local.reg(cpuIndex, reg) = homeData[offset];            //Copy value into local register
+                copyBlock(localData, homeData);                         //Copy the block into local cache
+                localLine.valid = true;                                 //set local cache to valid
+                localLine.tag = tag;                                    //Copy tag field
+                localLine.state = LINE_SHARED;
+
+                //set directory to shared, or to dirty with an exclusive copy if nobody else had it
+                if (Protocol::exclusive && entry.state == UNCACHED)
+                {
+                    localLine.state = LINE_EXCLUSIVE;
+                    entry.state = DIRTY;
+                }
+                else
+                    entry.state = SHARED;
+                addSharer(geometry, sharers, nodeIndex);
+
+            }//end if case 3
+
+            else //case 4
+            {
+                //Find which node and CPU contain the dirty data
+                int dirtyNode;
+                CacheLine* dirtyLine = findOwner<Protocol>(sharers, set, tag, dirtyNode);
+                const uint32_t* dirtyData = dirtyLine != nullptr ? nodes[dirtyNode].dataOf(*dirtyLine) : homeData;
+
+                charge(LOAD_DIRTY_REMOTE, nodeIndex, cpuIndex, memoryAddress, homeNode != nodeIndex || dirtyNode != nodeIndex, dirtyNode);
+
+                //share write-back to home, if the owner no longer holds the block memory is already current
+                //an owned copy keeps supplying the block and a modified one becomes the owner under MOESI
+                entry.state = SHARED;
+                if (dirtyLine != nullptr && Protocol::owned && dirtyLine->state != LINE_EXCLUSIVE)
+                {
+                    if (dirtyLine->state != LINE_OWNED)
+                        downgrade(dirtyNode, *dirtyLine, LINE_OWNED);
+                    entry.state = OWNED;
+                }
+                else if(dirtyLine != nullptr)
+                {
+                    copyBlock(homeData, dirtyData);
+                    if (Protocol::lineStates)
+                        downgrade(dirtyNode, *dirtyLine, LINE_SHARED);
+                }
+
+                local.reg(cpuIndex, reg) = dirtyData[offset];
+                copyBlock(localData, dirtyData);                        // load the block into local cache
+
+                //set local cache valid and tag fields
+                localLine.valid = true;
+                localLine.tag = tag;
+                localLine.state = LINE_SHARED;
+
+                //Indicate that current cache has the memory value
+                addSharer(geometry, sharers, nodeIndex);
+            }//end else case 4
+        } //end else not case 2
+    } //end else not case 1
+}
+
+/* writeToMem will write the value in a given register to a given memory position (sw)
+ * 1: Search local cache (local to each processor) (check valid bit and tag)
+ * .... if found get exclusive access to it:
+ * ........ using home directory invalidate all others that are shared
+ * ........ update value in (local cache?) with contents of register (1 clock)
+ * ........ home directory is dirty
+ * .... else go to step 2
+ * 2: Update home node memory with the content of the register (100 clocks)
+ * .... if directory indicates "uncached" -> "uncached"
+ * ........................... "shared"   -> "shared", but invalidate all shared cached copies (valid bit = 0)
+ * ........................... "dirty"    -> "shared", but invalidate all shared cached copies
+ * Under MSI, MESI and MOESI only an E or M copy is written in one clock, an S or O copy is upgraded at home (100 clocks)
+ * .... and a write miss leaves the block uncached. With write-allocate a write miss loads the block instead
+ * A store only writes one word of its block, so with more than one word per line a miss first has a dirty or owned copy
+ * .... written back to home, the other words of the block must not be lost with the invalidated copy
+ * */
+template <class Protocol, bool WriteAllocate>
+void System::writeToMem(int nodeIndex, int cpuIndex, int memoryAddress, int reg)
+{
+    //compute the cache set and the tag of the block, and the word within it
+    int block = blockOf(geometry, memoryAddress);
+    int offset = memoryAddress & (geometry.lineWords - 1);
+    int set = block % geometry.sets;
+    uint32_t tag = block / geometry.sets;
+
+    int physical = physicalAddress(memoryAddress, nodeIndex);
+    int homeNode = physical / geometry.memoryWords;
+    int localBlock = blockOf(geometry, physical) % geometry.memoryBlocks;
+    Node& local = nodes[nodeIndex];
+    CacheLine* localSet = local.cacheSet(cpuIndex, set);
+    int way = findWay(localSet, geometry.ways, tag);
+    uint32_t* homeData = &nodes[homeNode].memory[localBlock * geometry.lineWords];
+    DirEntry& entry = nodes[homeNode].directory[localBlock];
+    uint64_t* sharers = nodes[homeNode].sharersOf(localBlock);
+
+    //a miss on a block with more words than the store writes saves the rest of the newest copy at home first
+    if (way < 0 && geometry.lineWords > 1 && (entry.state == DIRTY || entry.state == OWNED))
+    {
+        int ownerNode;
+        const CacheLine* owner = findOwner<Protocol>(sharers, set, tag, ownerNode);
+        if (owner != nullptr)
+            copyBlock(homeData, nodes[ownerNode].dataOf(*owner));
+    }
+
+    //search local cache
+    if  (way >= 0 && Protocol::lineStates && localSet[way].state != LINE_SHARED && localSet[way].state != LINE_OWNED)
+    {   //Case 1: write hit on an exclusive copy, no other cache holds the block so nothing leaves the cache
+        touch(nodeIndex, cpuIndex, set, way);
+        charge(STORE_HIT, nodeIndex, cpuIndex, memoryAddress, false);
+        localSet[way].state = LINE_MODIFIED;
+        local.dataOf(localSet[way])[offset] = local.reg(cpuIndex, reg);
+    }
+    else if  (way >= 0 || WriteAllocate)
+    {   //Case 1: write hit (or a write miss loading the block under write-allocate)
+        if (way >= 0)
+        {
+            //Found in local cache, an S or O copy has to ask home for ownership under MSI, MESI and MOESI
+            charge(Protocol::lineStates ? STORE_UPGRADE : STORE_HIT, nodeIndex, cpuIndex, memoryAddress,
+                   Protocol::lineStates && homeNode != nodeIndex);
+        }
+        else
+        {
+            charge(STORE_MISS, nodeIndex, cpuIndex, memoryAddress, homeNode != nodeIndex);
+            way = victimWay(validWays(localSet, geometry.ways), local.agesOf(cpuIndex, set), local.setState(cpuIndex, set),
+                            geometry.ways, geometry.replacement);
+            writeBack<Protocol>(nodeIndex, cpuIndex, set * geometry.ways + way);
+            copyBlock(local.dataOf(localSet[way]), homeData);
+        }
+        CacheLine& localLine = localSet[way];
+        touch(nodeIndex, cpuIndex, set, way);
+        //set home dir to dirty 11
+        entry.state = DIRTY;
+
+        //invalidate all cached values of this, the writing node becomes the only sharer
+        countInvalidations(nodeIndex, cpuIndex, memoryAddress, invalidateSharers(sharers, set, tag, nodeIndex, cpuIndex));
+        clearSharers(geometry, sharers);
+        addSharer(geometry, sharers, nodeIndex);
+
+        //mark local cache as valid and update tag field
+        localLine.valid = true;
+        localLine.tag = tag;
+        localLine.state = Protocol::lineStates ? LINE_MODIFIED : LINE_SHARED;
+
+        //store in local cache, the value to be used is in the reg
+        local.dataOf(localLine)[offset] = local.reg(cpuIndex, reg);
+    } //end case 1:  (write-hit)
+    else
+    { //case 2: write-miss
+        //update home memory
+        charge(STORE_MISS, nodeIndex, cpuIndex, memoryAddress, homeNode != nodeIndex);
+        homeData[offset] = local.reg(cpuIndex, reg);
+
+        //invalidate all cached values of this
+        countInvalidations(nodeIndex, cpuIndex, memoryAddress, invalidateSharers(sharers, set, tag, nodeIndex, cpuIndex));
+        clearSharers(geometry, sharers);
+
+        // if the status is "shared" or "uncached" we do nothing BUT...
+        // if the status is dirty "11" then we switch it to shared "01"
+        // MSI, MESI and MOESI know no copy is left, so the next load can get the block exclusive
+        if (Protocol::lineStates)
+            entry.state = UNCACHED;
+        else if(entry.state == DIRTY)
+            entry.state = SHARED;
+    } //end case 2 write-miss
+}
+
+/* writeBack is used whan a cache block is being replaced
+ * if the cached value is valid it will go to the correct memory location and update it
+ * Under MSI, MESI and MOESI the line's own state decides: M and O lines are written back, an E line only gives up
+ * .... its ownership and S lines are dropped without telling home, as DASH does with clean copies
+*/
+template <class Protocol>
+void System::writeBack(int nodeIndex, int cpuIndex, int cacheIndex)
+{
+    const CacheLine& line = nodes[nodeIndex].cache(cpuIndex, cacheIndex);
+    //check if block to be replaced is valid
+    if(line.valid)
+    {
+        int set = cacheIndex / geometry.ways;
+        int block = line.tag * geometry.sets + set;
+
+        int physical = physicalOf(block * geometry.lineWords);
+        int homeNode = physical / geometry.memoryWords;
+        int localBlock = blockOf(geometry, physical) % geometry.memoryBlocks;
+        DirEntry& entry = nodes[homeNode].directory[localBlock];
+        bool owner = Protocol::lineStates ? line.state != LINE_SHARED : entry.state == DIRTY;
+
+        //write it back to memory if the valid block is dirty
+        if(owner)
+        {
+            if (!Protocol::lineStates || line.state == LINE_MODIFIED || line.state == LINE_OWNED)
+            {
+                copyBlock(&nodes[homeNode].memory[localBlock * geometry.lineWords], nodes[nodeIndex].dataOf(line));
+                stats.cpus[nodeIndex * geometry.cpusPerNode + cpuIndex].writebacks++;
+            }
+
+            //memory is current again, the block stays shared only if a sister cache still holds it
+            uint64_t* sharers = nodes[homeNode].sharersOf(localBlock);
+            if(findInSister(nodeIndex, cpuIndex, set, line.tag) != nullptr)
+                entry.state = SHARED;
+            else
+            {
+                removeSharer(geometry, sharers, nodeIndex);
+                entry.state = anySharer(geometry, sharers) ? SHARED : UNCACHED;
+            }
+        }
+    }
+}
+
+/* Page placement and migration, see placement.h
+ * placePage gives a page accessed for the first time a frame of the node the policy picks, the free frame
+ * .... is uncached so only the page's starting values have to be written
+ */
+void System::placePage(int page, int nodeIndex)
+{
+    int node = nodeIndex;
+    if (geometry.placement == PLACE_ROUND_ROBIN)
+    {
+        node = pageTable.nextNode;
+        pageTable.nextNode = (node + 1) % geometry.nodes;
+    }
+    int32_t frame = NO_FRAME;
+    for (int k = 0; frame == NO_FRAME; k++)
+        frame = pageTable.freeFrame(geometry, (node + k) % geometry.nodes);
+    pageTable.assign(geometry, page, frame);
+
+    uint32_t* words = &nodes[frame / geometry.framesPerNode].memory[(frame % geometry.framesPerNode) << geometry.pageBits];
+    for (int w = 0; w < (1 << geometry.pageBits); w++)
+        words[w] = (page << geometry.pageBits | w) + 5;
+}
+
+//counts a node's remote accesses to the page of an address in a row and migrates the page once there are enough
+void System::trackPage(int nodeIndex, int memoryAddress, bool remote)
+{
+    int page = memoryAddress >> geometry.pageBits;
+    PageUse& use = pageTable.uses[page];
+    int homeNode = physicalOf(memoryAddress) / geometry.memoryWords;
+    if (homeNode == nodeIndex)
+        use.count = 0;
+    else if (remote)
+    {
+        if (use.node != nodeIndex)
+        {
+            use.node = nodeIndex;
+            use.count = 0;
+        }
+        if (++use.count >= geometry.migrateAfter)
+        {
+            use.count = 0;
+            migratePage(page, nodeIndex);
+        }
+    }
+}
+
+//moves a page into a frame of the node, trading frames with the page in its next frame when the node is full
+void System::migratePage(int page, int nodeIndex)
+{
+    int32_t from = pageTable.frames[page];
+    int32_t to = pageTable.freeFrame(geometry, nodeIndex);
+    if (to == NO_FRAME)
+    {
+        to = nodeIndex * geometry.framesPerNode + pageTable.nextSwap[nodeIndex];
+        pageTable.nextSwap[nodeIndex] = (pageTable.nextSwap[nodeIndex] + 1) % geometry.framesPerNode;
+    }
+    int32_t other = pageTable.pages[to];
+    swapFrames(from, to);
+    pageTable.assign(geometry, page, to);
+    if (other != NO_PAGE)
+        pageTable.assign(geometry, other, from);
+    else
+        pageTable.release(geometry, from);
+
+    //every block moved costs a home load between the nodes
+    int fromNode = from / geometry.framesPerNode;
+    int blocks = (other != NO_PAGE ? 2 : 1) << (geometry.pageBits - geometry.lineBits);
+    clockCount += (long long)blocks * (ACCESS_LATENCIES[LOAD_HOME] + distanceClocks(geometry, LOAD_HOME, nodeIndex, fromNode, -1));
+    stats.migrations++;
+}
+
+//exchanges the memory words, directory entries and sharers of two frames
+void System::swapFrames(int32_t first, int32_t second)
+{
+    Node& a = nodes[first / geometry.framesPerNode];
+    Node& b = nodes[second / geometry.framesPerNode];
+    int wordA = (first % geometry.framesPerNode) << geometry.pageBits;
+    int wordB = (second % geometry.framesPerNode) << geometry.pageBits;
+    int blockA = wordA >> geometry.lineBits;
+    int blockB = wordB >> geometry.lineBits;
+    int blocks = 1 << (geometry.pageBits - geometry.lineBits);
+    swap_ranges(&a.memory[wordA], &a.memory[wordA] + (1 << geometry.pageBits), &b.memory[wordB]);
+    swap_ranges(&a.directory[blockA], &a.directory[blockA] + blocks, &b.directory[blockB]);
+    swap_ranges(a.sharersOf(blockA), a.sharersOf(blockA) + blocks * geometry.sharerWords, b.sharersOf(blockB));
+}
+
+//prints the lowest width bits of value starting at the highest order bit
+static void printBits(ostream& out, uint32_t value, int width)
+{
+    char bits[32];
+    for (int i = 0; i < width; i++)
+        bits[i] = '0' + ((value >> (width - 1 - i)) & 1u);
+    out.write(bits, width);
+}
+
+//printAll displays all the values within the nodes
+// this includes registers, caches, memory, directories
+void System::printAll(ostream& out) const
+{
+    //loop through all nodes
+    for(int i =0; i<geometry.nodes; i++)
+    {
+        out<<"\n----------------------------------------";
+        out<<"\nNode #"<<i<<'\n';
+
+        //loop through the processors
+        for(int j =0 ; j<geometry.cpusPerNode; j++) {
+            out << "\n-- Processor #" << j <<" --"<<'\n';
+            for (int k = 0; k < 2; k++)                //each processor has 2 registers
+            {
+                out << "$s" << k+1 << ": ";
+                printBits(out, nodes[i].reg(j, k), 32);
+                out<<'\n';
+            }
+
+            //MSI, MESI and MOESI also show the state of each line
+            bool lineStates = geometry.protocol != PROTO_DASH;
+            out<<(lineStates ? "Cache #: V : S : Tag  : Data Contents" : "Cache #: V : Tag  : Data Contents")<<'\n';
+            for (int k = 0; k < geometry.cacheLines; k++)   //each processor has cacheLines cache sets
+            {
+                //each cache line has (1 valid bit: tagBits tag field: 32 Data per word)
+                const CacheLine& line = nodes[i].cache(j, k);
+                out << "Cache " << k << ": " << line.valid << " : ";
+                if (lineStates)
+                    out << LINE_STATE_NAMES[line.state] << " : ";
+                printBits(out, line.tag, geometry.tagBits);
+                const uint32_t* data = nodes[i].dataOf(line);
+                for (int w = 0; w < geometry.lineWords; w++)
+                {
+                    out << (w == 0 ? " : " : " ");
+                    printBits(out, data[w], 32);
+                }
+                out<<'\n';
+            }
+        }
+        //rows are labelled with the global address of the page in the frame, "-" for a free frame
+        auto label = [&](int j)
+        {
+            int page = pageTable.pages[(i * geometry.memoryWords + j) >> geometry.pageBits];
+            if (page == NO_PAGE)
+                out<<setw(3)<<left<<"-"<<": ";
+            else
+                out<<setw(3)<<left<<(page << geometry.pageBits | (j & ((1 << geometry.pageBits) - 1)))<<": ";
+        };
+        out<<"\n-- Memory --"<<'\n';
+        for (int j = 0; j < geometry.memoryWords; ++j)
+        {
+
+            label(j);
+            printBits(out, nodes[i].memory[j], 32);
+            out<<'\n';
+        }
+
+        //one entry per block, shown at the address of the block's first word
+        out<<"\n-- Directory --"<<'\n';
+        for (int j = 0; j < geometry.memoryBlocks; j++)
+        {
+            label(j*geometry.lineWords);
+            printBits(out, nodes[i].directory[j].state, 2);
+            const uint64_t* sharers = nodes[i].sharersOf(j);
+            for(int k = 0; k < geometry.nodes; k++)
+            {
+                out<<" : "<<hasSharer(geometry, sharers, k);
+            }
+            out<<'\n';
+        }
+   } //End Node Loop
+}//end printAll
+
+
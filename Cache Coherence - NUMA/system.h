@@ -0,0 +1,262 @@
+/* The simulated cc-NUMA (DASH) machine
+ * A System holds every node of one machine together with its clock count, so any number of independent
+ * .... machines can be simulated in the same process (see batch.h)
+ */
+#ifndef SYSTEM_H
+#define SYSTEM_H
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "geometry.h"
+#include "trace.h"
+#include "stats.h"
+#include "replacement.h"
+#include "directory.h"
+#include "timing.h"
+#include "protocol.h"
+#include "placement.h"
+
+/*
+ * -- Detailed description of a Node --
+ * This is a Node class that's purpose is to simulate a MIPS based SMP Node
+ * The default system contains 4 of these nodes each of which consists of the following components:
+ * 2 scalar processors each with a local cache (4 lines/cache, 1 word/line, 32 bits/word + valid bit + tag field)
+ * .....each processor also has 2 registers (1 words/reg) each
+ * .....(with --line-size a line holds a block of lineWords neighbouring words, the word address / lineWords is the
+ * ..... block address picking the set and tag and the rest is the word offset within the line)
+ * .....Cache is direct-mapped and uses WB when write hit and no-write-allocate when write miss;
+ * .....(--protocol and --write-allocate pick other protocols, see protocol.h)
+ * .....(with --ways the cache is set-associative, block address % sets picks the set and the ways of a set
+ * ..... are neighbouring lines, cache line set * ways + way)
+ *
+ * 1 memory module (16 words),
+ * .....Memory is globally addressed and the total memory size in the system is 64 words (16 words/node);
+ * .....Physical address is 6 bits (2 bits for index, 4 bits for tag),
+ * .....and the memory address is word address and we ignore byte level addressing.
+ * .....(--placement moves the pages of the global address space to other nodes, see placement.h, the memory and
+ * ..... directory of a node then hold the pages in its frames while caches keep using the global address)
+ *
+ *  1 directory (6 bits/entry)
+ * .... Each directory also consists of 16 entries, one for each line (1 word) in the node memory.
+ * .... (one entry per block of lineWords words, a load or store of any word of a block uses the block's entry)
+ * .... The state field holds the status of the respective memory location
+ * ........ 00 - uncached
+ * ........ 01 - shared
+ * ........ 11 - dirty
+ * ........ 10 - owned (MOESI only, see protocol.h)
+ * .... Each entry has a sharer vector, bit i is set when node i has the memory in its cache
+ * .... (or a coarse vector or limited pointers, see directory.h)
+ *
+ * The number of processors, cache lines and memory words come from the Geometry.
+ * Words are stored packed in a uint32_t so copying a value between a register, cache line and memory is a single move.
+ * Each component is a flat array indexed through the accessors below.
+ * The arrays of every node are carved out of one arena allocated by the System (see NodeArena),
+ * .... so building a machine is a single allocation and running instructions never allocates.
+ */
+enum DirState : uint8_t
+{
+    UNCACHED = 0,   // 00
+    SHARED   = 1,   // 01
+    OWNED    = 2,   // 10
+    DIRTY    = 3    // 11
+};
+
+// The data words of a line are kept apart from it in Node::lineData, see Node::dataOf
+struct CacheLine
+{
+    uint32_t tag;   // tag field
+    bool valid;     // valid bit
+    uint8_t state;  // LineState under MSI, MESI and MOESI
+};
+
+struct DirEntry
+{
+    DirState state;
+};
+
+// A fixed length array living in a NodeArena
+template <class T>
+struct Span
+{
+    T* items = nullptr;
+    size_t count = 0;
+
+    T* data() { return items; }
+    const T* data() const { return items; }
+    size_t size() const { return count; }
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+};
+
+// One block of memory holding the arrays of every node, handed out in order by take()
+class NodeArena
+{
+public:
+    // reserves bytes, every array taken has to fit in them including alignment padding
+    void reserve(size_t bytes);
+
+    template <class T>
+    Span<T> take(size_t count)
+    {
+        Span<T> span;
+        span.items = reinterpret_cast<T*>(storage.get() + used);
+        span.count = count;
+        std::uninitialized_value_construct_n(span.items, count);
+        used += padded(count * sizeof(T));
+        return span;
+    }
+
+    // bytes a take() of this size uses, arrays start on 64 byte boundaries
+    static size_t padded(size_t bytes) { return (bytes + 63) / 64 * 64; }
+
+private:
+    std::unique_ptr<unsigned char[]> storage;
+    size_t used = 0;
+};
+
+struct Node{
+public:
+    Span<uint32_t> registers;           // 2 registers (word size each) per processor
+    Span<CacheLine> caches;             // cacheLines lines per processor
+    Span<uint32_t> lineData;            // lineWords words of data per cache line, in the order of caches
+    Span<uint32_t> memory;              // geometry.memoryWords words of memory
+    Span<DirEntry> directory;           // Each block of memory has a directory entry
+    Span<uint64_t> sharers;             // sharerWords words of sharer bits per directory entry
+    Span<uint8_t> ages;                 // replacement age of every cache line, see replacement.h
+    Span<uint32_t> setStates;           // replacement state of every cache set
+    int cacheLines;
+    int ways;
+    int lineWords;
+    int sharerWords;
+
+    uint32_t& reg(int cpu, int r) { return registers[cpu * 2 + r]; }
+    uint32_t reg(int cpu, int r) const { return registers[cpu * 2 + r]; }
+    CacheLine& cache(int cpu, int line) { return caches[cpu * cacheLines + line]; }
+    const CacheLine& cache(int cpu, int line) const { return caches[cpu * cacheLines + line]; }
+    CacheLine* cacheSet(int cpu, int set) { return &caches[cpu * cacheLines + set * ways]; }
+    const CacheLine* cacheSet(int cpu, int set) const { return &caches[cpu * cacheLines + set * ways]; }
+    uint32_t* dataOf(const CacheLine& line) { return &lineData[(&line - caches.data()) * lineWords]; }
+    const uint32_t* dataOf(const CacheLine& line) const { return &lineData[(&line - caches.data()) * lineWords]; }
+    uint8_t* agesOf(int cpu, int set) { return &ages[cpu * cacheLines + set * ways]; }
+    uint32_t& setState(int cpu, int set) { return setStates[cpu * (cacheLines / ways) + set]; }
+    uint64_t* sharersOf(int blockIndex) { return &sharers[blockIndex * sharerWords]; }
+    const uint64_t* sharersOf(int blockIndex) const { return &sharers[blockIndex * sharerWords]; }
+};
+
+//returns true if the cache line holds a valid copy of the block with the given tag
+inline bool isHit(const CacheLine& line, uint32_t tag)
+{
+    return line.valid && line.tag == tag;
+}
+
+//returns the way of the set holding a valid copy of the block with the given tag, or -1
+//every way is compared into a bit mask without branching so the loop vectorizes, a block is in at most one way
+inline int findWay(const CacheLine* set, int ways, uint32_t tag)
+{
+    uint32_t hits = 0;
+    for (int w = 0; w < ways; w++)
+        hits |= uint32_t(set[w].valid & (set[w].tag == tag)) << w;
+    return hits != 0 ? __builtin_ctz(hits) : -1;
+}
+
+//returns a mask with bit w set when way w of the set holds a valid block
+inline uint32_t validWays(const CacheLine* set, int ways)
+{
+    uint32_t valid = 0;
+    for (int w = 0; w < ways; w++)
+        valid |= uint32_t(set[w].valid) << w;
+    return valid;
+}
+
+// Tag for the System constructor that makes a view sharing another system's nodes
+enum ShareNodes { SHARE_NODES };
+
+/*
+ * System is one complete machine: its geometry, its nodes and the clocks spent so far
+ * Instructions are executed in trace order with execute() or by running a whole trace file with runTrace()
+ * A view made with SHARE_NODES works on the nodes of its parent but counts its own clocks and stats,
+ * .... the sharded runner gives each worker thread a view (see shard.h), a view has a copy of the page table
+ * .... so it can only run under a static placement (see PageTable::isStatic)
+ */
+struct System
+{
+public:
+    Geometry geometry;
+    Node* nodes;            // geometry.nodes nodes, owned by nodeStorage and arena or by the parent of a view
+    long long clockCount;
+    long long instructionCount;     // trace records executed so far, where a resumed run continues the trace
+    Stats stats;            // counters for every access, see stats.h
+    std::vector<int>* invalidationLog = nullptr;   // when set, every invalidated copy's line is added
+                                                    // .... as (node * cpusPerNode + cpu) * cacheLines + line
+    std::vector<int>* downgradeLog = nullptr;      // when set, every other processor's line whose MSI/MESI/MOESI
+                                                    // .... state a load changed is added the same way
+    TimingModel* timing = nullptr;      // when set, every access is timed by the event-driven model (see timing.h)
+    PageTable pageTable;    // the frame every page of the global address space lives in, see placement.h
+
+    // initializeSystem, the geometry's derived fields are filled in
+    explicit System(const Geometry& geometry);
+    System(System& parent, ShareNodes);
+    System(const System&) = delete;
+    System& operator=(const System&) = delete;
+
+    // Runs the instructions of an ASCII or compiled trace from instructionCount up to until (-1 for the whole trace)
+    // returns false if the trace could not be opened
+    bool runTrace(const std::string& path, long long until = -1);
+
+    void execute(const TraceRecord& record);
+
+    // Instruction handlers, see the opTable in system.cpp
+    typedef void (System::*OpHandler)(int nodeIndex, int cpuIndex, int memoryAddress, int reg);
+    template <class Protocol>
+    void memoryAccess(int nodeIndex, int cpuIndex, int memoryAddress, int reg);
+    template <class Protocol, bool WriteAllocate>
+    void writeToMem(int nodeIndex, int cpuIndex, int memoryAddress, int reg);
+    void unknownOp(int nodeIndex, int cpuIndex, int memoryAddress, int reg);
+
+    // returns the physical address of a word that nodeIndex accesses, placing its page first if it has none yet
+    int physicalAddress(int memoryAddress, int nodeIndex)
+    {
+        if (pageTable.frames[memoryAddress >> geometry.pageBits] == NO_FRAME)
+            placePage(memoryAddress >> geometry.pageBits, nodeIndex);
+        return pageTable.physical(geometry, memoryAddress);
+    }
+
+    // returns the physical address of a word of a placed page, physical address / memoryWords is its home node
+    int physicalOf(int memoryAddress) const { return pageTable.physical(geometry, memoryAddress); }
+
+    // Writes the contents of every node to out
+    void printAll(std::ostream& out) const;
+
+    // FNV-1a hash of the registers, caches, memory and directories, used to compare final states
+    uint64_t stateHash() const;
+
+private:
+    std::vector<Node> nodeStorage;
+    NodeArena arena;
+    const OpHandler* handlers;      // the handler of every opcode for the geometry's protocol
+
+    template <class Protocol>
+    void writeBack(int nodeIndex, int cpuIndex, int cacheIndex);
+    CacheLine* findInSister(int nodeIndex, int cpuIndex, int set, uint32_t tag);
+    template <class Protocol>
+    CacheLine* findOwner(const uint64_t* sharers, int set, uint32_t tag, int& ownerNode);
+    void copyBlock(uint32_t* to, const uint32_t* from) const;
+    void touch(int nodeIndex, int cpuIndex, int set, int way);
+    int invalidateSharers(const uint64_t* sharers, int set, uint32_t tag, int nodeIndex, int cpuIndex);
+    void charge(AccessCase path, int nodeIndex, int cpuIndex, int memoryAddress, bool remote, int owner = -1);
+    void countInvalidations(int nodeIndex, int cpuIndex, int memoryAddress, int invalidated);
+    void downgrade(int nodeIndex, CacheLine& line, LineState state);
+    void placePage(int page, int nodeIndex);
+    void trackPage(int nodeIndex, int memoryAddress, bool remote);
+    void migratePage(int page, int nodeIndex);
+    void swapFrames(int32_t first, int32_t second);
+};
+
+#endif
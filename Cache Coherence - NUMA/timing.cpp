@@ -0,0 +1,474 @@
+/* Event-driven timing of the cc-NUMA machine, see timing.h
+ * Each access becomes a job holding a short list of phases, one per resource it needs.
+ * The scheduler pops the earliest event, the job's next phase starts once its resource is free
+ * .... (requests are served in the order they arrive) and an event is queued for when the phase ends.
+ * A processor's next access is issued when its previous one has finished.
+ * The model stops as soon as a processor has finished and has nothing queued, and goes on when its next access
+ * .... is recorded. No event is handled in between, so the events are handled in the same order as if every access
+ * .... had been recorded up front.
+ */
+#include "timing.h"
+#include "topology.h"
+#include <algorithm>
+using namespace std;
+
+const char* const RESOURCE_NAMES[RESOURCE_KINDS] = {"bus", "directory", "memory", "link"};
+
+TimingModel::TimingModel(const Geometry& geometry, const TimingParams& params)
+    : geometry(geometry), params(params), window(WINDOW), targets(TARGET_WINDOW)
+{
+    int cpuCount = geometry.nodes * geometry.cpusPerNode;
+    result.completion = 0;
+    result.serialClocks = 0;
+    result.overruns = 0;
+    result.cpus.assign(cpuCount, CpuTiming());
+    result.resources.assign(geometry.nodes * RESOURCE_KINDS + linkCount(geometry), ResourceStats());
+    freeAt.assign(result.resources.size(), 0);
+
+    // every processor starts out stalled at cycle 0 and is first issued once all of them have an access
+    queues.assign(cpuCount, CpuQueue());
+    ready.reserve(cpuCount);
+    resuming.reserve(cpuCount);
+    waiting = cpuCount;
+}
+
+void TimingModel::record(int cpu, AccessCase path, int home, int owner)
+{
+    if (open)
+    {
+        close();
+        run(false);
+    }
+    result.overruns += recorded - oldest == WINDOW;
+    while (recorded - oldest == WINDOW)
+        run(true);
+    TimedAccess& access = window[recorded % WINDOW];
+    access = {uint32_t(cpu), uint8_t(path), false, home, owner, uint32_t(recordedTargets % TARGET_WINDOW), 0, NO_ACCESS};
+    recorded++;
+    open = true;
+}
+
+void TimingModel::addTarget(int node)
+{
+    // the open access cannot be issued yet, the older ones make room as they are
+    result.overruns += recordedTargets - oldestTarget == TARGET_WINDOW;
+    while (recordedTargets - oldestTarget == TARGET_WINDOW)
+        run(true);
+    targets[recordedTargets % TARGET_WINDOW] = node;
+    recordedTargets++;
+    window[(recorded - 1) % WINDOW].targetCount++;
+}
+
+TimingResult TimingModel::finish()
+{
+    if (open)
+        close();
+    open = false;
+    ended = true;
+    waiting = 0;
+    run(false);
+    return result;
+}
+
+//queues the last recorded access for its processor
+void TimingModel::close()
+{
+    uint32_t slot = (recorded - 1) % WINDOW;
+    TimedAccess& access = window[slot];
+    result.serialClocks += latency(access);
+    CpuQueue& queue = queues[access.cpu];
+    if (queue.head == NO_ACCESS)
+    {
+        queue.head = slot;
+        if (queue.stalled)
+        {
+            waiting--;
+            ready.push_back(access.cpu);
+        }
+    }
+    else
+        window[queue.tail].next = slot;
+    queue.tail = slot;
+    open = false;
+}
+
+//frees the slots of the oldest accesses once they have been issued
+void TimingModel::release()
+{
+    while (oldest != recorded && window[oldest % WINDOW].issued)
+    {
+        oldestTarget += window[oldest % WINDOW].targetCount;
+        oldest++;
+    }
+}
+
+//issues the stalled processors that have an access again, in processor order as a full replay would
+//.... without force only once every stalled processor has one, the idle ones are not looked at
+void TimingModel::resumeStalled(bool force)
+{
+    if (ready.empty() || (waiting > 0 && !force))
+        return;
+    swap(ready, resuming);
+    sort(resuming.begin(), resuming.end());
+    for (int cpu : resuming)
+        issue(cpu, queues[cpu].stallTime > now ? queues[cpu].stallTime : now);
+    resuming.clear();
+}
+
+//handles events as far as the queued accesses allow
+//.... force runs on past processors waiting for their next access until the oldest access has been issued
+void TimingModel::run(bool force)
+{
+    uint64_t first = oldest;
+    while (true)
+    {
+        resumeStalled(force);
+        if (force ? oldest != first : waiting > 0)
+            return;
+        if (events.empty())
+            return;
+        Event event = events.top();
+        events.pop();
+        now = event.time;
+        advance(event.job, event.time);
+    }
+}
+
+//the latency charged to the access by System::charge
+int TimingModel::latency(const TimedAccess& access) const
+{
+    return ACCESS_LATENCIES[access.path]
+           + distanceClocks(geometry, AccessCase(access.path), access.cpu / geometry.cpusPerNode, access.home, access.owner);
+}
+
+int TimingModel::newJob(int cpu)
+{
+    int index;
+    if (freeJobs.empty())
+    {
+        index = jobs.size();
+        jobs.emplace_back();
+    }
+    else
+    {
+        index = freeJobs.back();
+        freeJobs.pop_back();
+    }
+    Job& job = jobs[index];
+    job.cpu = cpu;
+    job.phases = 0;
+    job.next = 0;
+    job.flight = 0;
+    job.resource.clear();
+    job.occupancy.clear();
+    return index;
+}
+
+void TimingModel::addPhase(int index, int resource, int occupancy)
+{
+    Job& job = jobs[index];
+    job.resource.push_back(resource);
+    job.occupancy.push_back(occupancy);
+    job.phases++;
+}
+
+void TimingModel::addPhase(int index, int node, ResourceKind kind, int occupancy)
+{
+    addPhase(index, resource(node, kind), occupancy);
+}
+
+//adds the phases of a message between two nodes, nothing if they are the same node
+//.... under TOPO_FLAT the message holds the sender's network link, otherwise every link of its route in turn,
+//.... a fat tree link l levels up is columns^l times as wide and held for that much less of linkOccupancy
+void TimingModel::addMessage(int index, int from, int to)
+{
+    if (from == to)
+        return;
+    if (geometry.topology == TOPO_FLAT)
+    {
+        addPhase(index, from, RESOURCE_LINK, params.linkOccupancy);
+        return;
+    }
+    int first = geometry.nodes * RESOURCE_KINDS;
+    forEachLink(geometry, from, to, [&](int link, int level)
+    {
+        int occupancy = params.linkOccupancy;
+        for (int l = 0; l < level; l++)
+            occupancy /= geometry.columns;
+        addPhase(index, first + link, occupancy > 1 ? occupancy : 1);
+    });
+}
+
+void TimingModel::schedule(int job, long long time)
+{
+    events.push({time, order++, job});
+}
+
+//fills in the phases an access needs on the way from the requester to its data and back
+void TimingModel::buildPhases(int index, const TimedAccess& access)
+{
+    int local = access.cpu / geometry.cpusPerNode;
+    int home = access.home;
+    int owner = access.owner >= 0 ? access.owner : home;
+    switch (access.path)
+    {
+        case LOAD_SISTER_HIT:
+            addPhase(index, local, RESOURCE_BUS, params.busOccupancy);
+            break;
+        case LOAD_HOME:
+        case STORE_MISS:
+            addMessage(index, local, home);
+            addPhase(index, home, RESOURCE_DIRECTORY, params.directoryOccupancy);
+            addPhase(index, home, RESOURCE_MEMORY, params.memoryOccupancy);
+            if (access.path == LOAD_HOME)
+                addMessage(index, home, local);
+            break;
+        case STORE_UPGRADE:
+            // only the directory is asked, the data is already in the cache
+            addMessage(index, local, home);
+            addPhase(index, home, RESOURCE_DIRECTORY, params.directoryOccupancy);
+            addMessage(index, home, local);
+            break;
+        case LOAD_DIRTY_REMOTE:
+            addMessage(index, local, home);
+            addPhase(index, home, RESOURCE_DIRECTORY, params.directoryOccupancy);
+            addMessage(index, home, owner);
+            addPhase(index, owner, RESOURCE_BUS, params.busOccupancy);
+            addMessage(index, owner, local);
+            break;
+    }
+    Job& job = jobs[index];
+    job.flight = latency(access);
+    for (int i = 0; i < job.phases; i++)
+        job.flight -= job.occupancy[i];
+    if (job.flight < 0)
+        job.flight = 0;
+}
+
+//starts the messages an access sends without waiting for them
+void TimingModel::startBackground(const TimedAccess& access, long long time)
+{
+    for (uint32_t i = 0; i < access.targetCount; i++)
+    {
+        int target = targets[(access.firstTarget + i) % TARGET_WINDOW];
+        int job = newJob(-1);
+        addMessage(job, access.home, target);
+        addPhase(job, target, RESOURCE_BUS, params.busOccupancy);
+        schedule(job, time);
+    }
+    // the owner of a dirty block shares it back to home memory
+    if (access.path == LOAD_DIRTY_REMOTE)
+    {
+        int owner = access.owner >= 0 ? access.owner : access.home;
+        int job = newJob(-1);
+        addMessage(job, owner, access.home);
+        addPhase(job, access.home, RESOURCE_MEMORY, params.memoryOccupancy);
+        schedule(job, time);
+    }
+}
+
+//issues the processor's queued accesses from time on, accesses that need no shared resource finish straight away
+//.... once its queue is empty it stalls until the next one is recorded, or is done if the run has ended
+void TimingModel::issue(int cpu, long long time)
+{
+    CpuTiming& timing = result.cpus[cpu];
+    CpuQueue& queue = queues[cpu];
+    queue.stalled = false;
+    while (queue.head != NO_ACCESS)
+    {
+        TimedAccess& access = window[queue.head];
+        queue.head = access.next;
+        access.issued = true;
+        timing.accesses++;
+        startBackground(access, time);
+        int job = newJob(cpu);
+        buildPhases(job, access);
+        release();
+        if (jobs[job].phases > 0)
+        {
+            schedule(job, time);
+            return;
+        }
+        time += jobs[job].flight;
+        freeJobs.push_back(job);
+    }
+    timing.completion = time;
+    if (time > result.completion)
+        result.completion = time;
+    if (!ended)
+    {
+        queue.stalled = true;
+        queue.stallTime = time;
+        waiting++;
+    }
+}
+
+//moves a job on to its next phase once its resource is free, or finishes it
+void TimingModel::advance(int index, long long time)
+{
+    Job& job = jobs[index];
+    if (job.next < job.phases)
+    {
+        int r = job.resource[job.next];
+        long long start = freeAt[r] > time ? freeAt[r] : time;
+        int occupancy = job.occupancy[job.next];
+        freeAt[r] = start + occupancy;
+        result.resources[r].busy += occupancy;
+        result.resources[r].waited += start - time;
+        if (job.cpu >= 0)
+            result.cpus[job.cpu].waited += start - time;
+        job.next++;
+        schedule(index, start + occupancy);
+        return;
+    }
+
+    int cpu = job.cpu;
+    long long done = time + job.flight;
+    freeJobs.push_back(index);
+    if (cpu >= 0)
+        issue(cpu, done);
+}
+
+static void writeResource(ostream& out, const char* name, const ResourceStats& r)
+{
+    out << "\"" << name << "\": {\"busy\": " << r.busy << ", \"waited\": " << r.waited << "}";
+}
+
+//the share of the run a link was busy
+static double utilization(const TimingResult& result, const Geometry& geometry, int link)
+{
+    long long busy = result.resources[geometry.nodes * RESOURCE_KINDS + link].busy;
+    return result.completion > 0 ? double(busy) / result.completion : 0;
+}
+
+/*
+ * Writes every link that exists in the topology with its use, and a heatmap of the utilization
+ * .... under a ring, mesh or torus a link goes from a node to a neighbour and the heatmap has a row of nodes per row
+ * .... of the mesh (one for a ring) holding the utilization of each node's busiest outgoing link
+ * .... under a fat tree a link goes up or down from a subtree at a level and the heatmap has a row per level
+ * .... holding the utilization of the busier link of each subtree
+ */
+static void writeLinks(ostream& out, const TimingResult& result, const Geometry& geometry)
+{
+    int first = geometry.nodes * RESOURCE_KINDS;
+    int links = linkCount(geometry);
+    vector<vector<double>> heatmap;
+    bool firstLink = true;
+    out << "  \"links\": [";
+    if (geometry.topology == TOPO_FAT_TREE)
+    {
+        int link = 0;
+        long long size = 1;
+        for (int level = 0; level < geometry.rows; level++, size *= geometry.columns)
+        {
+            heatmap.emplace_back();
+            for (int subtree = 0; subtree < (geometry.nodes + size - 1) / size; subtree++, link += 2)
+            {
+                for (int down = 0; down < 2; down++)
+                {
+                    const ResourceStats& r = result.resources[first + link + down];
+                    out << (firstLink ? "\n    " : ",\n    ") << "{\"level\": " << level << ", \"subtree\": " << subtree
+                        << ", \"direction\": \"" << (down ? "down" : "up") << "\", \"busy\": " << r.busy
+                        << ", \"waited\": " << r.waited << ", \"utilization\": " << utilization(result, geometry, link + down) << "}";
+                    firstLink = false;
+                }
+                double up = utilization(result, geometry, link), down = utilization(result, geometry, link + 1);
+                heatmap.back().push_back(up > down ? up : down);
+            }
+        }
+    }
+    else
+    {
+        int directions = links / geometry.nodes;
+        int rows = geometry.topology == TOPO_RING ? 1 : geometry.rows;
+        int columns = geometry.nodes / rows;
+        heatmap.assign(rows, vector<double>(columns, 0));
+        for (int link = 0; link < links; link++)
+        {
+            // a mesh has no links off its edges
+            int node = link / directions;
+            int x = node % geometry.columns, y = node / geometry.columns;
+            int direction = link % directions;
+            int to;
+            if (geometry.topology == TOPO_RING)
+                to = (node + (direction == 0 ? 1 : geometry.nodes - 1)) % geometry.nodes;
+            else
+            {
+                int toX = x + (direction == LINK_EAST) - (direction == LINK_WEST);
+                int toY = y + (direction == LINK_SOUTH) - (direction == LINK_NORTH);
+                if (geometry.topology == TOPO_MESH
+                    && (toX < 0 || toX >= geometry.columns || toY < 0 || toY >= geometry.rows))
+                    continue;
+                to = (toY + geometry.rows) % geometry.rows * geometry.columns + (toX + geometry.columns) % geometry.columns;
+            }
+            const ResourceStats& r = result.resources[first + link];
+            double use = utilization(result, geometry, link);
+            out << (firstLink ? "\n    " : ",\n    ") << "{\"from\": " << node << ", \"to\": " << to << ", \"busy\": "
+                << r.busy << ", \"waited\": " << r.waited << ", \"utilization\": " << use << "}";
+            firstLink = false;
+            double& cell = heatmap[node / columns][node % columns];
+            cell = use > cell ? use : cell;
+        }
+    }
+    out << "\n  ],\n";
+
+    out << "  \"heatmap\": [";
+    for (size_t row = 0; row < heatmap.size(); row++)
+    {
+        out << (row ? ",\n    [" : "\n    [");
+        for (size_t i = 0; i < heatmap[row].size(); i++)
+            out << (i ? ", " : "") << heatmap[row][i];
+        out << "]";
+    }
+    out << "\n  ],\n";
+}
+
+void writeTimingJson(ostream& out, const TimingResult& result, const Geometry& geometry)
+{
+    out << "{\n";
+    out << "  \"topology\": \"" << TOPOLOGY_NAMES[geometry.topology] << "\",\n";
+    out << "  \"serial_clocks\": " << result.serialClocks << ",\n";
+    out << "  \"overruns\": " << result.overruns << ",\n";
+    out << "  \"completion\": " << result.completion << ",\n";
+
+    ResourceStats totals[RESOURCE_KINDS] = {};
+    for (size_t i = 0; i < size_t(geometry.nodes * RESOURCE_KINDS); i++)
+    {
+        totals[i % RESOURCE_KINDS].busy += result.resources[i].busy;
+        totals[i % RESOURCE_KINDS].waited += result.resources[i].waited;
+    }
+    out << "  \"resources\": {";
+    for (int k = 0; k < RESOURCE_KINDS; k++)
+    {
+        out << (k ? ", " : "");
+        writeResource(out, RESOURCE_NAMES[k], totals[k]);
+    }
+    out << "},\n";
+
+    out << "  \"nodes\": [";
+    for (int n = 0; n < geometry.nodes; n++)
+    {
+        out << (n ? ",\n    " : "\n    ") << "{\"node\": " << n;
+        for (int k = 0; k < RESOURCE_KINDS; k++)
+        {
+            out << ", ";
+            writeResource(out, RESOURCE_NAMES[k], result.resources[n * RESOURCE_KINDS + k]);
+        }
+        out << "}";
+    }
+    out << "\n  ],\n";
+    if (geometry.topology != TOPO_FLAT)
+        writeLinks(out, result, geometry);
+
+    out << "  \"cpus\": [";
+    for (int n = 0; n < geometry.nodes; n++)
+    {
+        for (int c = 0; c < geometry.cpusPerNode; c++)
+        {
+            const CpuTiming& cpu = result.cpus[n * geometry.cpusPerNode + c];
+            out << (n || c ? ",\n    " : "\n    ") << "{\"node\": " << n << ", \"cpu\": " << c << ", \"accesses\": "
+                << cpu.accesses << ", \"completion\": " << cpu.completion << ", \"waited\": " << cpu.waited << "}";
+        }
+    }
+    out << "\n  ]\n}\n";
+}
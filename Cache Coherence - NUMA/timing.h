@@ -0,0 +1,191 @@
+/* Event-driven timing of the cc-NUMA machine
+ * The functional simulation charges every access a fixed latency and adds them all up in clockCount,
+ * .... as if only one access could be in flight in the whole machine.
+ * With a TimingModel attached, the System also hands it what each access needed: the path it took, its home node,
+ * .... the owner of a dirty block and the nodes it sent invalidations to. The model times those accesses
+ * .... in a discrete-event model where every processor issues its own accesses one after another
+ * .... and accesses of different processors overlap, queueing for the resources they share:
+ * ........ the bus of each node (sister caches and the owner of a dirty block)
+ * ........ the directory port and memory port of each node
+ * ........ the network link of each node, used by every message leaving it
+ * ........ or, under a topology (see topology.h), every link on the route of a message in turn
+ * An access holds each resource it needs in turn for that resource's occupancy, the rest of its fixed latency
+ * .... is flight time that needs no resource. So without contention every access takes its fixed latency,
+ * .... and the processors only finish later than that when they have to wait for each other.
+ * Invalidations are sent in the background, they occupy the links and buses but the store does not wait for them.
+ * Under a topology the report also lists the use of every link and a heatmap of their utilization.
+ *
+ * The model runs alongside the simulation. Each processor's accesses wait in a queue until it issues them,
+ * .... and the model runs as far as the queued accesses allow, stopping when a processor has none left.
+ * The queues share a window of WINDOW accesses (about 3 MB with their invalidation targets) allocated up front,
+ * .... so memory does not grow with the length of the trace.
+ * The window fills whenever the model falls WINDOW accesses behind the trace. A processor may sit idle that long,
+ * .... or some processors wait on a saturated node while the others run out of queued accesses. Either way the trace
+ * .... keeps running ahead of the model. The model then runs on past the processors whose queues are empty, and the
+ * .... next access of each is issued no earlier than the cycle the model has reached by then.
+ * TimingResult::overruns counts the accesses recorded while the window was full. The result is exactly that of
+ * .... timing the whole run at once when it is 0, and slightly different once it is not
+ * .... (a hot spot on one node of a 16 node mesh is, see numa_timing in Regression/regress.cpp).
+ */
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <cstdint>
+#include <ostream>
+#include <queue>
+#include <vector>
+#include "geometry.h"
+#include "stats.h"
+
+// Cycles an access holds each kind of resource
+struct TimingParams
+{
+    int busOccupancy = 10;
+    int directoryOccupancy = 10;
+    int memoryOccupancy = 40;
+    int linkOccupancy = 8;      // per message
+};
+
+// One access as recorded by System::charge, waiting in the window of a TimingModel
+struct TimedAccess
+{
+    uint32_t cpu;               // node * cpusPerNode + cpu
+    uint8_t path;               // AccessCase
+    bool issued;                // the processor has issued it, its slot is free once the older ones are too
+    int32_t home;               // home node of the address
+    int32_t owner;              // node holding the dirty block for LOAD_DIRTY_REMOTE, otherwise -1
+    uint32_t firstTarget;       // the nodes sent invalidations are targetCount targets from this slot of the target ring
+    uint32_t targetCount;
+    uint32_t next;              // slot of the processor's next access, or NO_ACCESS
+};
+
+// Busy cycles and cycles spent waiting for one resource
+struct ResourceStats
+{
+    long long busy;
+    long long waited;
+};
+
+enum ResourceKind { RESOURCE_BUS, RESOURCE_DIRECTORY, RESOURCE_MEMORY, RESOURCE_LINK, RESOURCE_KINDS };
+
+extern const char* const RESOURCE_NAMES[RESOURCE_KINDS];
+
+struct CpuTiming
+{
+    long long accesses;
+    long long completion;       // cycle the processor's last access finished
+    long long waited;           // cycles its accesses spent queueing for resources
+};
+
+struct TimingResult
+{
+    long long completion;       // cycle the last processor finished its last access
+    long long serialClocks;     // the fixed latencies of the same accesses added up, as in clockCount
+    long long overruns;         // accesses recorded while the window was full, see the top of this file
+    std::vector<CpuTiming> cpus;                // indexed by node * cpusPerNode + cpu
+    std::vector<ResourceStats> resources;       // indexed by node * RESOURCE_KINDS + kind, followed by
+                                                // .... the links of the topology (see linkCount in topology.h)
+};
+
+/*
+ * TimingModel times the accesses of a run as the System records them
+ * It only sees the accesses of this run, a run resumed from a checkpoint is timed from the checkpoint on
+ */
+class TimingModel
+{
+public:
+    static const uint32_t WINDOW = 1 << 16;             // accesses waiting to be issued at most
+    static const uint32_t TARGET_WINDOW = WINDOW * 4;   // invalidation targets of those accesses at most,
+                                                        // .... more than the nodes one access can invalidate
+    static const uint32_t NO_ACCESS = 0xFFFFFFFF;
+
+    explicit TimingModel(const Geometry& geometry, const TimingParams& params = TimingParams());
+    TimingModel(const TimingModel&) = delete;
+    TimingModel& operator=(const TimingModel&) = delete;
+
+    // records the next access of the run, the one recorded before it is complete and can be issued
+    void record(int cpu, AccessCase path, int home, int owner);
+
+    // adds a node the last recorded access sent an invalidation to
+    void addTarget(int node);
+
+    // times the accesses still waiting and returns the result, nothing can be recorded afterwards
+    TimingResult finish();
+
+private:
+    // One access of a processor or one background message, working through its phases
+    // .... the phase vectors of finished jobs are reused, so they only grow until the longest route has been seen
+    struct Job
+    {
+        int cpu;                    // the processor waiting for it, -1 for background messages
+        int phases;
+        int next;                   // the phase to start next
+        std::vector<int> resource;  // node * RESOURCE_KINDS + kind, or a topology link after the nodes' resources
+        std::vector<int> occupancy;
+        int flight;                 // cycles after the last phase until the access is done
+    };
+
+    struct Event
+    {
+        long long time;
+        uint64_t order;             // events at the same time are handled in the order they were queued
+        int job;
+
+        bool operator>(const Event& other) const
+        {
+            return time != other.time ? time > other.time : order > other.order;
+        }
+    };
+
+    // The accesses a processor has not issued yet, linked through TimedAccess::next
+    struct CpuQueue
+    {
+        uint32_t head = NO_ACCESS;
+        uint32_t tail = NO_ACCESS;
+        bool stalled = true;        // it has issued everything it had and waits for its next access
+        long long stallTime = 0;    // the cycle its last access finished
+    };
+
+    const Geometry geometry;
+    const TimingParams params;
+    TimingResult result;
+    std::vector<long long> freeAt;          // cycle each resource is next free
+    std::vector<TimedAccess> window;        // ring of WINDOW accesses, slot = sequence number % WINDOW
+    std::vector<int32_t> targets;           // ring of TARGET_WINDOW invalidation targets
+    uint64_t oldest = 0;                    // sequence number of the oldest access in the window
+    uint64_t recorded = 0;                  // sequence number of the next access recorded
+    uint64_t oldestTarget = 0;
+    uint64_t recordedTargets = 0;
+    bool open = false;                      // the last recorded access may still get targets
+    bool ended = false;                     // finish has been called
+    std::vector<CpuQueue> queues;
+    std::vector<int> ready;                 // stalled processors that have an access queued again
+    std::vector<int> resuming;
+    int waiting;                            // stalled processors without a queued access
+    long long now = 0;                      // time of the last event handled
+    std::vector<Job> jobs;
+    std::vector<int> freeJobs;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    uint64_t order = 0;
+
+    int resource(int node, ResourceKind kind) const { return node * RESOURCE_KINDS + kind; }
+    int latency(const TimedAccess& access) const;
+    int newJob(int cpu);
+    void addPhase(int index, int resource, int occupancy);
+    void addPhase(int index, int node, ResourceKind kind, int occupancy);
+    void addMessage(int index, int from, int to);
+    void schedule(int job, long long time);
+    void buildPhases(int index, const TimedAccess& access);
+    void startBackground(const TimedAccess& access, long long time);
+    void issue(int cpu, long long time);
+    void advance(int index, long long time);
+    void close();
+    void release();
+    void resumeStalled(bool force);
+    void run(bool force);
+};
+
+// Writes the completion time of every processor and the use of every resource as JSON
+void writeTimingJson(std::ostream& out, const TimingResult& result, const Geometry& geometry);
+
+#endif
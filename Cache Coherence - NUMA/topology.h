@@ -0,0 +1,207 @@
+/* Interconnect topologies
+ * Under TOPO_FLAT every pair of nodes is one hop apart, which is what the fixed latencies (ACCESS_LATENCIES) assume.
+ * The other topologies route every message over directed links and the message's hops set its cost
+ * .... TOPO_RING      node n links to n + 1 and n - 1, messages go the shorter way round (clockwise on a tie)
+ * .... TOPO_MESH      node n sits in column n % columns of row n / columns and links to its 4 neighbours,
+ * ....                messages go along their row first and then along the column (dimension order routing)
+ * .... TOPO_TORUS     a mesh whose rows and columns wrap around, each dimension goes the shorter way
+ * .... TOPO_FAT_TREE  the nodes are the leaves of a tree with columns children per switch and rows levels,
+ * ....                a message climbs to the lowest switch above both nodes and comes back down,
+ * ....                the links above level l carry the traffic of columns^l nodes and are that many times as wide
+ * The fixed latencies stay those of neighbouring nodes, every hop of a message beyond its first adds hopClocks
+ * .... (see distanceClocks). The timing model also queues the messages for each link they cross (see timing.h).
+ */
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <cstdlib>
+#include "geometry.h"
+#include "stats.h"
+
+// The links leaving each node of a ring and of a mesh or torus, a link is numbered node * directions + direction
+enum LinkDirection { LINK_EAST, LINK_WEST, LINK_SOUTH, LINK_NORTH };
+
+//returns the number of directed links of the topology, some mesh edge links are numbered but never used
+inline int linkCount(const Geometry& geometry)
+{
+    switch (geometry.topology)
+    {
+        case TOPO_RING:
+            return geometry.nodes * 2;
+        case TOPO_MESH:
+        case TOPO_TORUS:
+            return geometry.nodes * 4;
+        case TOPO_FAT_TREE:
+        {
+            // an up and a down link for every subtree below the root, level by level
+            int links = 0;
+            for (long long size = 1, level = 0; level < geometry.rows; size *= geometry.columns, level++)
+                links += int((geometry.nodes + size - 1) / size) * 2;
+            return links;
+        }
+        default:
+            return 0;
+    }
+}
+
+//steps a coordinate towards target along a ring of the given size, the shorter way round, returns the direction
+//.... 0 for increasing and 1 for decreasing
+inline int ringStep(int& position, int target, int size)
+{
+    int forward = ((target - position) % size + size) % size;
+    if (forward <= size - forward)
+    {
+        position = (position + 1) % size;
+        return 0;
+    }
+    position = (position + size - 1) % size;
+    return 1;
+}
+
+/*
+ * Calls visit(link, level) for every link a message from node from to node to crosses, in order
+ * level is the fat tree level of the link and 0 in the other topologies, nothing is visited within a node
+ * .... and under TOPO_FLAT
+ */
+template <class Visit>
+inline void forEachLink(const Geometry& geometry, int from, int to, Visit visit)
+{
+    if (from == to)
+        return;
+    switch (geometry.topology)
+    {
+        case TOPO_RING:
+        {
+            int node = from;
+            while (node != to)
+            {
+                int link = node * 2;
+                visit(link + ringStep(node, to, geometry.nodes), 0);
+            }
+            break;
+        }
+        case TOPO_MESH:
+        case TOPO_TORUS:
+        {
+            int columns = geometry.columns;
+            int x = from % columns, y = from / columns;
+            int toX = to % columns, toY = to / columns;
+            bool wrap = geometry.topology == TOPO_TORUS;
+            while (x != toX)
+            {
+                int link = (y * columns + x) * 4;
+                if (wrap)
+                    visit(link + LINK_EAST + ringStep(x, toX, columns), 0);
+                else
+                {
+                    visit(link + (x < toX ? LINK_EAST : LINK_WEST), 0);
+                    x += x < toX ? 1 : -1;
+                }
+            }
+            while (y != toY)
+            {
+                int link = (y * columns + x) * 4;
+                if (wrap)
+                    visit(link + LINK_SOUTH + ringStep(y, toY, geometry.rows), 0);
+                else
+                {
+                    visit(link + (y < toY ? LINK_SOUTH : LINK_NORTH), 0);
+                    y += y < toY ? 1 : -1;
+                }
+            }
+            break;
+        }
+        case TOPO_FAT_TREE:
+        {
+            // find the lowest level where both nodes are in the same subtree, the links of the levels below it
+            // .... are numbered from first, up links are even and down links odd
+            int top = 0;
+            for (long long size = 1; from / size != to / size; size *= geometry.columns)
+                top++;
+            int first = 0;
+            long long size = 1;
+            for (int level = 0; level < top; level++, size *= geometry.columns)
+            {
+                visit(first + int(from / size) * 2, level);
+                first += int((geometry.nodes + size - 1) / size) * 2;
+            }
+            for (int level = top - 1; level >= 0; level--)
+            {
+                size /= geometry.columns;
+                first -= int((geometry.nodes + size - 1) / size) * 2;
+                visit(first + int(to / size) * 2 + 1, level);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+//returns the number of links a message from node from to node to crosses, 1 between any two nodes under TOPO_FLAT
+inline int hops(const Geometry& geometry, int from, int to)
+{
+    if (from == to)
+        return 0;
+    switch (geometry.topology)
+    {
+        case TOPO_RING:
+        {
+            int forward = ((to - from) % geometry.nodes + geometry.nodes) % geometry.nodes;
+            return forward < geometry.nodes - forward ? forward : geometry.nodes - forward;
+        }
+        case TOPO_MESH:
+        case TOPO_TORUS:
+        {
+            int dx = abs(to % geometry.columns - from % geometry.columns);
+            int dy = abs(to / geometry.columns - from / geometry.columns);
+            if (geometry.topology == TOPO_TORUS)
+            {
+                dx = dx < geometry.columns - dx ? dx : geometry.columns - dx;
+                dy = dy < geometry.rows - dy ? dy : geometry.rows - dy;
+            }
+            return dx + dy;
+        }
+        case TOPO_FAT_TREE:
+        {
+            int top = 0;
+            for (long long size = 1; from / size != to / size; size *= geometry.columns)
+                top++;
+            return top * 2;
+        }
+        default:
+            return 1;
+    }
+}
+
+//returns the clocks an access spends on hops beyond the first of each message it waits for, 0 under TOPO_FLAT
+//.... a load from home sends a request and gets the reply, a write miss only sends the store,
+//.... an upgrade waits for home's grant and a dirty load is forwarded from home to the owner, which replies
+//.... (the same messages as the timing model's phases, see buildPhases in timing.cpp)
+//owner is the node holding a dirty block, -1 if it is not known
+inline int distanceClocks(const Geometry& geometry, AccessCase path, int local, int home, int owner)
+{
+    if (geometry.topology == TOPO_FLAT)
+        return 0;
+    auto extra = [&](int from, int to)
+    {
+        int h = hops(geometry, from, to);
+        return h > 1 ? h - 1 : 0;
+    };
+    switch (path)
+    {
+        case LOAD_HOME:
+        case STORE_UPGRADE:
+            return (extra(local, home) + extra(home, local)) * geometry.hopClocks;
+        case STORE_MISS:
+            return extra(local, home) * geometry.hopClocks;
+        case LOAD_DIRTY_REMOTE:
+            if (owner < 0)
+                owner = home;
+            return (extra(local, home) + extra(home, owner) + extra(owner, local)) * geometry.hopClocks;
+        default:
+            return 0;
+    }
+}
+
+#endif
@@ -0,0 +1,400 @@
+/* Decoding and compiling of instruction traces for the cc-NUMA simulator
+ * See trace.h for the binary trace layout
+ */
+#include "trace.h"
+#include "workload.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+using namespace std;
+
+const char TRACE_MAGIC[8] = {'N','U','M','A','T','R','C','2'};
+
+//converts count characters of '0'/'1' starting at text into an integer
+static int binaryToDecimal(const char* text, int count)
+{
+    int result = 0;
+    for(int i = 0; i<count; i++)
+    {
+        result*=2;
+        if(text[i]=='1')
+            result++;
+    }
+    return result;
+}
+
+/* decodeInstruction takes a machine instruction as input and decodes it in preparation for execution.
+ * This includes separating the parts of the instruction into the correct fields
+ * Decode also converts the parts of the instruction from binary to decimal to allow easier computation
+ * .... In an actual system all arithmetic would be done in binary.
+ * All instructions have the same length and follow this pattern (shown for the default 4 node, 2 cpu system)
+ * .... [N,N,C, :,(space), OP,OP,OP,OP,OP,OP, rs,rs,rs,rs,rs, rt,rt,rt,rt,rt, b,b,b,b,b,b,b,b,b,b,b,b,b,b,b,b]
+ * .... [0,1,2, 3,  4    ,  5, 6, 7, 8, 9,10, 11,12,13,14,15, 16,17,18,19,20, 21,22,23,..............34,35,36]
+ * .... Where N = Node Index
+ * .........  C = CPU Index
+ * .........  OP = Op Code
+ * .........  rs = rs field
+ * .........  rt = rt field
+ * .........  b = Byte Offset
+ * The node field is geometry.nodeBits wide and the cpu field is geometry.cpuBits wide,
+ * .... the rest of the instruction starts two characters after the ':'
+ *
+ * The ALU step of execute is also done here, the word offset is added to the base address
+ * .... so the record holds the memory address that is accessed
+*/
+bool decodeInstruction(string_view line, const Geometry& geometry, TraceRecord& record)
+{
+    int prefix = geometry.nodeBits + geometry.cpuBits;
+    if (line.size() < (size_t)prefix + 34 || line[prefix] != ':')
+        return false;
+    const char* text = line.data();
+
+    //The first nodeBits bits indicate which node number the instruction is for
+    int nodeIndex = binaryToDecimal(text, geometry.nodeBits);
+
+    //The next cpuBits bits indicate what cpu the instruction is for
+    int cpuIndex = binaryToDecimal(text + geometry.nodeBits, geometry.cpuBits);
+
+    //There are two spaces in our input string that need to be ignored. These are at indexes prefix & prefix+1
+    text += prefix + 2;
+
+    // There are 6 bits for the opcode
+    int opCode = binaryToDecimal(text, 6);
+    // The rs field has 5 bits
+    int rs = binaryToDecimal(text + 6, 5);
+    // The rt field has 5 bits
+    int rt = binaryToDecimal(text + 11, 5);
+    //The byte offset is 16 bits long
+    int byteOffset = binaryToDecimal(text + 16, 16);
+
+    // shift right 2 bits to get word offset
+    int wordOffset = byteOffset/4;
+    // each instruction we will be loading to or storing from a register
+    // if the rt field is odd then it is $s1 register
+    // if the rt field is even then it is $s2 register
+    int reg = (rt+1) % 2;
+
+    record.address = rs + wordOffset;
+    record.node = nodeIndex;
+    record.cpu = cpuIndex;
+    record.op = opCode | (reg << 7);
+    return true;
+}
+
+long long compileTrace(const string& inPath, const string& outPath, const Geometry& geometry)
+{
+    TraceStream in(geometry);
+    if (!in.open(inPath))
+        return -1;
+    ofstream out(outPath, ios::binary);
+    if (!out)
+    {
+        cerr << "Could not open " << outPath << endl;
+        return -1;
+    }
+
+    //the header is written again once the record count is known
+    TraceHeader header = {};
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.recordSize = sizeof(TraceRecord);
+    header.nodes = geometry.nodes;
+    header.cpusPerNode = geometry.cpusPerNode;
+    header.memoryWords = geometry.memoryWords;
+    out.write((const char*)&header, sizeof(header));
+
+    const TraceRecord* records;
+    size_t count;
+    while ((count = in.next(records)) > 0)
+    {
+        out.write((const char*)records, count * sizeof(TraceRecord));
+        header.count += count;
+    }
+
+    out.seekp(0);
+    out.write((const char*)&header, sizeof(header));
+    return in.failed() ? -1 : header.count;
+}
+
+bool isCompiledTrace(const string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    char magic[8];
+    bool compiled = read(fd, magic, sizeof(magic)) == sizeof(magic) && memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0;
+    close(fd);
+    return compiled;
+}
+
+MappedTrace::~MappedTrace()
+{
+    if (mapping != nullptr)
+        munmap(mapping, mappingSize);
+}
+
+bool MappedTrace::open(const string& path, const Geometry& geometry)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        cerr << "Could not open " << path << endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TraceHeader))
+    {
+        cerr << path << " is too small to be a compiled trace" << endl;
+        close(fd);
+        return false;
+    }
+    mappingSize = info.st_size;
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        cerr << "Could not map " << path << endl;
+        return false;
+    }
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+
+    const TraceHeader* header = (const TraceHeader*)mapping;
+    if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 || header->recordSize != sizeof(TraceRecord)
+        || header->count > (mappingSize - sizeof(TraceHeader)) / sizeof(TraceRecord))
+    {
+        cerr << path << " is not a valid compiled trace" << endl;
+        return false;
+    }
+    if (!compiledFor(*header, geometry))
+    {
+        cerr << path << " was compiled for " << header->nodes << " nodes, " << header->cpusPerNode << " cpus/node and "
+             << header->memoryWords << " words/node, not this geometry" << endl;
+        return false;
+    }
+    recordStart = (const TraceRecord*)((const char*)mapping + sizeof(TraceHeader));
+    count = header->count;
+    return true;
+}
+
+TraceStream::TraceStream(const Geometry& geometry) : geometry(geometry)
+{
+}
+
+TraceStream::~TraceStream()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    if (reader.joinable())
+        reader.join();
+    if (input != nullptr)
+        gzclose((gzFile)input);
+}
+
+bool TraceStream::open(const string& path)
+{
+    if (isWorkload(path))
+    {
+        WorkloadSpec spec;
+        if (!parseWorkload(path.substr(sizeof(WORKLOAD_PREFIX) - 1), spec))
+            return false;
+        const char* error = workloadError(spec, geometry);
+        if (error != nullptr)
+        {
+            cerr << error << endl;
+            return false;
+        }
+        workload.reset(new WorkloadGenerator(spec, geometry));
+        for (int i = 0; i < BLOCK_COUNT; i++)
+            blocks[i].reserve(BLOCK_RECORDS);
+        reader = thread(&TraceStream::generateAll, this);
+        return true;
+    }
+
+    gzFile file = path == "-" ? gzdopen(dup(STDIN_FILENO), "rb") : gzopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        cerr << "Could not open " << path << endl;
+        return false;
+    }
+    gzbuffer(file, 1 << 20);
+    input = file;
+    for (int i = 0; i < BLOCK_COUNT; i++)
+        blocks[i].reserve(BLOCK_RECORDS);
+    reader = thread(&TraceStream::readAll, this);
+    return true;
+}
+
+size_t TraceStream::next(const TraceRecord*& records)
+{
+    unique_lock<mutex> guard(lock);
+    if (holding)
+    {
+        released++;
+        holding = false;
+        changed.notify_all();
+    }
+    changed.wait(guard, [this] { return produced > released || finished; });
+    if (produced == released)
+        return 0;
+    holding = true;
+    const vector<TraceRecord>& block = blocks[released % BLOCK_COUNT];
+    records = block.data();
+    return block.size();
+}
+
+bool TraceStream::failed()
+{
+    lock_guard<mutex> guard(lock);
+    return error;
+}
+
+//waits for a block the consumer is done with, returns nullptr if the consumer has gone away
+vector<TraceRecord>* TraceStream::freeBlock()
+{
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard, [this] { return produced - released < (size_t)BLOCK_COUNT || stopping; });
+    if (stopping)
+        return nullptr;
+    vector<TraceRecord>* block = &blocks[produced % BLOCK_COUNT];
+    block->clear();
+    return block;
+}
+
+//hands the block being filled to the consumer, returns false if the consumer has gone away
+bool TraceStream::publish()
+{
+    lock_guard<mutex> guard(lock);
+    produced++;
+    changed.notify_all();
+    return !stopping;
+}
+
+/*
+ * readAll runs on the reader thread, it reads the input in large chunks and fills blocks of records
+ * ASCII lines and compiled records can both be split across chunks, the unfinished part is carried over
+ */
+void TraceStream::readAll()
+{
+    gzFile file = (gzFile)input;
+    vector<char> buffer(1 << 20);
+    size_t carried = 0;         // bytes of an unfinished line or record at the front of the buffer
+    bool compiled = false;
+    bool first = true;
+    vector<TraceRecord>* block = freeBlock();
+
+    while (block != nullptr)
+    {
+        int got = gzread(file, buffer.data() + carried, buffer.size() - carried);
+        if (got < 0)
+        {
+            int code;
+            cerr << "Error reading trace: " << gzerror(file, &code) << endl;
+            lock_guard<mutex> guard(lock);
+            error = true;
+            break;
+        }
+        size_t size = carried + got;
+        size_t start = 0;
+        if (first)
+        {
+            // gzread fills the buffer unless the input ends, so the header is always in the first chunk
+            compiled = size >= sizeof(TraceHeader) && memcmp(buffer.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0;
+            if (compiled)
+                start = sizeof(TraceHeader);
+            first = false;
+            TraceHeader header = {};
+            if (compiled)
+                memcpy(&header, buffer.data(), sizeof(header));
+            if (compiled && !compiledFor(header, geometry))
+            {
+                cerr << "The trace was compiled for " << header.nodes << " nodes, " << header.cpusPerNode
+                     << " cpus/node and " << header.memoryWords << " words/node, not this geometry" << endl;
+                lock_guard<mutex> guard(lock);
+                error = true;
+                break;
+            }
+        }
+
+        if (compiled)
+        {
+            // whole records are copied straight into blocks
+            while (start + sizeof(TraceRecord) <= size && block != nullptr)
+            {
+                size_t room = BLOCK_RECORDS - block->size();
+                size_t available = (size - start) / sizeof(TraceRecord);
+                size_t take = available < room ? available : room;
+                const TraceRecord* from = (const TraceRecord*)(buffer.data() + start);
+                block->insert(block->end(), from, from + take);
+                start += take * sizeof(TraceRecord);
+                if (block->size() == BLOCK_RECORDS)
+                    block = publish() ? freeBlock() : nullptr;
+            }
+        }
+        else
+        {
+            // decode every complete line, the last line of the input does not need a newline
+            while (start < size && block != nullptr)
+            {
+                const char* line = buffer.data() + start;
+                const char* end = (const char*)memchr(line, '\n', size - start);
+                if (end == nullptr && got > 0)
+                    break;
+                size_t length = end != nullptr ? end - line : size - start;
+                start += length + 1;
+                if (length > 0 && line[length - 1] == '\r')
+                    length--;
+                if (length == 0)
+                    continue;
+
+                TraceRecord record;
+                if (decodeInstruction(string_view(line, length), geometry, record))
+                    block->push_back(record);
+                else
+                    cerr << "Skipping malformed instruction: " << string_view(line, length) << endl;
+                if (block->size() == BLOCK_RECORDS)
+                    block = publish() ? freeBlock() : nullptr;
+            }
+        }
+
+        if (got == 0 || block == nullptr)
+            break;
+        carried = start < size ? size - start : 0;
+        memmove(buffer.data(), buffer.data() + start, carried);
+        if (carried == buffer.size())
+        {
+            cerr << "Skipping an instruction longer than " << buffer.size() << " characters" << endl;
+            carried = 0;
+        }
+    }
+
+    if (block != nullptr && !block->empty())
+        publish();
+    lock_guard<mutex> guard(lock);
+    finished = true;
+    changed.notify_all();
+}
+
+//generateAll runs on the reader thread instead of readAll when the input is a workload, it fills whole blocks
+void TraceStream::generateAll()
+{
+    vector<TraceRecord>* block = freeBlock();
+    while (block != nullptr)
+    {
+        block->resize(BLOCK_RECORDS);
+        block->resize(workload->generate(block->data(), BLOCK_RECORDS));
+        if (block->empty())
+            break;
+        block = publish() ? freeBlock() : nullptr;
+    }
+    lock_guard<mutex> guard(lock);
+    finished = true;
+    changed.notify_all();
+}
@@ -0,0 +1,194 @@
+/* Instruction traces for the cc-NUMA simulator
+ * A trace is either the ASCII machine code format (see decodeInstruction) or a compiled binary trace.
+ * A compiled trace is the ASCII trace decoded once ahead of time and written as a TraceHeader
+ * .... followed by one fixed size TraceRecord per instruction, so a replay does no string work at all.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "geometry.h"
+
+// The opcodes the simulator executes, the value is the 6 bit MIPS opcode field
+enum OpCode : uint8_t
+{
+    OP_LW = 0x23,   // 100011 load word
+    OP_SW = 0x2B,   // 101011 store word
+    OPCODE_COUNT = 64
+};
+
+// A decoded load/store instruction with the effective word address already computed
+struct TraceRecord
+{
+    uint32_t address;   // word address
+    uint16_t node;      // node index
+    uint8_t cpu;        // cpu index within the node
+    uint8_t op;         // 6 bit opcode in bits 0-5, bit 7 is set when the register is $s2
+};
+
+inline OpCode opcodeOf(const TraceRecord& record) { return OpCode(record.op & 0x3F); }
+inline int registerOf(const TraceRecord& record) { return record.op >> 7; }
+
+// The first bytes of a compiled trace file
+// .... the records hold node, cpu and address as decoded under the geometry the trace was compiled with,
+// .... so a compiled trace only replays under the same nodes, cpus per node and memory per node
+struct TraceHeader
+{
+    char magic[8];          // "NUMATRC2"
+    uint32_t recordSize;    // sizeof(TraceRecord), guards against reading a trace from a different build
+    uint32_t nodes;         // the geometry the trace was compiled under
+    uint32_t cpusPerNode;
+    uint32_t memoryWords;
+    uint64_t count;         // number of records that follow
+};
+
+extern const char TRACE_MAGIC[8];
+
+// Returns true if a trace with this header was compiled under the node, cpu and memory sizes of the geometry
+inline bool compiledFor(const TraceHeader& header, const Geometry& geometry)
+{
+    return header.nodes == (uint32_t)geometry.nodes && header.cpusPerNode == (uint32_t)geometry.cpusPerNode
+           && header.memoryWords == (uint32_t)geometry.memoryWords;
+}
+
+// Decodes one line of ASCII machine code into a record, returns false if the line is malformed
+// .... line is only read in place, decoding never allocates
+bool decodeInstruction(std::string_view line, const Geometry& geometry, TraceRecord& record);
+
+// Decodes every instruction of the trace at inPath and writes them to outPath as a compiled trace
+// .... the input is read with a TraceStream so it may be "-" for stdin or gzip compressed
+// returns the number of records written or -1 if a file could not be opened or read
+long long compileTrace(const std::string& inPath, const std::string& outPath, const Geometry& geometry);
+
+// Returns true if the file at path starts with the compiled trace magic
+bool isCompiledTrace(const std::string& path);
+
+/*
+ * MappedTrace memory maps a compiled trace so the records can be read in place
+ * The mapping is released when the object is destroyed
+ */
+class MappedTrace
+{
+public:
+    MappedTrace() = default;
+    ~MappedTrace();
+    MappedTrace(const MappedTrace&) = delete;
+    MappedTrace& operator=(const MappedTrace&) = delete;
+
+    // maps the file, returns false with a message on cerr if it is not a valid compiled trace
+    // .... or was compiled under a different geometry
+    bool open(const std::string& path, const Geometry& geometry);
+
+    const TraceRecord* records() const { return recordStart; }
+    size_t size() const { return count; }
+
+private:
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    const TraceRecord* recordStart = nullptr;
+    size_t count = 0;
+};
+
+class WorkloadGenerator;
+
+/*
+ * TraceStream reads a trace of any kind on a separate thread and hands it over in blocks of decoded records
+ * The input is a file or "-" for stdin, and may be gzip compressed (zlib detects this itself),
+ * .... holding either ASCII machine code or a compiled trace.
+ * A path starting with "workload:" is a workload spec instead, the thread generates its instructions (see workload.h)
+ * The reader thread decodes ahead into a ring of BLOCK_COUNT blocks while the simulation works on the oldest one,
+ * .... so reading overlaps simulating and memory use does not depend on the length of the trace.
+ */
+class TraceStream
+{
+public:
+    static const size_t BLOCK_RECORDS = 16384;
+    static const int BLOCK_COUNT = 4;
+
+    explicit TraceStream(const Geometry& geometry);
+    ~TraceStream();
+    TraceStream(const TraceStream&) = delete;
+    TraceStream& operator=(const TraceStream&) = delete;
+
+    // opens the input and starts the reader thread, returns false with a message on cerr if it cannot be opened
+    bool open(const std::string& path);
+
+    // hands the previous block back to the reader and points records at the next one
+    // returns the number of records in it, 0 once the whole trace has been read
+    size_t next(const TraceRecord*& records);
+
+    // true once the reader has stopped on an error, the records handed out before it are still valid
+    bool failed();
+
+private:
+    const Geometry geometry;
+    void* input = nullptr;      // gzFile
+    std::unique_ptr<WorkloadGenerator> workload;
+    std::thread reader;
+
+    std::mutex lock;
+    std::condition_variable changed;
+    std::vector<TraceRecord> blocks[BLOCK_COUNT];
+    size_t produced = 0;        // blocks filled by the reader
+    size_t released = 0;        // blocks handed back by the consumer
+    bool holding = false;       // the consumer is working on block released % BLOCK_COUNT
+    bool finished = false;      // the reader has reached the end of the input
+    bool stopping = false;      // the consumer is gone, the reader should stop
+    bool error = false;         // the input could not be read or was compiled under another geometry
+
+    void readAll();
+    void generateAll();
+    std::vector<TraceRecord>* freeBlock();
+    bool publish();
+};
+
+/*
+ * forEachRecord calls visit with every instruction of the trace at path, in trace order
+ * An uncompressed compiled trace file is read directly from its mapped records
+ * .... anything else (ASCII, compressed, stdin or a workload) is read through a TraceStream, malformed lines are skipped
+ * Only the records numbered first up to (not including) last are visited, a negative last means to the end
+ * .... skipping is free for a mapped trace, a stream still has to read and decode the skipped records
+ * Returns false if the trace could not be opened or read
+ */
+template <class Visit>
+bool forEachRecord(const std::string& path, const Geometry& geometry, Visit visit, long long first = 0, long long last = -1)
+{
+    if (path != "-" && isCompiledTrace(path))
+    {
+        MappedTrace trace;
+        if (!trace.open(path, geometry))
+            return false;
+        const TraceRecord* records = trace.records();
+        size_t end = last >= 0 && (size_t)last < trace.size() ? last : trace.size();
+        for (size_t i = first; i < end; i++)
+            visit(records[i]);
+        return true;
+    }
+
+    TraceStream stream(geometry);
+    if (!stream.open(path))
+        return false;
+    const TraceRecord* records;
+    size_t count;
+    long long index = 0;
+    while ((last < 0 || index < last) && (count = stream.next(records)) > 0)
+    {
+        for (size_t i = 0; i < count && (last < 0 || index < last); i++, index++)
+        {
+            if (index >= first)
+                visit(records[i]);
+        }
+    }
+    return !stream.failed();
+}
+
+#endif
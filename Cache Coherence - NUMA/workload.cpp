@@ -0,0 +1,224 @@
+/* Synthetic workloads for the cc-NUMA simulator, see workload.h
+ * The random numbers come from splitmix64 rather than <random> so a spec generates the same instructions
+ * .... with every compiler and standard library.
+ */
+#include "workload.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+using namespace std;
+
+const char* const WORKLOAD_NAMES[WORKLOAD_COUNT] = {
+    "producer-consumer", "migratory", "read-mostly", "false-sharing", "uniform", "hot-spot"
+};
+
+// The percent of stores of each pattern when the spec does not give writes, producer-consumer and migratory
+// .... decide for themselves which accesses are stores
+static const int DEFAULT_WRITES[WORKLOAD_COUNT] = {0, 0, 5, 50, 30, 30};
+
+// The integer parameters a spec can set
+static const struct
+{
+    const char* name;
+    int WorkloadSpec::*field;
+} PARAMETERS[] = {
+    {"base", &WorkloadSpec::base},
+    {"words", &WorkloadSpec::words},
+    {"writes", &WorkloadSpec::writes},
+    {"hot", &WorkloadSpec::hot},
+    {"hot-words", &WorkloadSpec::hotWords},
+    {"buffer", &WorkloadSpec::buffer},
+    {"consumers", &WorkloadSpec::consumers},
+    {"objects", &WorkloadSpec::objects},
+    {"burst", &WorkloadSpec::burst},
+    {"stride", &WorkloadSpec::stride},
+};
+
+bool parseWorkload(const string& text, WorkloadSpec& spec)
+{
+    istringstream parts(text);
+    string part;
+    getline(parts, part, ',');
+    int pattern = 0;
+    while (pattern < WORKLOAD_COUNT && part != WORKLOAD_NAMES[pattern])
+        pattern++;
+    if (pattern == WORKLOAD_COUNT)
+    {
+        cerr << "Unknown workload pattern " << part << ", use";
+        for (int i = 0; i < WORKLOAD_COUNT; i++)
+            cerr << (i ? ", " : " ") << WORKLOAD_NAMES[i];
+        cerr << endl;
+        return false;
+    }
+    spec.pattern = WorkloadPattern(pattern);
+
+    while (getline(parts, part, ','))
+    {
+        size_t equals = part.find('=');
+        string key = part.substr(0, equals);
+        const char* value = equals == string::npos ? "" : part.c_str() + equals + 1;
+        char* end;
+        errno = 0;
+        long long number = strtoll(value, &end, 10);
+        if (equals == string::npos || *value == '\0' || *end != '\0' || errno == ERANGE)
+        {
+            cerr << "Workload parameter " << part << " is not key=number" << endl;
+            return false;
+        }
+        if (key == "count")
+        {
+            spec.count = number;
+            continue;
+        }
+        if (key == "seed")
+        {
+            spec.seed = number;
+            continue;
+        }
+        bool found = false;
+        for (const auto& parameter : PARAMETERS)
+        {
+            if (key == parameter.name)
+            {
+                if (number < INT_MIN || number > INT_MAX)
+                {
+                    cerr << "Workload parameter " << part << " does not fit in an int" << endl;
+                    return false;
+                }
+                spec.*parameter.field = int(number);
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            cerr << "Unknown workload parameter " << key << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* workloadError(const WorkloadSpec& spec, const Geometry& geometry)
+{
+    Geometry g = geometry;
+    deriveGeometry(g);
+    int processors = g.nodes * g.cpusPerNode;
+    if (spec.count < 0)
+        return "The workload count can not be negative";
+    if (spec.base < 0 || spec.base >= g.totalWords || spec.words < 0 || spec.words > g.totalWords - spec.base)
+        return "The workload region has to lie inside the machine's memory";
+    int region = spec.words > 0 ? spec.words : g.totalWords - spec.base;
+    if (spec.writes < -1 || spec.writes > 100 || spec.hot < 0 || spec.hot > 100)
+        return "The workload writes and hot percentages have to be between 0 and 100";
+    switch (spec.pattern)
+    {
+        case WORK_PRODUCER_CONSUMER:
+            if (spec.buffer < 1 || spec.buffer > region)
+                return "The producer-consumer buffer has to fit in the workload region";
+            if (spec.consumers < 1 || spec.consumers >= processors)
+                return "A producer-consumer workload needs between 1 and processors - 1 consumers";
+            break;
+        case WORK_MIGRATORY:
+            if (spec.objects < 1 || spec.objects > region || spec.burst < 1)
+                return "A migratory workload needs between 1 and region words objects and a burst of at least 1";
+            break;
+        case WORK_FALSE_SHARING:
+            if (spec.stride < 1 || (long long)(processors - 1) * spec.stride >= region)
+                return "The word of every processor has to fit in the false-sharing region";
+            break;
+        case WORK_HOT_SPOT:
+            if (spec.hotWords < 1 || spec.hotWords > region)
+                return "The hot-spot words have to fit in the workload region";
+            break;
+        default:
+            break;
+    }
+    return nullptr;
+}
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadSpec& spec, const Geometry& geometry)
+    : spec(spec), geometry(geometry)
+{
+    deriveGeometry(this->geometry);
+    processors = this->geometry.nodes * this->geometry.cpusPerNode;
+    region = spec.words > 0 ? spec.words : this->geometry.totalWords - spec.base;
+    writes = spec.writes >= 0 ? spec.writes : DEFAULT_WRITES[spec.pattern];
+    random = uint64_t(spec.seed);
+}
+
+uint64_t WorkloadGenerator::nextRandom()
+{
+    uint64_t z = (random += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+//an access of the processor to the word of the region, into a random register
+TraceRecord WorkloadGenerator::access(int processor, int word, bool store)
+{
+    TraceRecord record;
+    record.address = uint32_t(spec.base + word);
+    record.node = uint16_t(processor / geometry.cpusPerNode);
+    record.cpu = uint8_t(processor % geometry.cpusPerNode);
+    record.op = uint8_t((store ? OP_SW : OP_LW) | (nextRandom() & 1) << 7);
+    return record;
+}
+
+TraceRecord WorkloadGenerator::nextRecord()
+{
+    switch (spec.pattern)
+    {
+        case WORK_PRODUCER_CONSUMER:
+        {
+            // a round is the producer storing the buffer followed by every consumer loading it
+            int role = int(position / spec.buffer);
+            int word = int(position % spec.buffer);
+            position = (position + 1) % ((long long)spec.buffer * (spec.consumers + 1));
+            int processor = int((long long)role * processors / (spec.consumers + 1));
+            return access(processor, word, role == 0);
+        }
+        case WORK_MIGRATORY:
+        {
+            // a visit is burst loads each followed by a store of the same object
+            if (position == 0)
+            {
+                object = below(spec.objects);
+                visitor = below(processors);
+            }
+            bool store = position % 2 == 1;
+            position = (position + 1) % (2ll * spec.burst);
+            return access(visitor, object * (region / spec.objects), store);
+        }
+        case WORK_FALSE_SHARING:
+        {
+            int processor = below(processors);
+            return access(processor, processor * spec.stride, below(100) < writes);
+        }
+        case WORK_HOT_SPOT:
+        {
+            int processor = below(processors);
+            int word = below(100) < spec.hot ? below(spec.hotWords) : below(region);
+            return access(processor, word, below(100) < writes);
+        }
+        default:
+        {
+            // read-mostly and uniform only differ in how many of the accesses are stores
+            int processor = below(processors);
+            return access(processor, below(region), below(100) < writes);
+        }
+    }
+}
+
+size_t WorkloadGenerator::generate(TraceRecord* records, size_t max)
+{
+    size_t count = 0;
+    while (count < max && generated < spec.count)
+    {
+        records[count++] = nextRecord();
+        generated++;
+    }
+    return count;
+}
@@ -0,0 +1,104 @@
+/* Synthetic workloads for the cc-NUMA simulator
+ * A workload generates decoded instructions for a common sharing pattern straight into memory,
+ * .... so a stress run needs no trace file and no decoding at all.
+ * Anywhere a trace path is accepted a workload can be given instead as "workload:" followed by its spec
+ * .... (see TraceStream in trace.h), so it works with --shards, --events, --timing, checkpoints, batch files
+ * .... and --compile, which writes the generated instructions out as a compiled trace.
+ *
+ * A spec is the pattern name followed by comma separated key=value parameters, for example
+ * ....     migratory,count=1000000,seed=7,objects=8
+ * The same spec on the same geometry always generates the same instructions.
+ */
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "geometry.h"
+#include "trace.h"
+
+/*
+ * The sharing patterns, processors are numbered node * cpusPerNode + cpu
+ * ........ producer-consumer: processor 0 stores a buffer of words, then each consumer loads all of it, round after round
+ * ........ migratory: a random processor does read-modify-writes of a random object, which then moves to the next one
+ * ........ read-mostly: random processors load random words of the region and only rarely store
+ * ........ false-sharing: every processor works on its own word, the words of neighbouring processors stride apart
+ * ........ uniform: random processors access random words of the region
+ * ........ hot-spot: most accesses go to a few hot words at the start of the region, the rest are uniform
+ * With one word per cache line false-sharing shares no line, with longer lines (--line-size) neighbouring processors
+ * .... share a line whenever stride is less than the words of a line, so comparing line sizes shows the cost of false sharing.
+ */
+enum WorkloadPattern
+{
+    WORK_PRODUCER_CONSUMER,
+    WORK_MIGRATORY,
+    WORK_READ_MOSTLY,
+    WORK_FALSE_SHARING,
+    WORK_UNIFORM,
+    WORK_HOT_SPOT,
+    WORKLOAD_COUNT
+};
+
+extern const char* const WORKLOAD_NAMES[WORKLOAD_COUNT];
+
+// The prefix that marks a trace path as a workload spec
+static const char WORKLOAD_PREFIX[] = "workload:";
+
+inline bool isWorkload(const std::string& path) { return path.compare(0, sizeof(WORKLOAD_PREFIX) - 1, WORKLOAD_PREFIX) == 0; }
+
+// A parsed workload spec, the parameters a pattern does not use are ignored
+struct WorkloadSpec
+{
+    WorkloadPattern pattern = WORK_UNIFORM;
+    long long count = 1000000;  // instructions generated
+    long long seed = 1;
+    int base = 0;               // first word of the region the pattern uses
+    int words = 0;              // words in the region, 0 is all the memory from base on
+    int writes = -1;            // percent of the accesses that are stores, -1 for the pattern's default
+    int hot = 80;               // hot-spot: percent of the accesses that go to the hot words
+    int hotWords = 4;           // hot-spot: the first hotWords words of the region are hot
+    int buffer = 16;            // producer-consumer: words stored and loaded each round
+    int consumers = 1;          // producer-consumer: processors loading the buffer, spread over the nodes
+    int objects = 4;            // migratory: objects moving between processors, spread over the region
+    int burst = 1;              // migratory: read-modify-writes of each visit
+    int stride = 1;             // false-sharing: words between the words of neighbouring processors
+};
+
+// Parses a spec without the prefix, returns false with a message on cerr if it is malformed
+bool parseWorkload(const std::string& text, WorkloadSpec& spec);
+
+// Returns why the spec does not fit the geometry, or nullptr if it can be generated
+const char* workloadError(const WorkloadSpec& spec, const Geometry& geometry);
+
+/*
+ * WorkloadGenerator generates the instructions of one spec in order, a block at a time
+ * The spec must have passed workloadError for the geometry
+ */
+class WorkloadGenerator
+{
+public:
+    WorkloadGenerator(const WorkloadSpec& spec, const Geometry& geometry);
+
+    // fills records with up to max instructions, returns how many, 0 once all count have been generated
+    size_t generate(TraceRecord* records, size_t max);
+
+private:
+    WorkloadSpec spec;
+    Geometry geometry;
+    int processors;
+    int region;                 // words in the region
+    int writes;                 // percent of the accesses that are stores
+    uint64_t random;            // splitmix64 state
+    long long generated = 0;
+    long long position = 0;     // step within the current producer-consumer round or migratory visit
+    int object = 0;             // migratory: the object being visited and the processor visiting it
+    int visitor = 0;
+
+    uint64_t nextRandom();
+    int below(int limit) { return int(nextRandom() % uint64_t(limit)); }
+    TraceRecord access(int processor, int word, bool store);
+    TraceRecord nextRecord();
+};
+
+#endif
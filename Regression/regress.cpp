@@ -0,0 +1,530 @@
+/* Benchmark and regression driver for both simulators
+ * Runs a fixed set of canned workloads and, for each one, measures its throughput, the latency percentiles of
+ * .... its blocks and the peak RSS, and compares a digest of its final state with the golden file of the workload.
+ * The workloads are
+ * .... numa_sample          the shipped 8 instruction machine_code.txt on the original 4 node machine, run on a fresh
+ * ........................ machine SAMPLE_RUNS times. Its digest is the whole text dump followed by the clock count,
+ * ........................ the same text XanderIsCool prints for it
+ * .... numa_scaled_<proto>  the same 8 instructions repeated to SCALED_INSTRUCTIONS under each coherence protocol,
+ * ........................ the digest is the clock count, the remote access ratio and System::stateHash
+ * .... numa_allocations     a generated workload replayed once through its compiled trace and once straight from
+ * ........................ the generator, counting heap allocations (allocations.h) after the reader's ring of
+ * ........................ blocks has filled. Any allocation fails the run, its digest is both counts and the clocks
+ * .... numa_timing          a hot spot on one node of a 16 node mesh timed by the event-driven model (timing.h), once
+ * ........................ short enough to stay within its window and once long enough to overrun it. The digest is
+ * ........................ the completion, the overruns and the total busy and waiting cycles of each kind of resource
+ * .... booths_<engine>      random 16 bit operand pairs (sweepOperand) on each Booth's engine, the digest is an
+ * ........................ FNV-1a hash of the products and how many differ from native multiplication
+ * Everything runs on one thread so the numbers only move when the code does.
+ *
+ * Build and run (see CMakeLists.txt at the top of the repository, ctest runs it against the golden files)
+ *      $> cmake -S . -B build && cmake --build build -j
+ *      $> ./build/regress --out regress.json --baseline last.json
+ * .... --golden DIR     the golden files, one <workload>.txt per workload (the repository's Regression/golden)
+ * .... --trace FILE     the 8 instruction trace (the repository's machine_code.txt)
+ * .... --update-golden  writes the digests of this run as the new golden files instead of comparing them
+ * .... --scale K        multiplies the size of every workload by K, the golden files only hold for K = 1
+ * .... --baseline FILE  a report of an earlier run, a workload whose throughput fell by more than --tolerance
+ * ........................ percent (default 10) below it is reported as slower
+ * .... --out FILE       writes the report as JSON
+ * It returns 1 if a digest differs from its golden file (or has none), a workload got slower than the baseline
+ * .... or replaying a trace allocated memory.
+ *
+ * The report is a JSON object with a format version and one line per workload, always in the same order
+ *      {"format": 1, "workloads": [
+ *          {"name": "numa_scaled_dash", "unit": "instructions", "items": 4194304, "seconds": 0.12,
+ *           "items_per_second": 34952533, "p50_ns": 28.1, "p90_ns": 29.6, "p99_ns": 41.2, "max_ns": 90.3,
+ *           "peak_rss_kb": 5120, "golden": "match"}, ...]}
+ * .... the percentiles are of the ns per item of every block of the workload, the peak RSS is the process's
+ * .... so far (it never goes down, a workload needing more memory than the ones before it raises it)
+ */
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "allocations.h"
+#include "system.h"
+#include "trace.h"
+#include "workload.h"
+#include "booths.h"
+#include "verify.h"
+using namespace std;
+
+#ifndef REGRESS_TRACE
+#define REGRESS_TRACE "machine_code.txt"
+#endif
+#ifndef REGRESS_GOLDEN_DIR
+#define REGRESS_GOLDEN_DIR "golden"
+#endif
+
+const int SAMPLE_RUNS = 4096;
+const long long SCALED_INSTRUCTIONS = 1 << 22;
+const long long SCALED_BLOCK = 4096;
+const long long ALLOCATION_INSTRUCTIONS = 1 << 18;
+const char ALLOCATION_TRACE[] = "regress_allocations.trc";
+const long long TIMING_WITHIN_WINDOW = 300000;
+const long long TIMING_OVERRUN = 1000000;
+const long long BOOTHS_GATE_PAIRS = 1 << 17;
+const long long BOOTHS_FAST_PAIRS = 1 << 20;
+const long long BOOTHS_SLICED_PAIRS = 1 << 22;
+const long long BOOTHS_BLOCK = 1024;
+
+// What a workload measured and the digest of what it computed
+struct WorkloadResult
+{
+    string name;
+    string unit;                // what one item is
+    long long items = 0;
+    double seconds = 0;
+    vector<double> blockNs;     // ns per item of every block
+    long peakRssKb = 0;
+    string digest;              // compared with the golden file of the workload
+    string golden;              // match, mismatch, missing, updated or skipped
+};
+
+// The settings of one run of the driver
+struct Options
+{
+    string goldenDir = REGRESS_GOLDEN_DIR;
+    string tracePath = REGRESS_TRACE;
+    string outPath;
+    string baselinePath;
+    double tolerance = 10;
+    long long scale = 1;
+    bool updateGolden = false;
+};
+
+//the peak resident set size of the process so far in KB
+static long peakRssKb()
+{
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+//runs block(first, last) over [0, items) in blocks of blockSize items and times every block
+static void timeBlocks(WorkloadResult& result, long long items, long long blockSize,
+                       const function<void(long long, long long)>& block)
+{
+    result.items = items;
+    auto start = chrono::steady_clock::now();
+    auto blockStart = start;
+    for (long long first = 0; first < items; first += blockSize)
+    {
+        long long last = first + blockSize < items ? first + blockSize : items;
+        block(first, last);
+        auto now = chrono::steady_clock::now();
+        result.blockNs.push_back(chrono::duration<double, nano>(now - blockStart).count() / (last - first));
+        blockStart = now;
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    result.peakRssKb = peakRssKb();
+}
+
+//the p-th percentile (0 to 100) of the values, nearest rank
+static double percentile(vector<double> values, double p)
+{
+    if (values.empty())
+        return 0;
+    sort(values.begin(), values.end());
+    size_t rank = size_t(p / 100 * values.size());
+    return values[rank < values.size() ? rank : values.size() - 1];
+}
+
+//reads the instructions of the ASCII trace at path, returns false if it cannot be read or decoded
+static bool readSample(const string& path, const Geometry& geometry, vector<TraceRecord>& records)
+{
+    ifstream in(path);
+    if (!in)
+    {
+        cerr << "Could not open " << path << endl;
+        return false;
+    }
+    string line;
+    while (getline(in, line))
+    {
+        if (line.find_first_not_of(" \t\r") == string::npos)
+            continue;
+        TraceRecord record;
+        if (!decodeInstruction(line, geometry, record))
+        {
+            cerr << "Could not decode " << line << " in " << path << endl;
+            return false;
+        }
+        records.push_back(record);
+    }
+    return true;
+}
+
+//the text dump of a finished machine, as XanderIsCool writes it
+static string finalDump(const System& system)
+{
+    ostringstream out;
+    system.printAll(out);
+    out << "\n --------------- \nTotal Clock Count: " << system.clockCount << endl;
+    out << "Remote Access Ratio: " << system.stats.remoteRatio() << endl;
+    return out.str();
+}
+
+static WorkloadResult numaSample(const vector<TraceRecord>& sample, const Geometry& geometry, long long runs)
+{
+    WorkloadResult result;
+    result.name = "numa_sample";
+    result.unit = "runs";
+    timeBlocks(result, runs, 1, [&](long long first, long long)
+    {
+        System system(geometry);
+        for (const TraceRecord& record : sample)
+            system.execute(record);
+        if (first == 0)
+            result.digest = finalDump(system);
+    });
+    return result;
+}
+
+static WorkloadResult numaScaled(const vector<TraceRecord>& sample, Geometry geometry, Protocol protocol,
+                                 long long instructions)
+{
+    geometry.protocol = protocol;
+    WorkloadResult result;
+    result.name = string("numa_scaled_") + PROTOCOL_NAMES[protocol];
+    result.unit = "instructions";
+    System system(geometry);
+    timeBlocks(result, instructions, SCALED_BLOCK, [&](long long first, long long last)
+    {
+        for (long long i = first; i < last; i++)
+            system.execute(sample[i % sample.size()]);
+    });
+    ostringstream digest;
+    digest << "clocks " << system.clockCount << "\nremote_ratio " << system.stats.remoteRatio() << "\nstate_hash 0x"
+           << hex << system.stateHash() << "\n";
+    result.digest = digest.str();
+    return result;
+}
+
+//replays the same workload from a compiled trace and from its generator, allocated is set if either allocated
+//.... the first BLOCK_COUNT blocks are not counted, the stream allocates its ring while they are read
+static WorkloadResult numaAllocations(const Geometry& geometry, long long instructions, bool& allocated)
+{
+    WorkloadResult result;
+    result.name = "numa_allocations";
+    result.unit = "instructions";
+    string spec = string(WORKLOAD_PREFIX) + "uniform,count=" + to_string(instructions) + ",seed=1";
+    const long long warmUp = TraceStream::BLOCK_COUNT * (long long)TraceStream::BLOCK_RECORDS;
+    ostringstream digest;
+    allocated = compileTrace(spec, ALLOCATION_TRACE, geometry) != instructions;
+    timeBlocks(result, 2 * instructions, instructions, [&](long long first, long long)
+    {
+        System system(geometry);
+        long long index = 0;
+        long long before = 0;
+        long long after = 0;
+        bool ok = forEachRecord(first == 0 ? ALLOCATION_TRACE : spec, geometry, [&](const TraceRecord& record)
+        {
+            system.execute(record);
+            if (++index == warmUp)
+                before = heapAllocations();
+        });
+        after = heapAllocations();
+        allocated = allocated || !ok || after != before;
+        digest << (first == 0 ? "compiled_allocations " : "workload_allocations ") << after - before << "\n";
+        if (first != 0)
+            digest << "clocks " << system.clockCount << "\n";
+    });
+    remove(ALLOCATION_TRACE);
+    result.digest = digest.str();
+    if (allocated)
+        cerr << result.name << " allocated memory while replaying a trace, it gives\n" << result.digest;
+    return result;
+}
+
+//times a hot spot on node 0 of a 16 node mesh, the longer run saturates node 0 so the model overruns its window
+static WorkloadResult numaTiming(long long withinWindow, long long overrun)
+{
+    WorkloadResult result;
+    result.name = "numa_timing";
+    result.unit = "runs";
+    Geometry geometry;
+    geometry.nodes = 16;
+    geometry.cpusPerNode = 4;
+    geometry.memoryWords = 1024;
+    geometry.cacheLines = 64;
+    geometry.topology = TOPO_MESH;
+    ostringstream digest;
+    timeBlocks(result, 2, 1, [&](long long first, long long)
+    {
+        long long instructions = first == 0 ? withinWindow : overrun;
+        System system(geometry);
+        TimingModel timing(system.geometry);
+        system.timing = &timing;
+        string spec = string(WORKLOAD_PREFIX) + "hot-spot,count=" + to_string(instructions) + ",hot=80,hot-words=16";
+        forEachRecord(spec, geometry, [&](const TraceRecord& record) { system.execute(record); });
+        system.timing = nullptr;
+        TimingResult timed = timing.finish();
+        ResourceStats totals[RESOURCE_KINDS] = {};
+        for (int i = 0; i < geometry.nodes * RESOURCE_KINDS; i++)
+        {
+            totals[i % RESOURCE_KINDS].busy += timed.resources[i].busy;
+            totals[i % RESOURCE_KINDS].waited += timed.resources[i].waited;
+        }
+        digest << "instructions " << instructions << "\ncompletion " << timed.completion << "\noverruns "
+               << timed.overruns << "\n";
+        for (int k = 0; k < RESOURCE_KINDS; k++)
+            digest << RESOURCE_NAMES[k] << " " << totals[k].busy << " " << totals[k].waited << "\n";
+    });
+    result.digest = digest.str();
+    return result;
+}
+
+// The Booth's engines the workloads run
+enum BoothsWorkload
+{
+    BOOTHS_GATE_RADIX2,
+    BOOTHS_GATE_RADIX4,
+    BOOTHS_GATE_RADIX8,
+    BOOTHS_LOOKAHEAD,       // radix 2 on the gate-level ALU built with the carry lookahead adder
+    BOOTHS_FAST,
+    BOOTHS_SLICED
+};
+
+static const char* const BOOTHS_WORKLOAD_NAMES[] = {"booths_gate_radix2", "booths_gate_radix4", "booths_gate_radix8",
+                                                    "booths_gate_lookahead", "booths_fast", "booths_sliced"};
+
+static WorkloadResult boothsSweep(BoothsWorkload engine, long long pairs)
+{
+    typedef RegisterWord<16>::type Word;
+    WorkloadResult result;
+    result.name = BOOTHS_WORKLOAD_NAMES[engine];
+    result.unit = "pairs";
+    vector<Word> md(pairs), mq(pairs);
+    for (long long n = 0; n < pairs; n++)
+    {
+        md[n] = sweepOperand<16>(n, 0);
+        mq[n] = sweepOperand<16>(n, 1);
+    }
+    vector<Product<16>> products(pairs);
+    long long blockSize = engine == BOOTHS_FAST || engine == BOOTHS_SLICED ? 64 * BOOTHS_BLOCK : BOOTHS_BLOCK;
+    timeBlocks(result, pairs, blockSize, [&](long long first, long long last)
+    {
+        if (engine == BOOTHS_SLICED)
+        {
+            vector<Word> high(last - first), low(mq.begin() + first, mq.begin() + last);
+            slicedBatch<16, Lanes64>(&md[first], low.data(), high.data(), last - first);
+            for (long long k = first; k < last; k++)
+                products[k] = {high[k - first], low[k - first]};
+            return;
+        }
+        GateCounters gates = {};
+        gates.adder = ADDER_LOOKAHEAD;
+        for (long long k = first; k < last; k++)
+        {
+            Bits<16> a = unpackBits<16>(md[k]), b = unpackBits<16>(mq[k]);
+            if (engine == BOOTHS_GATE_RADIX8)
+                products[k] = modifiedBooths<16, 3>(a, b);
+            else if (engine == BOOTHS_GATE_RADIX4)
+                products[k] = modifiedBooths<16, 2>(a, b);
+            else if (engine == BOOTHS_FAST)
+            {
+                BoothRegisters<16> done = fastBooths<16>(md[k], mq[k]);
+                products[k] = {done.ac, done.mq};
+            }
+            else
+            {
+                GateRegisters<16> done = gateBooths(a, b, engine == BOOTHS_LOOKAHEAD ? &gates : nullptr);
+                products[k] = {Word(packBits(done.ac)), Word(packBits(done.mq))};
+            }
+        }
+    });
+    //FNV-1a over the products, high word first
+    uint64_t hash = 0xcbf29ce484222325ull;
+    long long wrong = 0;
+    for (long long k = 0; k < pairs; k++)
+    {
+        for (Word word : {products[k].high, products[k].low})
+            for (int byte = 0; byte < 2; byte++)
+                hash = (hash ^ ((word >> (8 * byte)) & 0xFF)) * 0x100000001b3ull;
+        Product<16> native = nativeProduct<16>(md[k], mq[k]);
+        wrong += products[k].high != native.high || products[k].low != native.low;
+    }
+    ostringstream digest;
+    digest << "product_hash 0x" << hex << hash << dec << "\nwrong " << wrong << "\n";
+    result.digest = digest.str();
+    return result;
+}
+
+//compares the digest with the golden file of the workload, or replaces the file with it
+static void checkGolden(WorkloadResult& result, const Options& options)
+{
+    string path = options.goldenDir + "/" + result.name + ".txt";
+    if (options.updateGolden)
+    {
+        ofstream out(path);
+        if (!out)
+        {
+            cerr << "Could not write " << path << endl;
+            result.golden = "missing";
+            return;
+        }
+        out << result.digest;
+        result.golden = "updated";
+        return;
+    }
+    if (options.scale != 1)
+    {
+        result.golden = "skipped";
+        return;
+    }
+    ifstream in(path);
+    if (!in)
+    {
+        cerr << "No golden file " << path << " for " << result.name << ", make one with --update-golden" << endl;
+        result.golden = "missing";
+        return;
+    }
+    ostringstream expected;
+    expected << in.rdbuf();
+    result.golden = expected.str() == result.digest ? "match" : "mismatch";
+    if (result.golden == "mismatch")
+        cerr << result.name << " drifted from " << path << ", it now gives\n" << result.digest;
+}
+
+//reads the items per second of every workload of an earlier report
+static bool readBaseline(const string& path, map<string, double>& baseline)
+{
+    ifstream in(path);
+    if (!in)
+    {
+        cerr << "Could not open " << path << endl;
+        return false;
+    }
+    //the report has one workload per line, see writeJson
+    string line;
+    while (getline(in, line))
+    {
+        size_t name = line.find("\"name\": \"");
+        size_t rate = line.find("\"items_per_second\": ");
+        if (name == string::npos || rate == string::npos)
+            continue;
+        name += 9;
+        baseline[line.substr(name, line.find('"', name) - name)] = atof(line.c_str() + rate + 20);
+    }
+    return true;
+}
+
+static void writeJson(ostream& out, const vector<WorkloadResult>& results)
+{
+    out << "{\"format\": 1, \"workloads\": [";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const WorkloadResult& r = results[i];
+        out << (i ? ",\n    " : "\n    ") << "{\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit
+            << "\", \"items\": " << r.items << ", \"seconds\": " << r.seconds << ", \"items_per_second\": "
+            << (r.seconds > 0 ? r.items / r.seconds : 0) << ", \"p50_ns\": " << percentile(r.blockNs, 50)
+            << ", \"p90_ns\": " << percentile(r.blockNs, 90) << ", \"p99_ns\": " << percentile(r.blockNs, 99)
+            << ", \"max_ns\": " << percentile(r.blockNs, 100) << ", \"peak_rss_kb\": " << r.peakRssKb
+            << ", \"golden\": \"" << r.golden << "\"}";
+    }
+    out << "\n]}\n";
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        string option = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (option == "--golden" && hasValue)
+            options.goldenDir = argv[++i];
+        else if (option == "--trace" && hasValue)
+            options.tracePath = argv[++i];
+        else if (option == "--out" && hasValue)
+            options.outPath = argv[++i];
+        else if (option == "--baseline" && hasValue)
+            options.baselinePath = argv[++i];
+        else if (option == "--tolerance" && hasValue)
+            options.tolerance = atof(argv[++i]);
+        else if (option == "--scale" && hasValue)
+            options.scale = atoll(argv[++i]);
+        else if (option == "--update-golden")
+            options.updateGolden = true;
+        else
+        {
+            cerr << "Usage: regress [--golden DIR] [--trace FILE] [--update-golden] [--scale K]"
+                 << " [--baseline FILE [--tolerance PCT]] [--out FILE]" << endl;
+            return 1;
+        }
+    }
+    if (options.scale < 1)
+    {
+        cerr << "--scale has to be at least 1" << endl;
+        return 1;
+    }
+    map<string, double> baseline;
+    if (!options.baselinePath.empty() && !readBaseline(options.baselinePath, baseline))
+        return 1;
+
+    Geometry geometry;
+    deriveGeometry(geometry);
+    vector<TraceRecord> sample;
+    if (!readSample(options.tracePath, geometry, sample) || sample.empty())
+        return 1;
+
+    vector<WorkloadResult> results;
+    results.push_back(numaSample(sample, geometry, SAMPLE_RUNS * options.scale));
+    for (Protocol protocol : {PROTO_DASH, PROTO_MSI, PROTO_MESI, PROTO_MOESI})
+        results.push_back(numaScaled(sample, geometry, protocol, SCALED_INSTRUCTIONS * options.scale));
+    bool allocated = false;
+    results.push_back(numaAllocations(geometry, ALLOCATION_INSTRUCTIONS * options.scale, allocated));
+    results.push_back(numaTiming(TIMING_WITHIN_WINDOW * options.scale, TIMING_OVERRUN * options.scale));
+    results.push_back(boothsSweep(BOOTHS_GATE_RADIX2, BOOTHS_GATE_PAIRS * options.scale));
+    results.push_back(boothsSweep(BOOTHS_GATE_RADIX4, BOOTHS_GATE_PAIRS * options.scale));
+    results.push_back(boothsSweep(BOOTHS_GATE_RADIX8, BOOTHS_GATE_PAIRS * options.scale));
+    results.push_back(boothsSweep(BOOTHS_LOOKAHEAD, BOOTHS_GATE_PAIRS * options.scale));
+    results.push_back(boothsSweep(BOOTHS_FAST, BOOTHS_FAST_PAIRS * options.scale));
+    results.push_back(boothsSweep(BOOTHS_SLICED, BOOTHS_SLICED_PAIRS * options.scale));
+
+    int failed = allocated;
+    cout << left << setw(24) << "Workload" << right << setw(14) << "Items/second" << setw(10) << "p50 ns"
+         << setw(10) << "p90 ns" << setw(10) << "p99 ns" << setw(12) << "Peak RSS KB" << setw(10) << "Golden"
+         << "  Baseline" << endl;
+    for (WorkloadResult& result : results)
+    {
+        checkGolden(result, options);
+        failed += result.golden == "mismatch" || result.golden == "missing";
+        double perSecond = result.seconds > 0 ? result.items / result.seconds : 0;
+        cout << left << setw(24) << result.name << right << setw(14) << perSecond << setw(10)
+             << percentile(result.blockNs, 50) << setw(10) << percentile(result.blockNs, 90) << setw(10)
+             << percentile(result.blockNs, 99) << setw(12) << result.peakRssKb << setw(10) << result.golden;
+        auto before = baseline.find(result.name);
+        if (before != baseline.end() && before->second > 0)
+        {
+            double change = 100 * (perSecond - before->second) / before->second;
+            bool slower = change < -options.tolerance;
+            failed += slower;
+            cout << "  " << showpos << change << noshowpos << "%" << (slower ? " SLOWER" : "");
+        }
+        cout << endl;
+    }
+
+    if (!options.outPath.empty())
+    {
+        ofstream out(options.outPath);
+        if (!out)
+        {
+            cerr << "Could not open " << options.outPath << endl;
+            return 1;
+        }
+        writeJson(out, results);
+    }
+    return failed == 0 ? 0 : 1;
+}